@@ -0,0 +1,174 @@
+// Internals of line-arg.c, shared with lnA-gen so it can walk
+// compiled usages; nothing here is part of the library's API
+#ifndef lnA_line_arg_int_h
+#define lnA_line_arg_int_h
+
+#include "line-arg.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Usage strings are compiled into a flat array of nodes when
+// they're added, so the matcher never has to lex the text again.
+// Node 0 is the root, an alternative holding the top level sequence;
+// children and siblings are linked by index with 0 marking the end
+// of a list, since the root is never a child
+typedef enum lnA_Kind {
+    lnA_PARAM,     // NAME
+    lnA_SHORT,     // -abc
+    lnA_LONG,      // --name or --name=PARAM
+    lnA_OPTIONAL,  // [...], children are alternatives
+    lnA_REQUIRED,  // {...}, children are alternatives
+    lnA_ALT        // Alternative, children are a sequence
+} lnA_Kind;
+
+typedef struct lnA_Node {
+    lnA_Kind kind;
+    bool     rep;    // Followed by '...'
+    unsigned uIdx;   // Offset of the node text in the usage string
+    unsigned uLen;   // Length of the node text
+    unsigned nLen;   // Length of a long option's name (before '=')
+    unsigned lId;    // Distinct long option name id
+    bool     null;   // Can match without consuming arguments
+    unsigned child;  // First child
+    unsigned next;   // Next sibling
+} lnA_Node;
+
+// Token sets, used for the FIRST and FOLLOW sets of usage
+// nodes, have one bit for each kind of argument a node can
+// start with: parameters, the end of the arguments, each
+// short option letter, and each long option name in the usage
+enum {
+    lnA_T_PARAM = 0,
+    lnA_T_END   = 1,
+    lnA_T_SHORT = 2,
+    lnA_T_LONG  = 2 + 256
+};
+
+typedef struct lnA_Usage {
+    char*     usage;
+    lnA_Node* nodes;   // Compiled usage string
+    unsigned  nCount;  // Number of nodes
+    unsigned  nCap;    // Allocated nodes
+    char*     eText;   // Compile error, NULL for valid usages
+    lnA_Error cErr;    // Compile error descriptor
+    
+    uint64_t* first;   // FIRST set of each node
+    unsigned  fWords;  // Words per token set
+    unsigned* lNode;   // First node with each distinct long name
+    unsigned  lCount;  // Number of distinct long names
+    bool      det;     // Every choice is decided by the next token
+    unsigned  nest;    // Deepest nesting of groups
+    lnA_Complexity cost; // Worst case time of backtracking matching
+    
+    unsigned  id;      // Index in the order usages were added
+    
+    struct lnA_Usage* next;
+} lnA_Usage;
+
+typedef struct lnA_Param {
+    char*       name;
+    unsigned    nLen;    // Length of the name
+    lnA_ParamCb callback;
+    lnA_SliceCb slice;   // Takes repeated arguments all at once
+    lnA_Value   val;     // Typed parameters have a destination instead
+    unsigned    id;      // Index in the order parameters were added
+    struct lnA_Param* next;
+} lnA_Param;
+
+typedef struct lnA_Option {
+    char*        sForm;  // Short form (i.e -h)
+    char*        lForm;  // Long form (i.e --help)
+    unsigned     lLen;   // Length of the long form
+    char*        desc;   // Description text
+    lnA_OptionCb callback;
+    unsigned     id;     // Index in the order options were added
+    struct lnA_Option* next;
+} lnA_Option;
+
+// Subcommand, its parser is only made the first
+// time a command line uses it
+typedef struct lnA_Command {
+    char*          name;
+    unsigned       nLen;   // Length of the name
+    char*          desc;   // Description text
+    lnA_CommandCb  make;   // Makes the command's parser
+    lnA_Parser*    child;  // The parser, once it's made
+    bool           owns;   // Child is freed with this command
+    unsigned       id;     // Index in the order commands were added
+    struct lnA_Command* next;
+} lnA_Command;
+
+// Slot in an open addressing table of long option
+// or parameter names, empty slots have no item
+typedef struct lnA_Slot {
+    char*    name;
+    unsigned nLen;
+    uint32_t hash;
+    void*    item;
+} lnA_Slot;
+
+typedef struct lnA_Parser {
+    lnA_Usage*  uList;   // List of usage altenratives
+    lnA_Usage** uVec;    // Usages in the order they were added
+    unsigned    uCount;  // Number of usages
+    unsigned    uCap;    // Allocated usage slots
+    lnA_Param*  pList;   // List of parameter callbacks
+    lnA_Option* oList;   // List of option descriptions
+    
+    // Lookup tables, kept up to date as options and
+    // parameters are added so matching never changes them
+    lnA_Option* sTable[256];  // Options by short form letter
+    lnA_Slot*   lTable;       // Options by long form
+    unsigned    lCap;         // Slots in lTable, a power of 2
+    unsigned    lCount;       // Names in lTable
+    lnA_Slot*   pTable;       // Parameters by name
+    unsigned    pCap;         // Slots in pTable, a power of 2
+    unsigned    pCount;       // Names in pTable
+    unsigned    oNext;        // ID of the next option added
+    unsigned    pNext;        // ID of the next parameter added
+    
+    lnA_Command* cList;       // List of subcommands
+    lnA_Slot*   cTable;       // Subcommands by name
+    unsigned    cCap;         // Slots in cTable, a power of 2
+    unsigned    cCount;       // Names in cTable
+    
+    char*       pName;   // Program name
+    char*       hText;   // Header text provided by user
+    char*       fText;   // Footer text provided by user
+    
+    char*       hBuf;    // Rendered help text
+    size_t      hLen;    // Length of the help text
+    size_t      hCap;    // Allocated help text size
+    unsigned    hCols;   // Width it was rendered for, 0 once the parser changes
+    
+    unsigned     flags;  // Matching flags
+    void*        udata;  // User data passed to callbacks.
+    
+    unsigned long sMax;  // Steps each parse can take, 0 for no limit
+    unsigned      dMax;  // Deepest nesting of groups allowed, 0 for no limit
+    
+    lnA_Allocator mem;   // Allocator hooks
+    
+    // Items made by lnA_loadParser() or lnA_makeParserDef(),
+    // they're allocated as one array of each kind
+    lnA_Usage*  bUsg;
+    unsigned    bUCount;
+    lnA_Option* bOpt;
+    unsigned    bOCount;
+    lnA_Param*  bPrm;
+    unsigned    bPCount;
+    
+    struct lnA_Context* ctx;  // Context used by the lnA_Parser functions
+} lnA_Parser;
+
+// Lookups by name, as the matcher does them
+lnA_Param*
+lnA_findParam( lnA_Parser* par, char* name, unsigned len );
+
+lnA_Option*
+lnA_findOptionLong( lnA_Parser* par, char* name, unsigned len );
+
+lnA_Option*
+lnA_findOptionShort( lnA_Parser* par, char name );
+
+#endif
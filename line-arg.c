@@ -1,219 +1,866 @@
-#include "line-arg.h"
+// For mmap() and friends, used by argument sources
+#define _POSIX_C_SOURCE 200809L
+
+#include "line-arg-int.h"
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <limits.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+
+// Kinds of arguments, everything from lnA_A_LONG
+// on starts with '--'
+typedef enum {
+    lnA_A_END,     // Past the last argument
+    lnA_A_PARAM,   // Doesn't start with '-'
+    lnA_A_SHORT,   // Cluster of short flags, '-abc'
+    lnA_A_OTHER,   // Lone '-', or '-' and a non graphic character
+    lnA_A_LONG,    // '--name'
+    lnA_A_VALUE,   // '--name=value'
+    lnA_A_DASHES   // Just '--'
+} lnA_ArgKind;
 
-typedef struct lnA_Usage {
-    char*  usage;
-    struct lnA_Usage* next;
-} lnA_Usage;
-
-typedef struct lnA_Param {
-    char*       name;
-    lnA_ParamCb callback;
-    struct lnA_Param* next;
-} lnA_Param;
-
-typedef struct lnA_Option {
-    char*        sForm;  // Short form (i.e -h)
-    char*        lForm;  // Long form (i.e --help)
-    char*        desc;   // Description text
-    lnA_OptionCb callback;
-    struct lnA_Option* next;
-} lnA_Option;
+// Each argument is classified once before matching,
+// so the matcher doesn't rescan argument strings
+typedef struct lnA_Token {
+    char*       str;   // The argument
+    lnA_ArgKind kind;
+    unsigned    nLen;  // Length of the flags or long option name
+    unsigned    vOff;  // Offset of a long option's value
+} lnA_Token;
 
+// Value of a typed parameter, converted while matching
+typedef union lnA_Number {
+    int64_t  i;  // lnA_V_INT, lnA_V_RANGE, lnA_V_BOOL, and lnA_V_ENUM
+    uint64_t u;  // lnA_V_UINT
+    double   d;  // lnA_V_DOUBLE
+} lnA_Number;
+
+// Callbacks are queued in a journal that's kept for the
+// life of the parser; groups remember its length before
+// trying an alternative and truncate it back on failure
 typedef struct lnA_Queued {
     void
     (*callback)( char* str, void* udata );
     
     char* str;
     
-    struct lnA_Queued* next;
+    // Parameter slices have a slice callback instead, and
+    // start at an argument index since the argument window
+    // may move; a slice with 'str' set is just that string
+    lnA_SliceCb slice;
+    unsigned    aIdx;
+    unsigned    nArgs;
+    
+    // What matched, for collecting into lnA_Matches
+    // and storing the values of typed parameters
+    lnA_Option* opt;
+    lnA_Param*  prm;
+    lnA_Number  num;
 } lnA_Queued;
 
-typedef struct lnA_Queue {
-    lnA_Queued* first;
-    lnA_Queued* last;
-} lnA_Queue;
-
-typedef struct lnA_Parser {
-    lnA_Usage*  uList;   // List of usage altenratives
-    lnA_Param*  pList;   // List of parameter callbacks
-    lnA_Option* oList;   // List of option descriptions
-    char*       eText;   // Error message
-    char*       pName;   // Program name
-    char*       hText;   // Header text provided by user
-    char*       fText;   // Footer text provided by user
-    
-    lnA_Queue*   qNow;   // Current callback queue
+// Packrat memo entry for one node at one argument index,
+// ends are stored offset by 2 so that 0 means not yet
+// matched and 1 means the match failed
+typedef struct lnA_Memo {
+    unsigned once;   // End of a single match of the node
+    unsigned thing;  // End of the node including repetition
+    unsigned alt;    // Alternative that matched, for groups
+} lnA_Memo;
+
+// Everything that changes while matching, so
+// each thread can match with its own context
+typedef struct lnA_Context {
+    lnA_Parser*  par;    // Parser being matched, never changed
+    void*        udata;  // User data passed to callbacks
+    
+    lnA_Error    err;    // Error from the last parse
+    char*        eText;  // Formatted error message
+    size_t       eCap;   // Allocated error message size
+    lnA_Error*   uErr;   // Failure of each usage in the last lnA_tryAll()
+    unsigned     ueCap;  // Allocated usage failures
+    
+    lnA_Queued*  queue;  // Callback journal
+    unsigned     qLen;   // Number of queued callbacks
+    unsigned     qCap;   // Allocated journal entries
     lnA_Usage*   uNow;   // Current usage being parsed
-    unsigned     uIdx;   // Index into usage string
-    char**       argv;   // Current argument list
+    char**       argv;   // Current argument list, or window of the source
     unsigned     aIdx;   // Index into argument list
+    unsigned     aCount; // Number of arguments, once known
+    lnA_Token*   toks;   // Classified arguments, with an end token
+    unsigned     tCap;   // Allocated tokens
+    
+    // Arguments pulled from a source are kept in a window
+    // of the tokens and argv, starting at argument 'tBase'
+    lnA_Source*  src;    // Source being matched, if any
+    char**       aBuf;   // Window of source arguments
+    unsigned     bCap;   // Allocated window arguments
+    unsigned     tBase;  // Index of the first argument in the window
+    unsigned     tEnd;   // Index past the last classified argument
+    unsigned     tKeep;  // Arguments before this won't be matched again
+    bool         quiet;  // Don't queue callbacks
+    bool         hold;   // Don't invoke callbacks before the usage matches
+    lnA_Matches* out;    // Where matches are collected instead of invoking callbacks
+    unsigned     depth;  // Number of groups being matched
+    unsigned long steps; // Steps taken by the current parse
+    bool         halt;   // Ran out of steps, the parse is over
+    
+    lnA_Memo*    memo;   // Packrat memo table (nodes by arguments)
+    size_t       mCap;   // Allocated memo entries
+    
+    char*        sMem;   // Scratch arena for per-parse data
+    size_t       sSize;  // Size of the scratch arena
+    size_t       sUsed;  // Bytes used in the scratch arena
+} lnA_Context;
+
+static void*
+stdAlloc( size_t size, void* ctx ) {
+    (void)ctx;
+    return malloc( size );
+}
+
+static void*
+stdResize( void* ptr, size_t old, size_t size, void* ctx ) {
+    (void)old;
+    (void)ctx;
+    return realloc( ptr, size );
+}
+
+static void
+stdFree( void* ptr, size_t size, void* ctx ) {
+    (void)size;
+    (void)ctx;
+    free( ptr );
+}
+
+// State of a buffer allocator, kept at the start of its buffer
+typedef struct lnA_Buffer {
+    char*  mem;   // Memory after this header
+    size_t size;  // Size of the memory
+    size_t used;  // Bytes handed out
+    size_t peak;  // Most bytes ever handed out
+    size_t spill; // Bytes that had to come from malloc()
+    char*  last;  // Last allocation, which can grow or be taken back
+} lnA_Buffer;
+
+#define lnA_BUF_ALIGN (16)
+#define bufRound( n ) (((n) + lnA_BUF_ALIGN - 1) & ~(size_t)(lnA_BUF_ALIGN - 1))
+
+static bool
+inBuffer( lnA_Buffer* buf, void* ptr ) {
+    uintptr_t addr = (uintptr_t)ptr;
+    uintptr_t base = (uintptr_t)buf->mem;
+    return addr >= base && addr < base + buf->size;
+}
+
+static void*
+bufAlloc( size_t size, void* ctx ) {
+    lnA_Buffer* buf = ctx;
+    size = bufRound( size );
+    if( size > buf->size - buf->used ) {
+        buf->spill += size;
+        return malloc( size );
+    }
+    
+    buf->last  = &buf->mem[buf->used];
+    buf->used += size;
+    if( buf->used > buf->peak )
+        buf->peak = buf->used;
+    return buf->last;
+}
+
+static void
+bufFree( void* ptr, size_t size, void* ctx ) {
+    (void)size;
+    lnA_Buffer* buf = ctx;
+    if( !inBuffer( buf, ptr ) ) {
+        free( ptr );
+        return;
+    }
+    if( ptr == buf->last ) {
+        buf->used = buf->last - buf->mem;
+        buf->last = NULL;
+    }
+}
+
+static void*
+bufResize( void* ptr, size_t old, size_t size, void* ctx ) {
+    lnA_Buffer* buf = ctx;
+    if( !inBuffer( buf, ptr ) ) {
+        // Its old size was already counted
+        if( bufRound( size ) > bufRound( old ) )
+            buf->spill += bufRound( size ) - bufRound( old );
+        return realloc( ptr, bufRound( size ) );
+    }
+    
+    // The last allocation grows in place while it fits
+    size_t start = (char*)ptr - buf->mem;
+    if( ptr == buf->last && bufRound( size ) <= buf->size - start ) {
+        buf->used = start + bufRound( size );
+        if( buf->used > buf->peak )
+            buf->peak = buf->used;
+        return ptr;
+    }
+    
+    void* mem = bufAlloc( size, ctx );
+    memcpy( mem, ptr, old < size ? old : size );
+    return mem;
+}
+
+void
+lnA_bufferAllocator( lnA_Allocator* mem, void* ptr, size_t size ) {
+    size_t skew = (uintptr_t)ptr % lnA_BUF_ALIGN ? lnA_BUF_ALIGN - (uintptr_t)ptr % lnA_BUF_ALIGN : 0;
+    size_t head = skew + bufRound( sizeof(lnA_Buffer) );
     
-    void*        udata;  // User data passed to callbacks.
-} lnA_Parser;
+    // Without room for the header it's just malloc()
+    if( !ptr || size < head ) {
+        *mem = (lnA_Allocator){ &stdAlloc, &stdResize, &stdFree, NULL };
+        return;
+    }
+    lnA_Buffer* buf = (lnA_Buffer*)((char*)ptr + skew);
+    *buf = (lnA_Buffer){ .mem = (char*)ptr + head, .size = size - head };
+    *mem = (lnA_Allocator){ &bufAlloc, &bufResize, &bufFree, buf };
+}
+
+size_t
+lnA_bufferNeeded( lnA_Allocator* mem ) {
+    lnA_Buffer* buf = mem->ctx;
+    if( !buf )
+        return 0;
+    // Leave room to align a buffer that starts anywhere
+    return lnA_BUF_ALIGN - 1 + (buf->mem - (char*)buf) + buf->peak + buf->spill;
+}
+
+static void*
+mAlloc( lnA_Parser* par, size_t size ) {
+    return par->mem.alloc( size, par->mem.ctx );
+}
+
+static void*
+mResize( lnA_Parser* par, void* ptr, size_t old, size_t size );
+
+static void
+mFree( lnA_Parser* par, void* ptr, size_t size );
+
+static bool
+inScratch( lnA_Context* ctx, void* ptr );
+
+static void
+scratchReset( lnA_Context* ctx );
 
 lnA_Parser*
 lnA_makeParser( char* name, void* udata ) {
-    lnA_Parser* par = malloc( sizeof(lnA_Parser) );
+    return lnA_makeParserEx( name, udata, NULL );
+}
+
+lnA_Parser*
+lnA_makeParserEx( char* name, void* udata, lnA_Allocator* mem ) {
+    lnA_Allocator std = { &stdAlloc, &stdResize, &stdFree, NULL };
+    if( !mem )
+        mem = &std;
+    
+    lnA_Parser* par = mem->alloc( sizeof(lnA_Parser), mem->ctx );
     *par = (lnA_Parser){ 0 };
     par->pName = name;
     par->udata = udata;
+    par->mem   = *mem;
     return par;
 }
 
 void
 lnA_freeParser( lnA_Parser* par ) {
+    // Commands own the parsers made for them, which can
+    // have allocators of their own
+    for( lnA_Command* cIt = par->cList ; cIt ; cIt = cIt->next ) {
+        if( cIt->owns )
+            lnA_freeParser( cIt->child );
+    }
+    
+    // Without a free hook everything belongs to the
+    // allocator, which releases it all at once
+    if( !par->mem.free )
+        return;
+    
     lnA_Usage* uIt = par->uList;
     while( uIt ) {
         lnA_Usage* tmp = uIt;
         uIt = uIt->next;
-        free( tmp );
+        
+        mFree( par, tmp->nodes, tmp->nCap*sizeof(lnA_Node) );
+        mFree( par, tmp->first, (size_t)tmp->nCount*tmp->fWords*sizeof(uint64_t) );
+        mFree( par, tmp->lNode, tmp->lCount*sizeof(unsigned) );
+        if( tmp->eText )
+            mFree( par, tmp->eText, strlen( tmp->eText ) + 1 );
+        if( tmp < par->bUsg || tmp >= par->bUsg + par->bUCount )
+            mFree( par, tmp, sizeof(lnA_Usage) );
     }
     
     lnA_Option* oIt = par->oList;
     while( oIt ) {
         lnA_Option* tmp = oIt;
         oIt = oIt->next;
-        free( tmp );    
+        if( tmp >= par->bOpt && tmp < par->bOpt + par->bOCount )
+            continue;
+        mFree( par, tmp, sizeof(lnA_Option) );
     }
     
     lnA_Param* pIt = par->pList;
     while( pIt ) {
         lnA_Param* tmp = pIt;
         pIt = pIt->next;
-        free( tmp );
+        if( tmp >= par->bPrm && tmp < par->bPrm + par->bPCount )
+            continue;
+        mFree( par, tmp, sizeof(lnA_Param) );
+    }
+    
+    lnA_Command* cIt = par->cList;
+    while( cIt ) {
+        lnA_Command* tmp = cIt;
+        cIt = cIt->next;
+        mFree( par, tmp, sizeof(lnA_Command) );
     }
     
-    if( par->eText )
-        free( par->eText );
+    if( par->ctx )
+        lnA_freeContext( par->ctx );
     
-    free( par );
+    mFree( par, par->lTable, par->lCap*sizeof(lnA_Slot) );
+    mFree( par, par->pTable, par->pCap*sizeof(lnA_Slot) );
+    mFree( par, par->cTable, par->cCap*sizeof(lnA_Slot) );
+    mFree( par, par->hBuf, par->hCap );
+    mFree( par, par->uVec, par->uCap*sizeof(lnA_Usage*) );
+    mFree( par, par->bUsg, par->bUCount*sizeof(lnA_Usage) );
+    mFree( par, par->bOpt, par->bOCount*sizeof(lnA_Option) );
+    mFree( par, par->bPrm, par->bPCount*sizeof(lnA_Param) );
+    mFree( par, par, sizeof(lnA_Parser) );
+}
+
+lnA_Context*
+lnA_makeContext( lnA_Parser* par, void* udata ) {
+    lnA_Context* ctx = mAlloc( par, sizeof(lnA_Context) );
+    *ctx = (lnA_Context){ 0 };
+    ctx->par   = par;
+    ctx->udata = udata;
+    return ctx;
+}
+
+void
+lnA_freeContext( lnA_Context* ctx ) {
+    lnA_Parser* par = ctx->par;
+    if( !par->mem.free )
+        return;
+    
+    mFree( par, ctx->eText, ctx->eCap );
+    mFree( par, ctx->uErr, ctx->ueCap*sizeof(lnA_Error) );
+    if( !inScratch( ctx, ctx->memo ) )
+        mFree( par, ctx->memo, ctx->mCap*sizeof(lnA_Memo) );
+    if( !inScratch( ctx, ctx->queue ) )
+        mFree( par, ctx->queue, ctx->qCap*sizeof(lnA_Queued) );
+    if( !inScratch( ctx, ctx->toks ) )
+        mFree( par, ctx->toks, ctx->tCap*sizeof(lnA_Token) );
+    if( !inScratch( ctx, ctx->aBuf ) )
+        mFree( par, ctx->aBuf, ctx->bCap*sizeof(char*) );
+    mFree( par, ctx, sizeof(lnA_Context) );
+}
+
+// The lnA_Parser functions match with a context
+// made the first time it's needed
+static lnA_Context*
+parCtx( lnA_Parser* par ) {
+    if( !par->ctx )
+        par->ctx = lnA_makeContext( par, par->udata );
+    return par->ctx;
+}
+
+void
+lnA_setScratchCtx( lnA_Context* ctx, void* mem, size_t size ) {
+    
+    // Per-parse data can't stay in the old arena
+    scratchReset( ctx );
+    
+    // Keep allocations aligned
+    size_t skew = (uintptr_t)mem % 16 ? 16 - (uintptr_t)mem % 16 : 0;
+    if( !mem || size < skew ) {
+        ctx->sMem  = NULL;
+        ctx->sSize = 0;
+    }
+    else {
+        ctx->sMem  = (char*)mem + skew;
+        ctx->sSize = size - skew;
+    }
+    ctx->sUsed = 0;
+}
+
+void
+lnA_setScratch( lnA_Parser* par, void* mem, size_t size ) {
+    lnA_setScratchCtx( parCtx( par ), mem, size );
+}
+
+void
+lnA_setMatchesCtx( lnA_Context* ctx, lnA_Matches* out ) {
+    ctx->out = out;
+}
+
+void
+lnA_setMatches( lnA_Parser* par, lnA_Matches* out ) {
+    lnA_setMatchesCtx( parCtx( par ), out );
+}
+
+void
+lnA_freeMatches( lnA_Parser* par, lnA_Matches* out ) {
+    if( par->mem.free ) {
+        mFree( par, out->oCount, out->oCap*sizeof(unsigned) );
+        mFree( par, out->pCount, out->pCap*sizeof(unsigned) );
+        mFree( par, out->pFirst, out->pCap*sizeof(unsigned) );
+        mFree( par, out->vParam, out->vCap*sizeof(unsigned) );
+        mFree( par, out->vStr, out->vCap*sizeof(char*) );
+        mFree( par, out->vLen, out->vCap*sizeof(unsigned) );
+        mFree( par, out->vArg, out->vCap*sizeof(unsigned) );
+        mFree( par, out->vOff, out->vCap*sizeof(unsigned) );
+    }
+    *out = (lnA_Matches){ 0 };
+}
+
+static void
+compileUsage( lnA_Parser* par, lnA_Usage* usg );
+
+// Adds a usage to the list and the vector of usages
+static void
+linkUsage( lnA_Parser* par, lnA_Usage* usg ) {
+    usg->next  = par->uList;
+    par->uList = usg;
+    par->hCols = 0;
+    
+    if( par->uCount == par->uCap ) {
+        unsigned uCap = par->uCap ? par->uCap*2 : 4;
+        par->uVec = mResize( par, par->uVec, par->uCap*sizeof(lnA_Usage*), uCap*sizeof(lnA_Usage*) );
+        par->uCap = uCap;
+    }
+    usg->id = par->uCount;
+    par->uVec[par->uCount++] = usg;
 }
 
 lnA_Usage*
 lnA_addUsage( lnA_Parser* par, char* usage ) {
-    lnA_Usage* usg = malloc(sizeof(lnA_Usage));
+    lnA_Usage* usg = mAlloc( par, sizeof(lnA_Usage) );
+    *usg = (lnA_Usage){ 0 };
     usg->usage = usage;
-    usg->next  = par->uList;
-    par->uList = usg;
+    linkUsage( par, usg );
+    compileUsage( par, usg );
     return usg;
 }
 
-void
+char*
+lnA_usageError( lnA_Usage* usg ) {
+    return usg->eText;
+}
+
+int
+lnA_isDeterministic( lnA_Usage* usg ) {
+    return usg->det;
+}
+
+const lnA_Complexity*
+lnA_usageComplexity( lnA_Usage* usg ) {
+    return &usg->cost;
+}
+
+static void
+addName( lnA_Parser* par, lnA_Slot** table, unsigned* cap, unsigned* count, char* name, unsigned len, void* item );
+
+// Adds a parameter to the list and the name table
+static void
+linkParam( lnA_Parser* par, lnA_Param* prm ) {
+    prm->nLen = strlen( prm->name );
+    prm->id   = par->pNext++;
+    prm->next = par->pList;
+    par->pList = prm;
+    addName( par, &par->pTable, &par->pCap, &par->pCount, prm->name, prm->nLen, prm );
+}
+
+// Adds an option to the list and the name tables
+static void
+linkOption( lnA_Parser* par, lnA_Option* opt ) {
+    opt->lLen  = opt->lForm ? strlen( opt->lForm ) : 0;
+    opt->id    = par->oNext++;
+    opt->next  = par->oList;
+    par->oList = opt;
+    par->hCols = 0;
+    
+    // The newest definition of a name is the one that counts
+    if( opt->lForm )
+        addName( par, &par->lTable, &par->lCap, &par->lCount, opt->lForm, opt->lLen, opt );
+    for( char* sChr = opt->sForm ; sChr && *sChr ; sChr++ )
+        par->sTable[(unsigned char)*sChr] = opt;
+}
+
+int
 lnA_addParam( lnA_Parser* par, char* name, lnA_ParamCb cb ) {
-    lnA_Param* prm = malloc(sizeof(lnA_Param));
+    lnA_Param* prm = mAlloc( par, sizeof(lnA_Param) );
     prm->name = name;
     prm->callback = cb;
-    prm->next = par->pList;
-    par->pList = prm;
+    prm->slice = NULL;
+    prm->val = (lnA_Value){ 0 };
+    linkParam( par, prm );
+    return prm->id;
 }
 
-void
+int
+lnA_addParamSlice( lnA_Parser* par, char* name, lnA_SliceCb cb ) {
+    lnA_Param* prm = mAlloc( par, sizeof(lnA_Param) );
+    prm->name = name;
+    prm->callback = NULL;
+    prm->slice = cb;
+    prm->val = (lnA_Value){ 0 };
+    linkParam( par, prm );
+    return prm->id;
+}
+
+int
+lnA_addParamValue( lnA_Parser* par, char* name, lnA_Value* val ) {
+    lnA_Param* prm = mAlloc( par, sizeof(lnA_Param) );
+    prm->name = name;
+    prm->callback = NULL;
+    prm->slice = NULL;
+    prm->val = *val;
+    linkParam( par, prm );
+    return prm->id;
+}
+
+int
 lnA_addOption( lnA_Parser* par, char* sf, char* lf, char* desc, lnA_OptionCb cb ) {
-    lnA_Option* opt = malloc(sizeof(lnA_Option));
+    lnA_Option* opt = mAlloc( par, sizeof(lnA_Option) );
     opt->sForm    = sf;
     opt->lForm    = lf;
     opt->desc     = desc;
     opt->callback = cb;
-    opt->next  = par->oList;
-    par->oList = opt;
+    linkOption( par, opt );
+    return opt->id;
+}
+
+lnA_Parser*
+lnA_makeParserDef( const lnA_ParserDef* def, void* udata, lnA_Allocator* mem ) {
+    lnA_Parser* par = lnA_makeParserEx( def->name, udata, mem );
+    par->hText = def->header;
+    par->fText = def->footer;
+    par->flags = def->flags;
+    
+    unsigned uCount = 0, oCount = 0, pCount = 0;
+    while( def->usages && def->usages[uCount] )
+        uCount++;
+    while( def->options && (def->options[oCount].sf || def->options[oCount].lf) )
+        oCount++;
+    while( def->params && def->params[pCount].name )
+        pCount++;
+    
+    // One array of each kind instead of an allocation per item,
+    // the strings and callbacks stay in the descriptors
+    par->bUsg = mAlloc( par, uCount*sizeof(lnA_Usage) );
+    par->bOpt = mAlloc( par, oCount*sizeof(lnA_Option) );
+    par->bPrm = mAlloc( par, pCount*sizeof(lnA_Param) );
+    par->bUCount = uCount;
+    par->bOCount = oCount;
+    par->bPCount = pCount;
+    
+    for( unsigned i = 0 ; i < uCount ; i++ ) {
+        lnA_Usage* usg = &par->bUsg[i];
+        *usg = (lnA_Usage){ 0 };
+        usg->usage = def->usages[i];
+        linkUsage( par, usg );
+        compileUsage( par, usg );
+    }
+    for( unsigned i = 0 ; i < oCount ; i++ ) {
+        const lnA_OptionDef* oDef = &def->options[i];
+        lnA_Option* opt = &par->bOpt[i];
+        *opt = (lnA_Option){ 0 };
+        opt->sForm    = oDef->sf;
+        opt->lForm    = oDef->lf;
+        opt->desc     = oDef->desc;
+        opt->callback = oDef->cb;
+        linkOption( par, opt );
+    }
+    for( unsigned i = 0 ; i < pCount ; i++ ) {
+        const lnA_ParamDef* pDef = &def->params[i];
+        lnA_Param* prm = &par->bPrm[i];
+        *prm = (lnA_Param){ 0 };
+        prm->name     = pDef->name;
+        prm->callback = pDef->cb;
+        prm->slice    = pDef->slice;
+        prm->val      = pDef->val;
+        linkParam( par, prm );
+    }
+    return par;
+}
+
+int
+lnA_addCommand( lnA_Parser* par, char* name, char* desc, lnA_CommandCb make ) {
+    lnA_Command* cmd = mAlloc( par, sizeof(lnA_Command) );
+    *cmd = (lnA_Command){ 0 };
+    cmd->name = name;
+    cmd->nLen = strlen( name );
+    cmd->desc = desc;
+    cmd->make = make;
+    cmd->id   = par->cList ? par->cList->id + 1 : 0;
+    cmd->next = par->cList;
+    par->cList = cmd;
+    par->hCols = 0;
+    addName( par, &par->cTable, &par->cCap, &par->cCount, name, cmd->nLen, cmd );
+    return cmd->id;
+}
+
+void
+lnA_setFlags( lnA_Parser* par, unsigned flags ) {
+    par->flags = flags;
+}
+
+void
+lnA_setLimits( lnA_Parser* par, unsigned long steps, unsigned depth ) {
+    par->sMax = steps;
+    par->dMax = depth;
 }
 
 void
 lnA_setHeader( lnA_Parser* par, char* header ) {
     par->hText = header;
+    par->hCols = 0;
 }
 
 void
 lnA_setFooter( lnA_Parser* par, char* footer ) {
     par->fText = footer;
+    par->hCols = 0;
 }
 
-void
-lnA_printUsage( lnA_Parser* par ) {
-    printf( "Usage:\n" );
-    lnA_Usage* uIt = par->uList;
-    while( uIt ) {
-        printf( "  %s %s\n", par->pName, uIt->usage );
-        uIt = uIt->next;
-    }
+static int
+parseUsage( lnA_Context* ctx );
+
+static void
+tokenize( lnA_Context* ctx, char** argv );
+
+static void
+openArgs( lnA_Context* ctx, lnA_Source* src );
+
+static char*
+errorText( lnA_Context* ctx, lnA_Error* err );
+
+static void
+clearMatches( lnA_Context* ctx );
+
+// Resets what's kept for a single parse
+static void
+beginParse( lnA_Context* ctx ) {
+    scratchReset( ctx );
+    clearMatches( ctx );
+    ctx->steps = 0;
+    ctx->halt  = false;
+}
+
+char*
+lnA_tryUsageCtx( lnA_Context* ctx, lnA_Usage* usg, char** argv ) {
+    if( lnA_matchUsageCtx( ctx, usg, argv ) )
+        return errorText( ctx, &ctx->err );
+    return NULL;
+}
+
+int
+lnA_matchUsageCtx( lnA_Context* ctx, lnA_Usage* usg, char** argv ) {
+    beginParse( ctx );
+    tokenize( ctx, argv );
+    ctx->uNow = usg;
+    ctx->aIdx = 0;
+    ctx->err  = (lnA_Error){ 0 };
     
-    putchar( '\n' );
+    return parseUsage( ctx );
+}
+
+int
+lnA_matchSourceCtx( lnA_Context* ctx, lnA_Usage* usg, lnA_Source* src ) {
+    beginParse( ctx );
+    openArgs( ctx, src );
+    ctx->uNow = usg;
+    ctx->aIdx = 0;
+    ctx->err  = (lnA_Error){ 0 };
     
-    if( par->hText )
-        printf( "%s\n\n", par->hText );
-        
+    int err = parseUsage( ctx );
+    ctx->src = NULL;
+    return err;
+}
+
+const lnA_Error*
+lnA_getErrorCtx( lnA_Context* ctx ) {
+    return &ctx->err;
+}
+
+unsigned long
+lnA_stepsUsedCtx( lnA_Context* ctx ) {
+    return ctx->steps;
+}
+
+unsigned long
+lnA_stepsUsed( lnA_Parser* par ) {
+    return lnA_stepsUsedCtx( parCtx( par ) );
+}
+
+char*
+lnA_errorTextCtx( lnA_Context* ctx ) {
+    if( !ctx->err.code )
+        return NULL;
+    return errorText( ctx, &ctx->err );
+}
+
+char*
+lnA_tryUsage( lnA_Parser* par, lnA_Usage* usg, char** argv ) {
+    return lnA_tryUsageCtx( parCtx( par ), usg, argv );
+}
+
+int
+lnA_matchUsage( lnA_Parser* par, lnA_Usage* usg, char** argv ) {
+    return lnA_matchUsageCtx( parCtx( par ), usg, argv );
+}
+
+int
+lnA_matchSource( lnA_Parser* par, lnA_Usage* usg, lnA_Source* src ) {
+    return lnA_matchSourceCtx( parCtx( par ), usg, src );
+}
+
+const lnA_Error*
+lnA_getError( lnA_Parser* par ) {
+    return lnA_getErrorCtx( parCtx( par ) );
+}
+
+char*
+lnA_errorText( lnA_Parser* par ) {
+    return lnA_errorTextCtx( parCtx( par ) );
+}
+
+char*
+lnA_tryAll( lnA_Parser* par, char** argv, lnA_Usage** match ) {
+    return lnA_tryAllCtx( parCtx( par ), argv, match );
+}
+
+char*
+lnA_matchError( lnA_Parser* par, lnA_Usage* usg ) {
+    return lnA_matchErrorCtx( parCtx( par ), usg );
+}
+
+static lnA_Command*
+findCommand( lnA_Parser* par, char* name );
+
+lnA_Parser*
+lnA_getCommand( lnA_Parser* par, char* name ) {
+    lnA_Command* cmd = findCommand( par, name );
+    if( !cmd )
+        return NULL;
     
-    printf( "Options:\n" );
-    lnA_Option* oIt = par->oList;
-    while( oIt ) {
-        if( oIt->sForm && oIt->lForm )
-            printf( "-%s, --%s\n", oIt->sForm, oIt->lForm );
-        else
-        if( oIt->sForm )
-            printf( "-%s\n", oIt->sForm );
-        else
-        if( oIt->lForm )
-            printf( "--%s\n", oIt->lForm );
+    // A command whose parser couldn't be made
+    // is tried again the next time
+    if( !cmd->child ) {
+        lnA_Parser* child = cmd->make( cmd->name, par->udata );
         
-        unsigned len = strlen( oIt->desc );
-        unsigned idx = 0;
-        while( idx < len ) {
-            printf( "  %.*s", lnA_MAX_DESC_WIDTH, &oIt->desc[idx] );
-            idx += lnA_MAX_DESC_WIDTH;
-        }
-        printf( "\n\n" );
-        oIt = oIt->next;
+        // A parser shared with another command, or the parent
+        // itself, is freed by whoever had it first
+        bool owns = child && child != par;
+        for( lnA_Command* cIt = par->cList ; cIt && owns ; cIt = cIt->next )
+            owns = cIt->child != child;
+        cmd->child = child;
+        cmd->owns  = owns;
     }
-    
-    if( par->fText )
-        printf( "%s\n\n", par->fText );
+    return cmd->child;
 }
 
-static char*
-parseUsage( lnA_Parser* par );
-
 char*
-lnA_tryUsage( lnA_Parser* par, lnA_Usage* usg, char** argv ) {
-    par->uNow = usg;
-    par->uIdx = 0;
-    par->argv = argv;
-    par->aIdx = 0;
+lnA_tryCommand( lnA_Parser* par, char** argv, lnA_Parser** cmd, lnA_Usage** match ) {
+    if( cmd )
+        *cmd = NULL;
+    if( match )
+        *match = NULL;
     
-    return parseUsage( par );
+    // Only the command that's used gets its parser made
+    lnA_Parser* child = argv[0] ? lnA_getCommand( par, argv[0] ) : NULL;
+    if( child ) {
+        if( cmd )
+            *cmd = child;
+        return lnA_tryAll( child, &argv[1], match );
+    }
+    
+    // Anything else is for the parser's own usages, if it has any
+    if( cmd )
+        *cmd = par;
+    if( !par->uCount ) {
+        lnA_Context* ctx = parCtx( par );
+        ctx->err = (lnA_Error){ .code = lnA_E_UNKNOWN_COMMAND, .arg = argv[0] };
+        return errorText( ctx, &ctx->err );
+    }
+    return lnA_tryAll( par, argv, match );
 }
 
 
 
-#define uPeek( p ) ((p)->uNow->usage[(p)->uIdx])
-#define uNext( p ) ((p)->uNow->usage[(p)->uIdx++])
-#define uAdv( p )  ((p)->uIdx++)
-#define aPeek( p ) ((p)->argv[(p)->aIdx])
+
+#define uNode( p, i ) (&(p)->uNow->nodes[i])
+#define uText( p, n ) (&(p)->uNow->usage[(n)->uIdx])
+static void
+pullArgs( lnA_Context* ctx, unsigned aIdx );
+
+// Arguments are pulled from a source as the matcher gets to them
+static lnA_Token*
+aTok( lnA_Context* ctx ) {
+    if( ctx->aIdx >= ctx->tEnd )
+        pullArgs( ctx, ctx->aIdx );
+    return &ctx->toks[ctx->aIdx - ctx->tBase];
+}
+
+#define aPeek( p ) (aTok( p )->str)
 #define aAdv( p )  ((p)->aIdx++)
+#define aArg( p, i ) (&(p)->toks[(i) - (p)->tBase])
 
-static char*
-parseThing( lnA_Parser* par );
+static int
+parseSeq( lnA_Context* ctx, unsigned nIdx );
+
+static void*
+scratchGrow( lnA_Context* ctx, void* ptr, size_t old, size_t size );
 
 static void
 queueCallback( 
-    lnA_Parser* par,
+    lnA_Context* ctx,
     void        (*cb)( char* str, void* udata ),
     char*       str
 );
 
 static void
-queueCallbacks( lnA_Parser* par, lnA_Queue* src );
+queueOption( lnA_Context* ctx, lnA_Option* opt, char* form );
+
+static void
+queueParam( lnA_Context* ctx, lnA_Param* prm, unsigned aIdx, char* str, unsigned n );
+
+// Typed parameters store their values instead of invoking callbacks
+#define typed( prm ) ((prm) && (prm)->val.dest)
+
+static bool
+readValue( lnA_Context* ctx, lnA_Value* val, char* str, lnA_Number* num );
+
+static void
+queueValue( lnA_Context* ctx, lnA_Param* prm, unsigned aIdx, char* str, lnA_Number num );
 
 static void
-invokeCallbacks( lnA_Parser* par );
+invokeCallbacks( lnA_Context* ctx );
+
+// Callbacks can be invoked as soon as they're matched
+// when streaming, outside of any group
+#define streaming( p ) (((p)->par->flags & lnA_STREAM) && !(p)->depth && !(p)->quiet && !(p)->hold)
 
 static void
-freeCallbacks( lnA_Parser* par );
+commitCallbacks( lnA_Context* ctx );
 
 static lnA_Param*
 findParam( lnA_Parser* par, char* name, unsigned len );
@@ -224,33 +871,345 @@ findOptionLong( lnA_Parser* par, char* name, unsigned len );
 static lnA_Option*
 findOptionShort( lnA_Parser* par, char name );
 
-static char*
-error( lnA_Parser* par, char* fmt, ... );
+// Records a failure to match, the message is
+// only formatted if someone asks for it
+static int
+fail( lnA_Context* ctx, int code, unsigned uIdx, unsigned uLen, char chr ) {
+    ctx->err = (lnA_Error){
+        .code = code,
+        .usg  = ctx->uNow,
+        .uIdx = uIdx,
+        .uLen = uLen,
+        .aIdx = ctx->aIdx,
+        .arg  = aPeek( ctx ),
+        .chr  = chr
+    };
+    return code;
+}
 
-static char*
-validate( lnA_Parser* par );
+static int
+memoUsage( lnA_Context* ctx );
 
-static char*
-parseUsage( lnA_Parser* par ) {
-    char* err = validate( par );
-    if( err )
-        return err;
-    
-    lnA_Queue q = { 0 };
-    par->qNow = &q;
-    
-    while( uPeek( par ) != '\0' ) {
-        err = parseThing( par );
-        if( err )
-            return err;
-    }
-    
-    if( aPeek( par ) ) {
-        return error( par, "Extra or unmatched word '%s'", aPeek( par ) );
-    }
-    invokeCallbacks( par );
-    freeCallbacks( par );
-    return NULL;
+// A source that failed ended the arguments early,
+// so whatever matched them can't be trusted
+static bool
+sourceFailed( lnA_Context* ctx ) {
+    return ctx->src && ctx->src->error && ctx->src->error( ctx->src->ctx );
+}
+
+// Usages that nest groups deeper than the limit aren't
+// matched at all, so matching can't run out of stack
+#define tooDeep( p, u ) ((p)->par->dMax && (u)->nest > (p)->par->dMax)
+
+// Counts a step of matching; once the budget runs out the
+// parse halts, and every match in progress fails with it
+static bool
+step( lnA_Context* ctx, lnA_Node* node ) {
+    if( ctx->halt )
+        return true;
+    
+    ctx->steps++;
+    if( ctx->par->sMax && ctx->steps > ctx->par->sMax ) {
+        fail( ctx, lnA_E_STEP_LIMIT, node->uIdx, node->uLen, 0 );
+        ctx->halt = true;
+    }
+    return ctx->halt;
+}
+
+static int
+parseUsage( lnA_Context* ctx ) {
+    // Malformed usages were reported when compiled
+    if( ctx->uNow->eText ) {
+        ctx->err = ctx->uNow->cErr;
+        return ctx->err.code;
+    }
+    if( tooDeep( ctx, ctx->uNow ) )
+        return fail( ctx, lnA_E_DEPTH_LIMIT, 0, 0, 0 );
+    
+    if( ctx->par->flags & lnA_MEMOIZE )
+        return memoUsage( ctx );
+    
+    ctx->qLen = 0;
+    int err = parseSeq( ctx, uNode( ctx, 0 )->child );
+    if( !err && aPeek( ctx ) )
+        err = fail( ctx, lnA_E_EXTRA_WORD, 0, 0, 0 );
+    if( sourceFailed( ctx ) )
+        err = fail( ctx, lnA_E_SOURCE_FAILED, 0, 0, 0 );
+    
+    if( !err ) {
+        invokeCallbacks( ctx );
+        ctx->err = (lnA_Error){ 0 };
+        if( ctx->out )
+            ctx->out->usg = ctx->uNow;
+    }
+    ctx->qLen = 0;
+    return err;
+}
+
+static bool
+recognize( lnA_Context* ctx, unsigned* fail );
+
+static int
+failAt( lnA_Context* ctx, unsigned nIdx );
+
+static int
+memoEmit( lnA_Context* ctx );
+
+// Matches each usage in the order they were added, recording
+// why each one failed.  The journal is rolled back after each
+// usage that fails, so it ends up with the winner's callbacks
+// (unless memoized, or quiet).  Returns the first usage to
+// match, or NULL with the error of the one that got the farthest
+static lnA_Usage*
+recognizeAll( lnA_Context* ctx ) {
+    lnA_Parser* par = ctx->par;
+    if( par->uCount > ctx->ueCap ) {
+        ctx->uErr  = mResize( par, ctx->uErr, ctx->ueCap*sizeof(lnA_Error), par->uCount*sizeof(lnA_Error) );
+        ctx->ueCap = par->uCount;
+    }
+    
+    lnA_Usage* best = NULL;
+    lnA_Usage* won  = NULL;
+    for( unsigned i = 0 ; i < par->uCount ; i++ ) {
+        lnA_Usage* usg = par->uVec[i];
+        ctx->uErr[i] = (lnA_Error){ 0 };
+        if( won || ctx->halt )
+            continue;
+        
+        ctx->uNow = usg;
+        ctx->aIdx = 0;
+        if( usg->eText ) {
+            ctx->uErr[i] = usg->cErr;
+            if( !best )
+                best = usg;
+            continue;
+        }
+        if( tooDeep( ctx, usg ) ) {
+            fail( ctx, lnA_E_DEPTH_LIMIT, 0, 0, 0 );
+            ctx->uErr[i] = ctx->err;
+            if( !best )
+                best = usg;
+            continue;
+        }
+        
+        unsigned nIdx;
+        ctx->qLen = 0;
+        if( recognize( ctx, &nIdx ) ) {
+            won = usg;
+            continue;
+        }
+        
+        // Running out of steps ends the whole parse, so
+        // the usages after this one aren't tried
+        ctx->qLen = 0;
+        if( !ctx->halt )
+            failAt( ctx, nIdx );
+        ctx->uErr[i] = ctx->err;
+        if( !best || best->eText || tooDeep( ctx, best ) || ctx->halt ||
+            ctx->err.aIdx > ctx->uErr[best->id].aIdx )
+            best = usg;
+    }
+    
+    if( !won ) {
+        ctx->uNow = NULL;
+        ctx->aIdx = 0;
+        if( best )
+            ctx->err = ctx->uErr[best->id];
+        else
+            fail( ctx, lnA_E_NO_USAGES, 0, 0, 0 );
+    }
+    return won;
+}
+
+char*
+lnA_tryAllCtx( lnA_Context* ctx, char** argv, lnA_Usage** match ) {
+    beginParse( ctx );
+    tokenize( ctx, argv );
+    if( match )
+        *match = NULL;
+    
+    // Nothing can be invoked until a usage has matched
+    ctx->hold = true;
+    lnA_Usage* won = recognizeAll( ctx );
+    ctx->hold = false;
+    if( !won )
+        return errorText( ctx, &ctx->err );
+    
+    // The journal has the winner's callbacks, or with
+    // memoization they're queued from its memo table
+    ctx->err = (lnA_Error){ 0 };
+    if( ctx->par->flags & lnA_MEMOIZE ) {
+        if( memoEmit( ctx ) ) {
+            ctx->uErr[won->id] = ctx->err;
+            return errorText( ctx, &ctx->err );
+        }
+    }
+    else {
+        invokeCallbacks( ctx );
+        ctx->qLen = 0;
+        if( ctx->out )
+            ctx->out->usg = won;
+    }
+    
+    if( match )
+        *match = won;
+    return NULL;
+}
+
+char*
+lnA_matchErrorCtx( lnA_Context* ctx, lnA_Usage* usg ) {
+    if( usg->id >= ctx->ueCap || !ctx->uErr[usg->id].code )
+        return NULL;
+    return errorText( ctx, &ctx->uErr[usg->id] );
+}
+
+// Vectors are handed out in chunks of this many
+#define lnA_BATCH_CHUNK (64)
+
+// Each batch worker owns a range of the vectors and takes
+// chunks from its front; once its range is empty it steals
+// the back half of another worker's range
+typedef struct lnA_Range {
+    pthread_mutex_t lock;
+    size_t          lo;   // Next vector to take
+    size_t          hi;   // End of the range
+} lnA_Range;
+
+typedef struct lnA_Worker {
+    struct lnA_Batch* bat;     // Batch being matched
+    unsigned          id;      // Index of the worker's range
+    lnA_Context*      ctx;     // Context for the worker's thread
+    size_t            matched; // Vectors the worker matched
+    bool              thread;  // Started in its own thread
+    pthread_t         tid;     // That thread
+} lnA_Worker;
+
+typedef struct lnA_Batch {
+    char***     argvs;   // Argument vectors being matched
+    lnA_Result* res;     // Result for each vector
+    lnA_Range*  ranges;  // Range of each worker
+    unsigned    wCount;  // Number of workers
+} lnA_Batch;
+
+static bool
+takeChunk( lnA_Range* rng, size_t* lo, size_t* hi ) {
+    pthread_mutex_lock( &rng->lock );
+    *lo = rng->lo;
+    *hi = rng->hi - rng->lo > lnA_BATCH_CHUNK ? rng->lo + lnA_BATCH_CHUNK : rng->hi;
+    rng->lo = *hi;
+    pthread_mutex_unlock( &rng->lock );
+    return *lo < *hi;
+}
+
+// Moves half of the first other range that has anything
+// left into the worker's own range, which is empty.  Only
+// one lock is held at a time
+static bool
+stealRange( lnA_Batch* bat, unsigned id ) {
+    for( unsigned i = 1 ; i < bat->wCount ; i++ ) {
+        lnA_Range* vic = &bat->ranges[(id + i) % bat->wCount];
+        pthread_mutex_lock( &vic->lock );
+        size_t hi  = vic->hi;
+        size_t mid = vic->lo + (vic->hi - vic->lo)/2;
+        vic->hi = mid;
+        pthread_mutex_unlock( &vic->lock );
+        if( mid == hi )
+            continue;
+        
+        lnA_Range* own = &bat->ranges[id];
+        pthread_mutex_lock( &own->lock );
+        own->lo = mid;
+        own->hi = hi;
+        pthread_mutex_unlock( &own->lock );
+        return true;
+    }
+    return false;
+}
+
+static void*
+batchWork( void* arg ) {
+    lnA_Worker* wrk = arg;
+    lnA_Batch*  bat = wrk->bat;
+    lnA_Context* ctx = wrk->ctx;
+    
+    size_t lo, hi;
+    while( takeChunk( &bat->ranges[wrk->id], &lo, &hi ) || stealRange( bat, wrk->id ) ) {
+        for( size_t i = lo ; i < hi ; i++ ) {
+            beginParse( ctx );
+            tokenize( ctx, bat->argvs[i] );
+            
+            // Nothing is invoked, so nothing needs queueing
+            lnA_Result* res = &bat->res[i];
+            ctx->quiet = true;
+            res->usg = recognizeAll( ctx );
+            ctx->quiet = false;
+            res->err = res->usg ? (lnA_Error){ 0 } : ctx->err;
+            if( res->usg )
+                wrk->matched++;
+        }
+    }
+    return NULL;
+}
+
+size_t
+lnA_tryBatch( lnA_Parser* par, char*** argvs, size_t n, unsigned workers, lnA_Result* res ) {
+    if( !workers ) {
+        long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+        workers = cpus > 0 ? cpus : 1;
+    }
+    if( workers > n )
+        workers = n ? n : 1;
+    
+    lnA_Batch bat = {
+        .argvs  = argvs,
+        .res    = res,
+        .ranges = mAlloc( par, workers*sizeof(lnA_Range) ),
+        .wCount = workers
+    };
+    lnA_Worker* wrks = mAlloc( par, workers*sizeof(lnA_Worker) );
+    for( unsigned i = 0 ; i < workers ; i++ ) {
+        lnA_Range* rng = &bat.ranges[i];
+        pthread_mutex_init( &rng->lock, NULL );
+        rng->lo = n*i/workers;
+        rng->hi = n*(i + 1)/workers;
+        
+        wrks[i] = (lnA_Worker){ .bat = &bat, .id = i };
+        wrks[i].ctx = lnA_makeContext( par, par->udata );
+    }
+    
+    // The calling thread is the first worker, the ranges
+    // of any threads that can't be started get stolen
+    for( unsigned i = 1 ; i < workers ; i++ )
+        wrks[i].thread = !pthread_create( &wrks[i].tid, NULL, &batchWork, &wrks[i] );
+    batchWork( &wrks[0] );
+    
+    size_t matched = 0;
+    for( unsigned i = 0 ; i < workers ; i++ ) {
+        if( wrks[i].thread )
+            pthread_join( wrks[i].tid, NULL );
+        matched += wrks[i].matched;
+        lnA_freeContext( wrks[i].ctx );
+        pthread_mutex_destroy( &bat.ranges[i].lock );
+    }
+    mFree( par, wrks, workers*sizeof(lnA_Worker) );
+    mFree( par, bat.ranges, workers*sizeof(lnA_Range) );
+    return matched;
+}
+
+void
+lnA_replayBatch( lnA_Parser* par, char*** argvs, size_t n, lnA_Result* res ) {
+    lnA_Context* ctx = parCtx( par );
+    for( size_t i = 0 ; i < n ; i++ ) {
+        if( res[i].usg )
+            lnA_matchUsageCtx( ctx, res[i].usg, argvs[i] );
+    }
+}
+
+char*
+lnA_resultText( lnA_Parser* par, lnA_Result* res ) {
+    if( !res->err.code )
+        return NULL;
+    return errorText( parCtx( par ), &res->err );
 }
 
 static bool
@@ -263,60 +1222,58 @@ isOptChr( char* c ) {
                 *c != '{' && *c != '}';
 }
 
-static char*
-parseLong( lnA_Parser* par ) {
-    
-    // Find option name end in usage string
-    int   uBrk = 0;
-    char* uStr = &uPeek( par );
-    while( isOptChr( &uStr[uBrk] ) && uStr[uBrk] != '=' )
-        uBrk++;
-    int uLen = uBrk;
-    while( isOptChr( &uStr[uLen] ) )
-        uLen++;
+static int
+parseLong( lnA_Context* ctx, lnA_Node* node ) {
     
-    par->uIdx += uLen;
+    // Option name and parameter in usage string
+    char*    uStr = uText( ctx, node );
+    unsigned uBrk = node->nLen;
+    unsigned uLen = node->uLen;
     
     // Find matching option
-    lnA_Option* opt = findOptionLong( par, uStr, uBrk );
+    lnA_Option* opt = findOptionLong( ctx->par, uStr, uBrk );
     if( !opt )
-        return error( par, "Missing option info" );
+        return fail( ctx, lnA_E_OPTION_INFO, node->uIdx, uBrk, 0 );
     
     // Make sure the argument is provided and is an option
-    char* arg = aPeek( par );
-    if( !arg || arg[0] != '-' || arg[1] != '-'  )
-        return error( par, "Missing --%s option", opt->lForm );
-    
-    // Find option name end in argument string
-    int   aBrk = 0;
-    char* aStr = &arg[2];
-    while( isgraph( aStr[aBrk] ) && aStr[aBrk] != '=' )
-        aBrk++;
+    lnA_Token* tok = aTok( ctx );
+    if( tok->kind < lnA_A_LONG )
+        return fail( ctx, lnA_E_MISSING_OPTION, node->uIdx, uBrk, 0 );
     
     // Make sure the two names match
-    if( aBrk != uBrk || strncmp( aStr, uStr, aBrk ) )
-        return error( par, "Missing --%s option", opt->lForm );
+    if( tok->nLen != uBrk || memcmp( &tok->str[2], uStr, uBrk ) )
+        return fail( ctx, lnA_E_MISSING_OPTION, node->uIdx, uBrk, 0 );
     
     // If usage string doesn't show option parameter
     // then the argument string shouldn't provide one
-    if( uStr[uBrk] != '=' && aStr[aBrk] == '=' )
-        return error( par, "Unexpected argument for --%s option", opt->lForm );
+    if( uStr[uBrk] != '=' && tok->kind == lnA_A_VALUE )
+        return fail( ctx, lnA_E_UNEXPECTED_VALUE, node->uIdx, uBrk, 0 );
     
     // If an option argument is expected then the
     // argument string should provide one
-    if( uStr[uBrk] == '=' && aStr[aBrk] != '=' )
-        return error( par, "Missing argument for --%s option", opt->lForm );
+    if( uStr[uBrk] == '=' && tok->kind != lnA_A_VALUE )
+        return fail( ctx, lnA_E_MISSING_VALUE, node->uIdx, uBrk, 0 );
+    
+    // Values of typed parameters are checked before anything's queued
+    lnA_Param* prm = NULL;
+    lnA_Number num = { 0 };
+    char*      val = &tok->str[tok->vOff];
+    if( uStr[uBrk] == '=' ) {
+        prm = findParam( ctx->par, &uStr[uBrk+1], uLen - uBrk - 1 );
+        if( typed( prm ) && !readValue( ctx, &prm->val, val, &num ) )
+            return fail( ctx, lnA_E_BAD_VALUE, node->uIdx + uBrk + 1, uLen - uBrk - 1, 0 );
+    }
     
     // Queue callbacks, will be called only if
     // unit completes without errors
-    if( opt->callback )
-        queueCallback( par, opt->callback, opt->lForm );
-    lnA_Param* prm = findParam( par, &uStr[uBrk+1], uLen - uBrk - 1 );
-    if( prm && prm->callback )
-        queueCallback( par, prm->callback, &aStr[aBrk+1] );
+    queueOption( ctx, opt, opt->lForm );
+    if( typed( prm ) )
+        queueValue( ctx, prm, ctx->aIdx, val, num );
+    else
+        queueParam( ctx, prm, ctx->aIdx, val, 1 );
     
-    aAdv( par );
-    return NULL;
+    aAdv( ctx );
+    return lnA_OK;
 }
 
 static bool
@@ -328,390 +1285,3336 @@ contains( char* str, unsigned len, char chr ) {
     return false;
 }
 
-static char*
-parseShort( lnA_Parser* par ) {
+static int
+parseShort( lnA_Context* ctx, lnA_Node* node ) {
     
     // Allowed flags
-    char* fStr = &uPeek( par );
-    int   fLen = 0;
-    while( isOptChr( &fStr[fLen] ) )
-        fLen++;
-    par->uIdx += fLen;
+    char* fStr = uText( ctx, node );
+    int   fLen = node->uLen;
     
     // Make sure the argument is provided and is an option
-    char* arg = aPeek( par );
-    if( !arg || arg[0] != '-' || arg[1] == '-' || !isgraph( arg[1] ) )
-        return error( par, "Missing -%.*s flag(s)", fLen, fStr );
-    
-    char* aChr = &arg[1];
-    while( *aChr ) {
-        if( !contains( fStr, fLen, *aChr ) )
-            return error( par, "Invalid flag '%c' for -%.*s flag(s)", *aChr, fLen, fStr );
-        aChr++;
-    }
-    aChr = &arg[1];
-    while( *aChr ) {
+    lnA_Token* tok = aTok( ctx );
+    if( tok->kind != lnA_A_SHORT )
+        return fail( ctx, lnA_E_MISSING_FLAG, node->uIdx, fLen, 0 );
+    
+    char* aStr = &tok->str[1];
+    for( unsigned i = 0 ; i < tok->nLen ; i++ ) {
+        if( !contains( fStr, fLen, aStr[i] ) )
+            return fail( ctx, lnA_E_INVALID_FLAG, node->uIdx, fLen, aStr[i] );
+    }
+    for( unsigned i = 0 ; i < tok->nLen ; i++ ) {
         // Queue option callback if provided
-        lnA_Option* opt = findOptionShort( par, *aChr );
+        lnA_Option* opt = findOptionShort( ctx->par, aStr[i] );
         if( !opt )
-            return error( par, "Missing option info" );
-        if( opt->callback )
-            queueCallback( par, opt->callback, opt->sForm );
-        aChr++;
+            return fail( ctx, lnA_E_OPTION_INFO, node->uIdx, fLen, aStr[i] );
+        queueOption( ctx, opt, opt->sForm );
     }
     
-    aAdv( par );
-    return NULL;
-}
-
-static char*
-parseParam( lnA_Parser* par ) {
-    char*    uStr = &uPeek( par );
-    unsigned uLen = 0;
-    while( isOptChr( &uStr[uLen] ) )
-        uLen++;
-    par->uIdx += uLen;
-    
-    char* arg = aPeek( par );
-    if( !arg || arg[0] == '-' )
-        return error( par, "Missing %.*s parameter", uLen, uStr );
-    
-    lnA_Param* prm = findParam( par, uStr, uLen );
-    if( prm && prm->callback )
-        queueCallback( par, prm->callback, arg );
-    
-    aAdv( par );
-    return NULL;
+    aAdv( ctx );
+    return lnA_OK;
 }
 
-static void
-exitGroup( lnA_Parser* par, char open, char close ) {
-    while( uPeek( par ) != close ) {
-        char c = uNext( par );
-        if( c == open )
-            exitGroup( par, open, close );
+static int
+parseParam( lnA_Context* ctx, lnA_Node* node ) {
+    char*    uStr = uText( ctx, node );
+    unsigned uLen = node->uLen;
+    
+    lnA_Token* tok = aTok( ctx );
+    if( tok->kind != lnA_A_PARAM )
+        return fail( ctx, lnA_E_MISSING_PARAM, node->uIdx, uLen, 0 );
+    
+    lnA_Param* prm = findParam( ctx->par, uStr, uLen );
+    if( typed( prm ) ) {
+        lnA_Number num;
+        if( !readValue( ctx, &prm->val, tok->str, &num ) )
+            return fail( ctx, lnA_E_BAD_VALUE, node->uIdx, uLen, 0 );
+        queueValue( ctx, prm, ctx->aIdx, tok->str, num );
     }
+    else
+        queueParam( ctx, prm, ctx->aIdx, NULL, 1 );
     
-    // Skip terminating bracket
-    uAdv( par );
+    aAdv( ctx );
+    return lnA_OK;
 }
 
-static char*
-parseGroup( lnA_Parser* par, char open, char close ) {
-    
-    char* uStart = &uPeek( par ) - 1;
-
-    // Replace the current callback queue with
-    // one local to the current group, this allows
-    // us to discard local callbacks for a failed
-    // match while maintaining those for previous
-    // successful matches
-    lnA_Queue* oldQ = par->qNow;
-    lnA_Queue  newQ = { 0 };
-    par->qNow = &newQ;
-    
-    char* err;
-again:
-    // Parse all words/things in the current alternative
-    err = NULL;
-    while( !err && uPeek( par ) != '|' && uPeek( par ) != close ) {
-        if( uPeek( par ) == '\0' )
-            return error( par, "Unterminated group" );
-        err = parseThing( par );
-    }
-    
-    // If the match was successful then merge the
-    // parent and local queues
-    if( !err ) {
-        // Skip everything until (and including) the closing bracket
-        exitGroup( par, open, close );
-        
-        // Restore the old queue and merge it with the new one
-        par->qNow = oldQ;
-        queueCallbacks( par, &newQ );
-        
-        return NULL;
-    }
+// Matches a repeated parameter with one scan over the
+// arguments, queueing them as one slice if the parameter
+// takes slices.  The scan stops at the first argument that
+// isn't a valid value of a typed parameter
+static int
+parseParams( lnA_Context* ctx, lnA_Node* node ) {
+    char*    uStr = uText( ctx, node );
+    unsigned uLen = node->uLen;
     
-    // If match fails then clear the queued callbacks
-    freeCallbacks( par );
+    // No need to queue what can't be undone, so when streaming
+    // each argument is passed on as soon as it's scanned
+    lnA_Param* prm = findParam( ctx->par, uStr, uLen );
+    bool       now = prm && !prm->slice && prm->callback && !ctx->out && streaming( ctx );
+    if( now )
+        commitCallbacks( ctx );
     
-    // Skip until '[' or '|'
-    while( uPeek( par ) != ']' && uPeek( par ) != '|' )
-        uAdv( par );
-    
-    // If match fails but a '|' indicates a following
-    // alternative then try again with the new form
-    if( uPeek( par ) == '|' ) {
-        uAdv( par );
-        goto again;
+    // Each argument scanned is a step, rescanning long
+    // runs of parameters is where backtracking gets slow
+    unsigned aIdx = ctx->aIdx;
+    while( aTok( ctx )->kind == lnA_A_PARAM ) {
+        if( step( ctx, node ) )
+            return ctx->err.code;
+        if( typed( prm ) ) {
+            lnA_Number num;
+            if( !readValue( ctx, &prm->val, aPeek( ctx ), &num ) )
+                break;
+            queueValue( ctx, prm, ctx->aIdx, aPeek( ctx ), num );
+        }
+        if( now ) {
+            prm->callback( aTok( ctx )->str, ctx->udata );
+            ctx->tKeep = ctx->aIdx + 1;
+        }
+        aAdv( ctx );
     }
     
-    // Restore old callback queue
-    par->qNow = oldQ;
-    
-    // Skip the closing bracket
-    uAdv( par );
+    unsigned n = ctx->aIdx - aIdx;
+    if( !n && aTok( ctx )->kind == lnA_A_PARAM )
+        return fail( ctx, lnA_E_BAD_VALUE, node->uIdx, uLen, 0 );
+    if( !n )
+        return fail( ctx, lnA_E_MISSING_PARAM, node->uIdx, uLen, 0 );
     
-    // Return error
-    {
-        char* uEnd = &uPeek( par ) + 1;
-        int   uLen = uEnd - uStart;
-        return error( par, "Missing group %.*s", uLen, uStart );
-    }
+    if( !now && !typed( prm ) )
+        queueParam( ctx, prm, aIdx, NULL, n );
+    return lnA_OK;
 }
 
-static char*
-parseThing( lnA_Parser* par ) {
-    // Skip whitespace
-    while( isspace( uPeek( par ) ) )
-        uAdv( par );
-    
-    // Parse unit
-    unsigned uStart = par->uIdx;
-    bool parsedOne = false;
-    char* err = NULL;
-again:
-    switch( uPeek( par ) ) {
-        case '-':
-            uAdv( par );
-            if( uPeek( par ) == '-' ) {
-                uAdv( par );
-                err = parseLong( par );
-            }
-            else {
-                err = parseShort( par );
-            }
-        break;
-        case '[':
-            uAdv( par );
-            err = parseGroup( par, '[', ']' );
-            parsedOne = true;
-        break;
-        case '{':
-            uAdv( par );
-            err = parseGroup( par, '{', '}' );
-        break;
+// Returns the token bit for the next argument, or -1 if
+// it can't start any node in the current usage
+static int
+nextToken( lnA_Context* ctx ) {
+    lnA_Token* tok = aTok( ctx );
+    switch( tok->kind ) {
+        case lnA_A_END:
+            return lnA_T_END;
+        case lnA_A_PARAM:
+            return lnA_T_PARAM;
+        case lnA_A_SHORT:
+            return lnA_T_SHORT + (unsigned char)tok->str[1];
+        case lnA_A_OTHER:
+            return -1;
         default:
-            err = parseParam( par );
         break;
     }
-    char* end = &uPeek( par );
-    if( end[0] == '.' && end[1] == '.' && end[2] == '.' ) {
-        if( !err ) {
-            par->uIdx = uStart;
-            parsedOne = true;
-            goto again;
+    
+    for( unsigned i = 0 ; i < ctx->uNow->lCount ; i++ ) {
+        lnA_Node* node = uNode( ctx, ctx->uNow->lNode[i] );
+        if( node->nLen == tok->nLen && !memcmp( uText( ctx, node ), &tok->str[2], tok->nLen ) )
+            return lnA_T_LONG + i;
+    }
+    return -1;
+}
+
+// Checks if the given token can start a match of the node
+static bool
+canStart( lnA_Context* ctx, unsigned nIdx, int tok ) {
+    if( uNode( ctx, nIdx )->null )
+        return true;
+    if( tok < 0 )
+        return false;
+    uint64_t* set = &ctx->uNow->first[nIdx*ctx->uNow->fWords];
+    return set[tok/64] >> (tok%64) & 1;
+}
+
+static int
+parseThing( lnA_Context* ctx, unsigned nIdx );
+
+static int
+parseGroup( lnA_Context* ctx, lnA_Node* node ) {
+
+    // Remember where the journal ends, this allows
+    // us to discard callbacks for a failed match
+    // while keeping those of previous successful
+    // matches
+    unsigned qLen = ctx->qLen;
+    
+    // Try each alternative in order, the first one
+    // to match wins; alternatives that can't start
+    // with the next argument are skipped
+    unsigned aIdx = ctx->aIdx;
+    unsigned alt  = node->child;
+    int      tok  = nextToken( ctx );
+    while( alt ) {
+        if( !canStart( ctx, alt, tok ) ) {
+            alt = uNode( ctx, alt )->next;
+            continue;
         }
         
-        par->uIdx += 3;
+        if( !parseSeq( ctx, uNode( ctx, alt )->child ) )
+            return lnA_OK;
+        if( ctx->halt )
+            return ctx->err.code;
+        
+        // If match fails then drop the queued callbacks
+        // and rewind to try the next alternative
+        ctx->qLen = qLen;
+        ctx->aIdx = aIdx;
+        alt = uNode( ctx, alt )->next;
     }
+    
+    return fail( ctx, lnA_E_MISSING_GROUP, node->uIdx, node->uLen, 0 );
+}
 
-    // Skip whitespace
-    while( isspace( uPeek( par ) ) )
-        uAdv( par );
+static int
+parseThing( lnA_Context* ctx, unsigned nIdx ) {
+    lnA_Node* node = uNode( ctx, nIdx );
+    if( node->kind == lnA_PARAM && node->rep )
+        return step( ctx, node ) ? ctx->err.code : parseParams( ctx, node );
+    
+    // Optional groups always match, sequences
+    // match once one repetition has matched
+    bool parsedOne = node->kind == lnA_OPTIONAL;
+    int  err       = lnA_OK;
+    for( ;; ) {
+        if( step( ctx, node ) )
+            return ctx->err.code;
+        
+        unsigned aIdx = ctx->aIdx;
+        switch( node->kind ) {
+            case lnA_PARAM:
+                err = parseParam( ctx, node );
+            break;
+            case lnA_SHORT:
+                err = parseShort( ctx, node );
+            break;
+            case lnA_LONG:
+                err = parseLong( ctx, node );
+            break;
+            default:
+                ctx->depth++;
+                err = parseGroup( ctx, node );
+                ctx->depth--;
+            break;
+        }
+        if( ctx->halt )
+            return ctx->err.code;
+        
+        // Matches outside of any group are never undone
+        if( !err && streaming( ctx ) )
+            commitCallbacks( ctx );
+        
+        // Stop repeating once a match fails or stops
+        // consuming arguments
+        if( err || !node->rep || ctx->aIdx == aIdx )
+            break;
+        parsedOne = true;
+    }
     
     if( parsedOne )
-        return NULL;
+        return lnA_OK;
     else
         return err;
 }
 
+static int
+parseSeq( lnA_Context* ctx, unsigned nIdx ) {
+    while( nIdx ) {
+        int err = parseThing( ctx, nIdx );
+        if( err )
+            return err;
+        nIdx = uNode( ctx, nIdx )->next;
+    }
+    return lnA_OK;
+}
 
-static void
-queueCallback( 
-    lnA_Parser* par,
-    void        (*cb)( char* str, void* udata ),
-    char*       str
-) {
-    lnA_Queued* c = malloc(sizeof(lnA_Queued));
-    c->callback = cb;
-    c->str = str;
-    c->next = NULL;
-    if( par->qNow->last ) {
-        par->qNow->last->next = c;
-        par->qNow->last = c;
+// Memoized matching works in two passes.  The first only
+// recognizes, filling the memo table with the end of each
+// node matched at each argument index; since every node is
+// matched at most once per index this takes linear time.
+// If the usage matches then the second pass walks the table
+// along the winning path to queue the callbacks.
+#define mAt( p, n, a ) (&(p)->memo[(n)*((p)->aCount + 1) + (a)])
+
+static int
+memoThing( lnA_Context* ctx, unsigned nIdx, unsigned aIdx );
+
+static int
+memoSeq( lnA_Context* ctx, unsigned nIdx, unsigned aIdx ) {
+    int end = aIdx;
+    while( nIdx && end >= 0 ) {
+        end  = memoThing( ctx, nIdx, end );
+        nIdx = uNode( ctx, nIdx )->next;
     }
-    else {
-        par->qNow->first = c;
-        par->qNow->last  = c;
+    return end;
+}
+
+static int
+memoOnce( lnA_Context* ctx, unsigned nIdx, unsigned aIdx ) {
+    lnA_Memo* m = mAt( ctx, nIdx, aIdx );
+    if( m->once )
+        return (int)m->once - 2;
+    
+    lnA_Node* node = uNode( ctx, nIdx );
+    int       err  = lnA_OK;
+    int       end  = -1;
+    if( step( ctx, node ) )
+        return end;
+    
+    ctx->aIdx = aIdx;
+    switch( node->kind ) {
+        case lnA_PARAM:
+            err = parseParam( ctx, node );
+        break;
+        case lnA_SHORT:
+            err = parseShort( ctx, node );
+        break;
+        case lnA_LONG:
+            err = parseLong( ctx, node );
+        break;
+        default: {
+            unsigned alt = node->child;
+            int      tok = nextToken( ctx );
+            while( alt && end < 0 && !ctx->halt ) {
+                if( !canStart( ctx, alt, tok ) ) {
+                    alt = uNode( ctx, alt )->next;
+                    continue;
+                }
+                end = memoSeq( ctx, uNode( ctx, alt )->child, aIdx );
+                if( end >= 0 )
+                    mAt( ctx, nIdx, aIdx )->alt = alt;
+                alt = uNode( ctx, alt )->next;
+            }
+        }
+        break;
     }
+    if( node->kind != lnA_OPTIONAL && node->kind != lnA_REQUIRED )
+        end = err ? -1 : (int)ctx->aIdx;
+    
+    mAt( ctx, nIdx, aIdx )->once = end + 2;
+    return end;
 }
 
-static void
-queueCallbacks( lnA_Parser* par, lnA_Queue* src ) {
-    if( par->qNow->last ) {
-        par->qNow->last->next = src->first;
-        par->qNow->last = src->last;
+static int
+memoThing( lnA_Context* ctx, unsigned nIdx, unsigned aIdx ) {
+    lnA_Memo* m = mAt( ctx, nIdx, aIdx );
+    if( m->thing )
+        return (int)m->thing - 2;
+    
+    lnA_Node* node = uNode( ctx, nIdx );
+    if( node->kind == lnA_PARAM && node->rep ) {
+        if( step( ctx, node ) )
+            return -1;
+        
+        // Every index along the scan repeats to the same end
+        ctx->aIdx = aIdx;
+        int end = parseParams( ctx, node ) ? -1 : (int)ctx->aIdx;
+        for( int at = aIdx ; at < end ; at++ )
+            mAt( ctx, nIdx, at )->thing = end + 2;
+        mAt( ctx, nIdx, aIdx )->thing = end + 2;
+        return end;
     }
-    else {
-        par->qNow->first = src->first;
-        par->qNow->last  = src->last;
+    
+    int end = memoOnce( ctx, nIdx, aIdx );
+    if( end < 0 && node->kind == lnA_OPTIONAL )
+        end = aIdx;
+    else
+    if( end >= 0 && node->rep ) {
+        // Repeat until a match fails, makes no progress, or
+        // reaches an index whose repetition is already known
+        int at = aIdx;
+        while( end >= 0 && end != at && !mAt( ctx, nIdx, end )->thing ) {
+            at  = end;
+            end = memoOnce( ctx, nIdx, at );
+        }
+        if( end >= 0 && end != at )
+            end = (int)mAt( ctx, nIdx, end )->thing - 2;
+        else
+            end = at;
+        
+        // Every index along the way repeats to the same end
+        at = aIdx;
+        while( at != end && !mAt( ctx, nIdx, at )->thing ) {
+            mAt( ctx, nIdx, at )->thing = end + 2;
+            at = (int)mAt( ctx, nIdx, at )->once - 2;
+        }
     }
+    
+    mAt( ctx, nIdx, aIdx )->thing = end + 2;
+    return end;
 }
 
-static void
-invokeCallbacks( lnA_Parser* par ) {
-    lnA_Queued* qIt = par->qNow->first;
-    while( qIt ) {
-        qIt->callback( qIt->str, par->udata );
-        qIt = qIt->next;
+static unsigned
+emitThing( lnA_Context* ctx, unsigned nIdx, unsigned aIdx );
+
+static unsigned
+emitSeq( lnA_Context* ctx, unsigned nIdx, unsigned aIdx ) {
+    while( nIdx ) {
+        aIdx = emitThing( ctx, nIdx, aIdx );
+        nIdx = uNode( ctx, nIdx )->next;
     }
+    return aIdx;
 }
 
 static void
-freeCallbacks( lnA_Parser* par ) {
-    lnA_Queued* qIt = par->qNow->first;
-    while( qIt ) {
-        lnA_Queued* tmp = qIt;
-        qIt = qIt->next;
-        free( tmp );
+emitOnce( lnA_Context* ctx, unsigned nIdx, unsigned aIdx ) {
+    lnA_Node* node = uNode( ctx, nIdx );
+    ctx->aIdx = aIdx;
+    switch( node->kind ) {
+        case lnA_PARAM:
+            parseParam( ctx, node );
+        break;
+        case lnA_SHORT:
+            parseShort( ctx, node );
+        break;
+        case lnA_LONG:
+            parseLong( ctx, node );
+        break;
+        default: {
+            unsigned alt = mAt( ctx, nIdx, aIdx )->alt;
+            ctx->depth++;
+            emitSeq( ctx, uNode( ctx, alt )->child, aIdx );
+            ctx->depth--;
+        }
+        break;
     }
-    *par->qNow = (lnA_Queue){ 0 };
 }
 
-static lnA_Param*
-findParam( lnA_Parser* par, char* name, unsigned len ) {
-    lnA_Param* pIt = par->pList;
-    while( pIt ) {
-        unsigned pLen = strlen( pIt->name );
-        if( len == pLen && !strncmp( name, pIt->name, len ) )
-            return pIt;
-        pIt = pIt->next;
+static unsigned
+emitThing( lnA_Context* ctx, unsigned nIdx, unsigned aIdx ) {
+    lnA_Node* node = uNode( ctx, nIdx );
+    if( node->kind == lnA_PARAM && node->rep ) {
+        ctx->aIdx = aIdx;
+        parseParams( ctx, node );
+        return ctx->aIdx;
     }
-    return NULL;
-}
-
-static lnA_Option*
-findOptionLong( lnA_Parser* par, char* name, unsigned len ) {
-    lnA_Option* oIt = par->oList;
-    while( oIt ) {
-        lnA_Option* opt = oIt;
-        oIt = oIt->next;
-        
-        if( !opt->lForm )
-            continue;
-        
-        unsigned oLen = strlen( opt->lForm );
-        if( len == oLen && !strncmp( name, opt->lForm, len ) )
-            return opt;
+    
+    bool rep = node->rep;
+    int  end = (int)mAt( ctx, nIdx, aIdx )->once - 2;
+    while( end >= 0 ) {
+        emitOnce( ctx, nIdx, aIdx );
+        if( streaming( ctx ) )
+            commitCallbacks( ctx );
+        if( !rep || end == (int)aIdx )
+            return end;
+        aIdx = end;
+        end  = (int)mAt( ctx, nIdx, aIdx )->once - 2;
     }
-    return NULL;
+    return aIdx;
 }
 
-static lnA_Option*
-findOptionShort( lnA_Parser* par, char name ) {
-    lnA_Option* oIt = par->oList;
-    while( oIt ) {
-        lnA_Option* opt = oIt;
-        oIt = oIt->next;
-        
-        if( !opt->sForm )
-            continue;
-        
-        if( contains( opt->sForm, strlen(opt->sForm), name ) )
-            return opt;
-        opt = opt->next;
+static void
+memoReset( lnA_Context* ctx ) {
+    size_t mLen = (size_t)ctx->uNow->nCount*(ctx->aCount + 1);
+    if( mLen > ctx->mCap ) {
+        ctx->memo = scratchGrow( ctx, ctx->memo, ctx->mCap*sizeof(lnA_Memo), mLen*sizeof(lnA_Memo) );
+        ctx->mCap = mLen;
     }
-    return NULL;
+    memset( ctx->memo, 0, mLen*sizeof(lnA_Memo) );
 }
 
-static char*
-error( lnA_Parser* par, char* fmt, ... ) {
-    va_list args;
-    va_start( args, fmt );
-    unsigned len = vsnprintf( NULL, 0, fmt, args ) + 1;
-    va_end( args );
+// Matches the current usage, queueing callbacks unless it's
+// memoized (the memo table has the path to queue them from).
+// On failure sets *fail to the top level node that didn't
+// match (0 for extra words) and leaves the argument index
+// where it was tried
+static bool
+recognize( lnA_Context* ctx, unsigned* fail ) {
+    if( ctx->par->flags & lnA_MEMOIZE )
+        memoReset( ctx );
     
-    par->eText = realloc( par->eText, len );
-    va_start( args, fmt );
-    vsnprintf( par->eText, len, fmt, args );
-    va_end( args );
+    // Without the memo table callbacks are queued as the
+    // usage is matched, so it only has to be matched once
+    bool quiet = ctx->quiet;
+    ctx->quiet = quiet || ( ctx->par->flags & lnA_MEMOIZE );
+    
+    unsigned nIdx = uNode( ctx, 0 )->child;
+    unsigned aIdx = 0;
+    while( nIdx ) {
+        if( ctx->par->flags & lnA_MEMOIZE ) {
+            int end = memoThing( ctx, nIdx, aIdx );
+            if( end < 0 )
+                break;
+            aIdx = end;
+        }
+        else {
+            ctx->aIdx = aIdx;
+            if( parseThing( ctx, nIdx ) )
+                break;
+            aIdx = ctx->aIdx;
+        }
+        nIdx = uNode( ctx, nIdx )->next;
+    }
+    
+    ctx->quiet = quiet;
+    ctx->aIdx  = aIdx;
     
-    return par->eText;
+    // Running out of steps can look like the end of
+    // a repetition to the memoized matcher
+    *fail = nIdx;
+    return !ctx->halt && !nIdx && !aPeek( ctx );
 }
 
-static char*
-validateRequired( lnA_Parser* par );
-
-static char*
-validateOptional( lnA_Parser* par ) {
+// Records the error for a failed top level node
+static int
+failAt( lnA_Context* ctx, unsigned nIdx ) {
+    if( !nIdx )
+        return fail( ctx, lnA_E_EXTRA_WORD, 0, 0, 0 );
     
-    // Skip whitespace
-    while( isspace( uPeek( par ) ) )
-        uAdv( par );
+    // A failed group always reports itself, otherwise
+    // rematch the node to get its error
+    lnA_Node* node = uNode( ctx, nIdx );
+    if( node->kind == lnA_REQUIRED )
+        return fail( ctx, lnA_E_MISSING_GROUP, node->uIdx, node->uLen, 0 );
     
-    while( uPeek( par ) != ']' ) {
-        char c = uNext( par );
-        if( c == '}' || c == '\0' )
-            return error( par, "Unterminated optional group" );
-        if( c == '[' ) {
-            char* err = validateOptional( par );
-            if( err )
-                return err;
-        }
-        if( c == '{' ) {
-            char* err = validateRequired( par );
-            if( err )
-                return err;
-        }
+    bool quiet = ctx->quiet;
+    ctx->quiet = true;
+    int err = parseThing( ctx, nIdx );
+    ctx->quiet = quiet;
+    return err;
+}
+
+// Queues and invokes callbacks along the matched path.  Runs
+// of parameters are scanned again, and those steps count too
+static int
+memoEmit( lnA_Context* ctx ) {
+    ctx->qLen = 0;
+    emitSeq( ctx, uNode( ctx, 0 )->child, 0 );
+    if( ctx->halt ) {
+        ctx->qLen = 0;
+        return ctx->err.code;
     }
     
-    // Skip terminating bracket
-    uAdv( par );
-    return NULL;
+    invokeCallbacks( ctx );
+    ctx->qLen = 0;
+    if( ctx->out )
+        ctx->out->usg = ctx->uNow;
+    return lnA_OK;
 }
 
-static char*
-validateRequired( lnA_Parser* par ) {
+static int
+memoUsage( lnA_Context* ctx ) {
+    // All of the arguments were pulled before matching
+    if( sourceFailed( ctx ) )
+        return fail( ctx, lnA_E_SOURCE_FAILED, 0, 0, 0 );
     
-    // Skip whitespace
-    while( isspace( uPeek( par ) ) )
-        uAdv( par );
+    unsigned nIdx;
+    if( !recognize( ctx, &nIdx ) )
+        return ctx->halt ? ctx->err.code : failAt( ctx, nIdx );
     
-    while( uPeek( par ) != '}' ) {
-        char c = uNext( par );
-        if( c == ']' || c == '\0' )
-            return error( par, "Unterminated optional group" );
-        if( c == '[' ) {
-            char* err = validateOptional( par );
-            if( err )
-                return err;
-        }
-        if( c == '{' ) {
-            char* err = validateRequired( par );
-            if( err )
-                return err;
-        }
-    }
+    if( memoEmit( ctx ) )
+        return ctx->err.code;
+    ctx->err = (lnA_Error){ 0 };
+    return lnA_OK;
+}
+
+
+static void
+queueEntry( lnA_Context* ctx, lnA_Queued entry ) {
+    // Nothing is queued while only recognizing
+    if( ctx->quiet )
+        return;
     
-    // Skip terminating bracket
-    uAdv( par );
-    return NULL;
+    if( ctx->qLen == ctx->qCap ) {
+        unsigned qCap = ctx->qCap ? ctx->qCap*2 : 16;
+        ctx->queue = scratchGrow( ctx, ctx->queue, ctx->qCap*sizeof(lnA_Queued), qCap*sizeof(lnA_Queued) );
+        ctx->qCap  = qCap;
+    }
+    ctx->queue[ctx->qLen++] = entry;
 }
 
-static char*
-validate( lnA_Parser* par  ) {
-    unsigned uIdx = par->uIdx;
-    // Skip whitespace
-    while( isspace( uPeek( par ) ) )
-        uAdv( par );
-    
-    while( uPeek( par ) != '\0' ) {
-        char c = uNext( par );
-        if( c == ']' || c == '}' )
-            return error( par, "Stray bracket" );
-        if( c == '[' ) {
-            char* err = validateOptional( par );
-            if( err )
-                return err;
-        }
-        if( c == '{' ) {
-            char* err = validateRequired( par );
-            if( err )
-                return err;
-        }
-    }
-    par->uIdx = uIdx;
-    return NULL;
+static void
+queueCallback( 
+    lnA_Context* ctx,
+    void        (*cb)( char* str, void* udata ),
+    char*       str
+) {
+    queueEntry( ctx, (lnA_Queued){ .callback = cb, .str = str } );
+}
+
+static void
+queueOption( lnA_Context* ctx, lnA_Option* opt, char* form ) {
+    if( ctx->out )
+        queueEntry( ctx, (lnA_Queued){ .opt = opt } );
+    else
+    if( opt->callback )
+        queueCallback( ctx, opt->callback, form );
+}
+
+// Queues 'n' arguments from 'aIdx' for a parameter, or just
+// 'str' if it's set; these are queued as one entry when
+// collecting matches or when the parameter takes slices
+static void
+queueParam( lnA_Context* ctx, lnA_Param* prm, unsigned aIdx, char* str, unsigned n ) {
+    if( !prm )
+        return;
+    if( ctx->out || prm->slice ) {
+        queueEntry( ctx, (lnA_Queued){ .slice = prm->slice, .aIdx = aIdx, .str = str, .nArgs = n, .prm = prm } );
+    }
+    else
+    if( prm->callback ) {
+        for( unsigned i = aIdx ; i < aIdx + n ; i++ )
+            queueCallback( ctx, prm->callback, str ? str : aArg( ctx, i )->str );
+    }
+}
+
+static void
+queueValue( lnA_Context* ctx, lnA_Param* prm, unsigned aIdx, char* str, lnA_Number num ) {
+    queueEntry( ctx, (lnA_Queued){ .aIdx = aIdx, .str = str, .nArgs = 1, .prm = prm, .num = num } );
+}
+
+static void
+storeValue( lnA_Value* val, lnA_Number num ) {
+    switch( val->kind ) {
+        case lnA_V_UINT:
+            *(uint64_t*)val->dest = num.u;
+        break;
+        case lnA_V_DOUBLE:
+            *(double*)val->dest = num.d;
+        break;
+        case lnA_V_BOOL:
+        case lnA_V_ENUM:
+            *(int*)val->dest = num.i;
+        break;
+        default:
+            *(int64_t*)val->dest = num.i;
+        break;
+    }
+}
+
+static void
+collect( lnA_Context* ctx, lnA_Queued* q );
+
+static void
+invokeCallbacks( lnA_Context* ctx ) {
+    for( unsigned i = 0 ; i < ctx->qLen ; i++ ) {
+        lnA_Queued* q = &ctx->queue[i];
+        if( typed( q->prm ) )
+            storeValue( &q->prm->val, q->num );
+        
+        if( ctx->out )
+            collect( ctx, q );
+        else
+        if( q->slice )
+            q->slice( q->str ? &q->str : &ctx->argv[q->aIdx - ctx->tBase], q->nArgs, ctx->udata );
+        else
+        if( q->callback )
+            q->callback( q->str, ctx->udata );
+    }
+}
+
+static void
+commitCallbacks( lnA_Context* ctx ) {
+    invokeCallbacks( ctx );
+    ctx->qLen = 0;
+    
+    // Nothing before here is needed anymore
+    ctx->tKeep = ctx->aIdx;
+}
+
+// Empties the matches for a new parse, with a count
+// for every option and parameter the parser has
+static void
+clearMatches( lnA_Context* ctx ) {
+    lnA_Matches* out = ctx->out;
+    lnA_Parser*  par = ctx->par;
+    if( !out )
+        return;
+    
+    if( par->oNext > out->oCap ) {
+        out->oCount = mResize( par, out->oCount, out->oCap*sizeof(unsigned), par->oNext*sizeof(unsigned) );
+        out->oCap   = par->oNext;
+    }
+    if( par->pNext > out->pCap ) {
+        out->pCount = mResize( par, out->pCount, out->pCap*sizeof(unsigned), par->pNext*sizeof(unsigned) );
+        out->pFirst = mResize( par, out->pFirst, out->pCap*sizeof(unsigned), par->pNext*sizeof(unsigned) );
+        out->pCap   = par->pNext;
+    }
+    if( par->oNext )
+        memset( out->oCount, 0, par->oNext*sizeof(unsigned) );
+    if( par->pNext )
+        memset( out->pCount, 0, par->pNext*sizeof(unsigned) );
+    out->usg    = NULL;
+    out->vCount = 0;
+}
+
+// Records a queued match instead of invoking its callback
+static void
+collect( lnA_Context* ctx, lnA_Queued* q ) {
+    lnA_Matches* out = ctx->out;
+    lnA_Parser*  par = ctx->par;
+    if( q->opt ) {
+        out->oCount[q->opt->id]++;
+        return;
+    }
+    
+    if( out->vCount + q->nArgs > out->vCap ) {
+        unsigned vCap = out->vCap ? out->vCap*2 : 16;
+        while( vCap < out->vCount + q->nArgs )
+            vCap *= 2;
+        out->vParam = mResize( par, out->vParam, out->vCap*sizeof(unsigned), vCap*sizeof(unsigned) );
+        out->vStr   = mResize( par, out->vStr, out->vCap*sizeof(char*), vCap*sizeof(char*) );
+        out->vLen   = mResize( par, out->vLen, out->vCap*sizeof(unsigned), vCap*sizeof(unsigned) );
+        out->vArg   = mResize( par, out->vArg, out->vCap*sizeof(unsigned), vCap*sizeof(unsigned) );
+        out->vOff   = mResize( par, out->vOff, out->vCap*sizeof(unsigned), vCap*sizeof(unsigned) );
+        out->vCap   = vCap;
+    }
+    
+    unsigned pId = q->prm->id;
+    if( !out->pCount[pId] )
+        out->pFirst[pId] = out->vCount;
+    out->pCount[pId] += q->nArgs;
+    for( unsigned i = 0 ; i < q->nArgs ; i++ ) {
+        // Values of '--name=value' options are given as 'str'
+        char*    arg = ctx->argv[q->aIdx + i - ctx->tBase];
+        char*    str = q->str ? q->str : arg;
+        unsigned v   = out->vCount++;
+        out->vParam[v] = pId;
+        out->vStr[v]   = str;
+        out->vLen[v]   = strlen( str );
+        out->vArg[v]   = q->aIdx + i;
+        out->vOff[v]   = str - arg;
+    }
+}
+
+// Reads a decimal number without a sign, fails if there
+// are no digits, anything else, or it doesn't fit
+static bool
+readUnsigned( char* str, uint64_t* out ) {
+    uint64_t val = 0;
+    if( !*str )
+        return false;
+    for( char* c = str ; *c ; c++ ) {
+        unsigned d = (unsigned char)*c - '0';
+        if( d > 9 || val > (UINT64_MAX - d)/10 )
+            return false;
+        val = val*10 + d;
+    }
+    *out = val;
+    return true;
+}
+
+static bool
+readSigned( char* str, int64_t* out ) {
+    bool     neg = *str == '-';
+    uint64_t mag;
+    if( *str == '-' || *str == '+' )
+        str++;
+    if( !readUnsigned( str, &mag ) || mag > (uint64_t)INT64_MAX + neg )
+        return false;
+    *out = neg ? (int64_t)(0 - mag) : (int64_t)mag;
+    return true;
+}
+
+// Reads a decimal number with an optional sign, fraction,
+// and exponent; no hex, infinities, or NaNs.  Numbers with
+// at most 2^53 in their digits and a power of ten up to 22
+// are exact with one multiply or divide, the rest go
+// through strtod() as digits and an exponent, which has
+// no decimal point for the locale to change
+static bool
+readDouble( lnA_Context* ctx, char* str, double* out ) {
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    
+    char*    c    = str;
+    bool     neg  = *c == '-';
+    uint64_t mant = 0;
+    int      exp  = 0;
+    int      eVal = 0;
+    unsigned nDig = 0;
+    unsigned fDig = 0;
+    bool     slow = false;
+    if( *c == '-' || *c == '+' )
+        c++;
+    for( bool frac = false ;; c++ ) {
+        if( *c == '.' && !frac ) {
+            frac = true;
+            continue;
+        }
+        unsigned d = (unsigned char)*c - '0';
+        if( d > 9 )
+            break;
+        nDig++;
+        fDig += frac;
+        if( mant > (UINT64_MAX - 9)/10 ) {
+            slow = true;
+            continue;
+        }
+        mant = mant*10 + d;
+        exp -= frac;
+    }
+    if( !nDig )
+        return false;
+    
+    if( *c == 'e' || *c == 'E' ) {
+        c++;
+        bool eNeg = *c == '-';
+        if( *c == '-' || *c == '+' )
+            c++;
+        if( !isdigit( (unsigned char)*c ) )
+            return false;
+        for( ; isdigit( (unsigned char)*c ) ; c++ ) {
+            if( eVal < 100000 )
+                eVal = eVal*10 + (*c - '0');
+        }
+        if( eNeg )
+            eVal = -eVal;
+        exp += eVal;
+    }
+    if( *c )
+        return false;
+    
+    if( !slow && mant <= (UINT64_C(1) << 53) && exp >= -22 && exp <= 22 ) {
+        double val = exp < 0 ? (double)mant / pow10[-exp] : (double)mant * pow10[exp];
+        *out = neg ? -val : val;
+        return true;
+    }
+    
+    // Rewritten as a sign, the digits, and an exponent, so
+    // "-1.25e3" becomes "-125e1"; numbers too long for the
+    // stack are copied to the heap
+    char   stack[128];
+    size_t bLen = nDig + 16;
+    char*  buf  = bLen <= sizeof(stack) ? stack : mAlloc( ctx->par, bLen );
+    char*  b    = buf;
+    if( neg )
+        *b++ = '-';
+    for( c = str ; *c && *c != 'e' && *c != 'E' ; c++ ) {
+        if( isdigit( (unsigned char)*c ) )
+            *b++ = *c;
+    }
+    sprintf( b, "e%ld", (long)eVal - (long)fDig );
+    
+    double val = strtod( buf, NULL );
+    if( buf != stack )
+        mFree( ctx->par, buf, bLen );
+    if( isinf( val ) )
+        return false;
+    *out = val;
+    return true;
+}
+
+// Names lnA_V_BOOL accepts, true ones at even indices
+static const char* lnA_bools[] = {
+    "1", "0", "true", "false", "yes", "no", "on", "off"
+};
+
+// Converts an argument to the parameter's type,
+// fails if it isn't a valid value
+static bool
+readValue( lnA_Context* ctx, lnA_Value* val, char* str, lnA_Number* num ) {
+    switch( val->kind ) {
+        case lnA_V_INT:
+            return readSigned( str, &num->i );
+        case lnA_V_UINT:
+            return readUnsigned( str, &num->u );
+        case lnA_V_DOUBLE:
+            return readDouble( ctx, str, &num->d );
+        case lnA_V_RANGE:
+            return readSigned( str, &num->i ) && num->i >= val->lo && num->i <= val->hi;
+        case lnA_V_BOOL:
+            for( unsigned i = 0 ; i < sizeof(lnA_bools)/sizeof(*lnA_bools) ; i++ ) {
+                if( !strcmp( str, lnA_bools[i] ) ) {
+                    num->i = i % 2 == 0;
+                    return true;
+                }
+            }
+            return false;
+        case lnA_V_ENUM:
+            for( unsigned i = 0 ; val->names && val->names[i] ; i++ ) {
+                if( !strcmp( str, val->names[i] ) ) {
+                    num->i = i;
+                    return true;
+                }
+            }
+            return false;
+    }
+    return false;
+}
+
+#define lnA_ONES  (UINT64_C(0x0101010101010101))
+#define lnA_HIGHS (UINT64_C(0x8080808080808080))
+
+// Returns the length of a long option name, which ends at
+// the first '=' or non graphic character.  Checks eight
+// bytes at a time for anything but '!'..'~' other than '=',
+// then finishes byte by byte from the word that had one
+static unsigned
+nameLen( char* str, size_t len ) {
+    size_t i = 0;
+    for( ; i + 8 <= len ; i += 8 ) {
+        uint64_t word;
+        memcpy( &word, &str[i], 8 );
+        uint64_t low = (word - lnA_ONES*0x21) & ~word;
+        uint64_t high = (word + lnA_ONES*(0x7F - 0x7E)) | word;
+        uint64_t eq = word ^ (lnA_ONES*'=');
+        eq = (eq - lnA_ONES) & ~eq;
+        if( (low | high | eq) & lnA_HIGHS )
+            break;
+    }
+    while( isgraph( (unsigned char)str[i] ) && str[i] != '=' )
+        i++;
+    return i;
+}
+
+static void
+classify( lnA_Token* tok, char* arg ) {
+    *tok = (lnA_Token){ .str = arg, .kind = lnA_A_PARAM };
+    if( !arg ) {
+        tok->kind = lnA_A_END;
+        return;
+    }
+    if( arg[0] != '-' )
+        return;
+    
+    if( arg[1] != '-' ) {
+        if( isgraph( (unsigned char)arg[1] ) ) {
+            tok->kind = lnA_A_SHORT;
+            tok->nLen = strlen( &arg[1] );
+        }
+        else {
+            tok->kind = lnA_A_OTHER;
+        }
+        return;
+    }
+    
+    if( !arg[2] ) {
+        tok->kind = lnA_A_DASHES;
+        return;
+    }
+    
+    tok->nLen = nameLen( &arg[2], strlen( &arg[2] ) );
+    if( arg[2 + tok->nLen] == '=' ) {
+        tok->kind = lnA_A_VALUE;
+        tok->vOff = 2 + tok->nLen + 1;
+    }
+    else {
+        tok->kind = lnA_A_LONG;
+    }
+}
+
+// Classifies the arguments once per parse, every usage
+// tried by lnA_tryAll() then shares the tokens
+static void
+tokenize( lnA_Context* ctx, char** argv ) {
+    unsigned aCount = 0;
+    while( argv[aCount] )
+        aCount++;
+    if( aCount + 1 > ctx->tCap ) {
+        ctx->toks = scratchGrow( ctx, ctx->toks, ctx->tCap*sizeof(lnA_Token), (aCount + 1)*sizeof(lnA_Token) );
+        ctx->tCap = aCount + 1;
+    }
+    
+    for( unsigned i = 0 ; i <= aCount ; i++ )
+        classify( &ctx->toks[i], argv[i] );
+    
+    ctx->src    = NULL;
+    ctx->argv   = argv;
+    ctx->aCount = aCount;
+    ctx->tBase  = 0;
+    ctx->tEnd   = aCount + 1;
+}
+
+// Pulls arguments from the source until the one at 'aIdx'
+// is classified or the source runs out.  When the window
+// is full the arguments that won't be matched again are
+// dropped, or the window grows if there aren't any
+static void
+pullArgs( lnA_Context* ctx, unsigned aIdx ) {
+    while( ctx->src && ctx->tEnd <= aIdx ) {
+        if( ctx->tEnd > ctx->tBase && ctx->toks[ctx->tEnd - 1 - ctx->tBase].kind == lnA_A_END )
+            return;
+        
+        unsigned tLen = ctx->tEnd - ctx->tBase;
+        if( tLen == ctx->tCap && ctx->tKeep > ctx->tBase ) {
+            unsigned drop = ctx->tKeep - ctx->tBase;
+            
+            // The source can free what's dropped, unless the
+            // matches still point to it
+            if( ctx->src->release && !ctx->out )
+                ctx->src->release( ctx->src->ctx, drop < tLen ? ctx->aBuf[drop] : NULL );
+            memmove( ctx->toks, &ctx->toks[drop], (tLen - drop)*sizeof(lnA_Token) );
+            memmove( ctx->aBuf, &ctx->aBuf[drop], (tLen - drop)*sizeof(char*) );
+            ctx->tBase = ctx->tKeep;
+            tLen -= drop;
+        }
+        else
+        if( tLen == ctx->tCap ) {
+            unsigned tCap = ctx->tCap ? ctx->tCap*2 : 64;
+            ctx->toks = scratchGrow( ctx, ctx->toks, ctx->tCap*sizeof(lnA_Token), tCap*sizeof(lnA_Token) );
+            ctx->tCap = tCap;
+        }
+        if( tLen == ctx->bCap ) {
+            unsigned bCap = ctx->tCap;
+            ctx->aBuf = scratchGrow( ctx, ctx->aBuf, ctx->bCap*sizeof(char*), bCap*sizeof(char*) );
+            ctx->bCap = bCap;
+        }
+        
+        char* arg = ctx->src->pull( ctx->src->ctx );
+        classify( &ctx->toks[tLen], arg );
+        ctx->aBuf[tLen] = arg;
+        ctx->argv = ctx->aBuf;
+        if( !arg )
+            ctx->aCount = ctx->tEnd;
+        ctx->tEnd++;
+    }
+}
+
+// Starts matching arguments from a source, with memoization
+// all of the arguments are needed up front
+static void
+openArgs( lnA_Context* ctx, lnA_Source* src ) {
+    ctx->src    = src;
+    ctx->argv   = ctx->aBuf;
+    ctx->aCount = 0;
+    ctx->tBase  = 0;
+    ctx->tEnd   = 0;
+    ctx->tKeep  = 0;
+    if( ctx->par->flags & lnA_MEMOIZE )
+        pullArgs( ctx, UINT_MAX );
+}
+
+// FNV-1a
+static uint32_t
+hashName( char* name, unsigned len ) {
+    uint32_t hash = 2166136261u;
+    for( unsigned i = 0 ; i < len ; i++ ) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Finds the slot for a name, either the one holding
+// it or the empty slot where it would go
+static lnA_Slot*
+findSlot( lnA_Slot* table, unsigned cap, char* name, unsigned len, uint32_t hash ) {
+    unsigned idx = hash & (cap - 1);
+    for( ;; ) {
+        lnA_Slot* slot = &table[idx];
+        if( !slot->item )
+            return slot;
+        if( slot->hash == hash && slot->nLen == len && !memcmp( slot->name, name, len ) )
+            return slot;
+        idx = (idx + 1) & (cap - 1);
+    }
+}
+
+// Adds a name to an open addressing table, or replaces
+// its item if it's already there.  The table doubles
+// whenever it would be over half full, to keep probes short
+static void
+addName( lnA_Parser* par, lnA_Slot** table, unsigned* cap, unsigned* count, char* name, unsigned len, void* item ) {
+    if( (*count + 1)*2 > *cap ) {
+        unsigned  nCap = *cap ? *cap*2 : 8;
+        lnA_Slot* nTab = mAlloc( par, nCap*sizeof(lnA_Slot) );
+        memset( nTab, 0, nCap*sizeof(lnA_Slot) );
+        for( unsigned i = 0 ; i < *cap ; i++ ) {
+            lnA_Slot* old = &(*table)[i];
+            if( old->item )
+                *findSlot( nTab, nCap, old->name, old->nLen, old->hash ) = *old;
+        }
+        mFree( par, *table, *cap*sizeof(lnA_Slot) );
+        *table = nTab;
+        *cap   = nCap;
+    }
+    
+    uint32_t  hash = hashName( name, len );
+    lnA_Slot* slot = findSlot( *table, *cap, name, len, hash );
+    if( !slot->item )
+        (*count)++;
+    *slot = (lnA_Slot){ .name = name, .nLen = len, .hash = hash, .item = item };
+}
+
+static lnA_Param*
+findParam( lnA_Parser* par, char* name, unsigned len ) {
+    if( !par->pCap )
+        return NULL;
+    uint32_t hash = hashName( name, len );
+    return findSlot( par->pTable, par->pCap, name, len, hash )->item;
+}
+
+static lnA_Command*
+findCommand( lnA_Parser* par, char* name ) {
+    if( !par->cCap )
+        return NULL;
+    unsigned len  = strlen( name );
+    uint32_t hash = hashName( name, len );
+    return findSlot( par->cTable, par->cCap, name, len, hash )->item;
+}
+
+static lnA_Option*
+findOptionLong( lnA_Parser* par, char* name, unsigned len ) {
+    if( !par->lCap )
+        return NULL;
+    uint32_t hash = hashName( name, len );
+    return findSlot( par->lTable, par->lCap, name, len, hash )->item;
+}
+
+static lnA_Option*
+findOptionShort( lnA_Parser* par, char name ) {
+    return par->sTable[(unsigned char)name];
+}
+
+lnA_Param*
+lnA_findParam( lnA_Parser* par, char* name, unsigned len ) {
+    return findParam( par, name, len );
+}
+
+lnA_Option*
+lnA_findOptionLong( lnA_Parser* par, char* name, unsigned len ) {
+    return findOptionLong( par, name, len );
+}
+
+lnA_Option*
+lnA_findOptionShort( lnA_Parser* par, char name ) {
+    return findOptionShort( par, name );
+}
+
+static void*
+mResize( lnA_Parser* par, void* ptr, size_t old, size_t size ) {
+    if( !ptr )
+        return mAlloc( par, size );
+    if( par->mem.resize )
+        return par->mem.resize( ptr, old, size, par->mem.ctx );
+    
+    void* mem = mAlloc( par, size );
+    memcpy( mem, ptr, old < size ? old : size );
+    mFree( par, ptr, old );
+    return mem;
+}
+
+static void
+mFree( lnA_Parser* par, void* ptr, size_t size ) {
+    if( ptr && par->mem.free )
+        par->mem.free( ptr, size, par->mem.ctx );
+}
+
+static bool
+inScratch( lnA_Context* ctx, void* ptr ) {
+    uintptr_t addr = (uintptr_t)ptr;
+    uintptr_t base = (uintptr_t)ctx->sMem;
+    return ctx->sMem && addr >= base && addr < base + ctx->sSize;
+}
+
+// Everything in the scratch arena is dropped at
+// the start of each parse
+static void
+scratchReset( lnA_Context* ctx ) {
+    if( inScratch( ctx, ctx->memo ) ) {
+        ctx->memo = NULL;
+        ctx->mCap = 0;
+    }
+    if( inScratch( ctx, ctx->queue ) ) {
+        ctx->queue = NULL;
+        ctx->qCap  = 0;
+    }
+    if( inScratch( ctx, ctx->toks ) ) {
+        ctx->toks = NULL;
+        ctx->tCap = 0;
+    }
+    if( inScratch( ctx, ctx->aBuf ) ) {
+        ctx->aBuf = NULL;
+        ctx->bCap = 0;
+    }
+    ctx->sUsed = 0;
+}
+
+// Grows per-parse data, preferring the scratch arena.  Once
+// data outgrows the arena it moves to the allocator and stays
+// there, so later parses don't have to grow it again
+static void*
+scratchGrow( lnA_Context* ctx, void* ptr, size_t old, size_t size ) {
+    if( ptr && !inScratch( ctx, ptr ) )
+        return mResize( ctx->par, ptr, old, size );
+    
+    size_t need = (size + 15) & ~(size_t)15;
+    if( ctx->sMem ) {
+        // The last allocation can grow in place
+        size_t at = ptr ? (size_t)((char*)ptr - ctx->sMem) : ctx->sUsed;
+        if( ptr && at + ((old + 15) & ~(size_t)15) != ctx->sUsed )
+            at = ctx->sUsed;
+        if( at + need <= ctx->sSize ) {
+            char* mem = &ctx->sMem[at];
+            if( ptr && mem != ptr )
+                memcpy( mem, ptr, old );
+            ctx->sUsed = at + need;
+            return mem;
+        }
+    }
+    
+    void* mem = mAlloc( ctx->par, size );
+    if( ptr )
+        memcpy( mem, ptr, old );
+    return mem;
+}
+
+static char*
+vformat( lnA_Parser* par, char** dst, size_t* cap, char* fmt, va_list args ) {
+    va_list copy;
+    va_copy( copy, args );
+    size_t len = vsnprintf( NULL, 0, fmt, copy ) + 1;
+    va_end( copy );
+    
+    if( len > *cap ) {
+        *dst = mResize( par, *dst, *cap, len );
+        *cap = len;
+    }
+    vsnprintf( *dst, len, fmt, args );
+    return *dst;
+}
+
+static char*
+format( lnA_Context* ctx, char* fmt, ... ) {
+    va_list args;
+    va_start( args, fmt );
+    char* text = vformat( ctx->par, &ctx->eText, &ctx->eCap, fmt, args );
+    va_end( args );
+    return text;
+}
+
+static char*
+errorText( lnA_Context* ctx, lnA_Error* err ) {
+    // Malformed usages keep the message from when they were compiled
+    if( err->code <= lnA_E_UNEXPECTED_CHAR )
+        return err->usg->eText;
+    
+    char*    uStr = err->usg ? &err->usg->usage[err->uIdx] : NULL;
+    unsigned uLen = err->uLen;
+    switch( err->code ) {
+        case lnA_E_OPTION_INFO:
+            return format( ctx, "Missing option info" );
+        case lnA_E_MISSING_OPTION:
+            return format( ctx, "Missing --%.*s option", uLen, uStr );
+        case lnA_E_UNEXPECTED_VALUE:
+            return format( ctx, "Unexpected argument for --%.*s option", uLen, uStr );
+        case lnA_E_MISSING_VALUE:
+            return format( ctx, "Missing argument for --%.*s option", uLen, uStr );
+        case lnA_E_MISSING_FLAG:
+            return format( ctx, "Missing -%.*s flag(s)", uLen, uStr );
+        case lnA_E_INVALID_FLAG:
+            return format( ctx, "Invalid flag '%c' for -%.*s flag(s)", err->chr, uLen, uStr );
+        case lnA_E_MISSING_PARAM:
+            return format( ctx, "Missing %.*s parameter", uLen, uStr );
+        case lnA_E_MISSING_GROUP:
+            return format( ctx, "Missing group %.*s", uLen, uStr );
+        case lnA_E_EXTRA_WORD:
+            return format( ctx, "Extra or unmatched word '%s'", err->arg );
+        case lnA_E_SOURCE_FAILED:
+            return format( ctx, "Couldn't read all of the arguments" );
+        case lnA_E_STEP_LIMIT:
+            return format( ctx, "Gave up matching after %lu steps", ctx->par->sMax );
+        case lnA_E_DEPTH_LIMIT:
+            return format( ctx, "Usage nests groups deeper than %u", ctx->par->dMax );
+        case lnA_E_UNKNOWN_COMMAND:
+            if( !err->arg )
+                return format( ctx, "Missing command" );
+            return format( ctx, "Unknown command '%s'", err->arg );
+        case lnA_E_BAD_VALUE: {
+            // Just the value of a '--name=value' argument
+            char* val = err->arg;
+            if( val[0] == '-' && val[1] == '-' && strchr( val, '=' ) )
+                val = strchr( val, '=' ) + 1;
+            return format( ctx, "Invalid %.*s value '%s'", uLen, uStr, val );
+        }
+        default:
+            return format( ctx, "No usages" );
+    }
+}
+
+typedef struct lnA_Compiler {
+    lnA_Parser* par;
+    lnA_Usage* usg;
+    char*      text;
+    unsigned   uIdx;
+    unsigned   depth;  // Groups being compiled
+} lnA_Compiler;
+
+#define cPeek( c ) ((c)->text[(c)->uIdx])
+#define cAdv( c )  ((c)->uIdx++)
+
+static bool
+cError( lnA_Compiler* c, int code, char* fmt, ... ) {
+    c->usg->cErr = (lnA_Error){
+        .code = code,
+        .usg  = c->usg,
+        .uIdx = c->uIdx,
+        .chr  = cPeek( c )
+    };
+    
+    size_t  cap = 0;
+    va_list args;
+    va_start( args, fmt );
+    vformat( c->par, &c->usg->eText, &cap, fmt, args );
+    va_end( args );
+    return false;
+}
+
+static unsigned
+addNode( lnA_Compiler* c, lnA_Kind kind, unsigned parent, unsigned prev ) {
+    lnA_Usage* usg = c->usg;
+    if( usg->nCount == usg->nCap ) {
+        unsigned nCap = usg->nCap ? usg->nCap*2 : 8;
+        usg->nodes = mResize( c->par, usg->nodes, usg->nCap*sizeof(lnA_Node), nCap*sizeof(lnA_Node) );
+        usg->nCap  = nCap;
+    }
+    
+    unsigned idx = usg->nCount++;
+    usg->nodes[idx] = (lnA_Node){ .kind = kind, .uIdx = c->uIdx };
+    if( prev )
+        usg->nodes[prev].next = idx;
+    else
+    if( idx )
+        usg->nodes[parent].child = idx;
+    return idx;
+}
+
+static bool
+compileSeq( lnA_Compiler* c, unsigned alt, char close );
+
+static bool
+compileGroup( lnA_Compiler* c, unsigned group, char close ) {
+    unsigned prev = 0;
+    for( ;; ) {
+        prev = addNode( c, lnA_ALT, group, prev );
+        if( !compileSeq( c, prev, close ) )
+            return false;
+        
+        // Skip the '|' or closing bracket
+        char sep = cPeek( c );
+        cAdv( c );
+        if( sep == close )
+            return true;
+    }
+}
+
+static bool
+compileThing( lnA_Compiler* c, unsigned alt, unsigned* prev ) {
+    lnA_Node* node;
+    unsigned  nIdx;
+    switch( cPeek( c ) ) {
+        case '-':
+            cAdv( c );
+            if( cPeek( c ) == '-' ) {
+                cAdv( c );
+                nIdx = addNode( c, lnA_LONG, alt, *prev );
+                char* uStr = &cPeek( c );
+                unsigned uBrk = 0;
+                while( isOptChr( &uStr[uBrk] ) && uStr[uBrk] != '=' )
+                    uBrk++;
+                unsigned uLen = uBrk;
+                while( isOptChr( &uStr[uLen] ) )
+                    uLen++;
+                c->uIdx += uLen;
+                
+                node = &c->usg->nodes[nIdx];
+                node->nLen = uBrk;
+                node->uLen = uLen;
+            }
+            else {
+                nIdx = addNode( c, lnA_SHORT, alt, *prev );
+                unsigned fLen = 0;
+                while( isOptChr( &cPeek( c ) ) ) {
+                    cAdv( c );
+                    fLen++;
+                }
+                c->usg->nodes[nIdx].uLen = fLen;
+            }
+        break;
+        case '[':
+        case '{': {
+            // Compiling and matching recurse into groups, so they're
+            // never nested deeper than lnA_MAX_NEST whatever the limits
+            char     open = cPeek( c );
+            unsigned dMax = c->par->dMax && c->par->dMax < lnA_MAX_NEST ? c->par->dMax : lnA_MAX_NEST;
+            if( c->depth == dMax )
+                return cError( c, lnA_E_DEPTH_LIMIT, "Groups nested deeper than %u", dMax );
+            nIdx = addNode( c, open == '[' ? lnA_OPTIONAL : lnA_REQUIRED, alt, *prev );
+            cAdv( c );
+            if( ++c->depth > c->usg->nest )
+                c->usg->nest = c->depth;
+            if( !compileGroup( c, nIdx, open == '[' ? ']' : '}' ) )
+                return false;
+            c->depth--;
+            node = &c->usg->nodes[nIdx];
+            node->uLen = c->uIdx - node->uIdx;
+        }
+        break;
+        default: {
+            unsigned uLen = 0;
+            while( isOptChr( &cPeek( c ) ) ) {
+                cAdv( c );
+                uLen++;
+            }
+            if( uLen == 0 )
+                return cError( c, lnA_E_UNEXPECTED_CHAR, "Unexpected character '%c'", cPeek( c ) );
+            nIdx = addNode( c, lnA_PARAM, alt, *prev );
+            node = &c->usg->nodes[nIdx];
+            node->uIdx -= uLen;
+            node->uLen  = uLen;
+        }
+        break;
+    }
+    
+    char* end = &cPeek( c );
+    if( end[0] == '.' && end[1] == '.' && end[2] == '.' ) {
+        c->usg->nodes[nIdx].rep = true;
+        c->uIdx += 3;
+    }
+    *prev = nIdx;
+    return true;
+}
+
+static bool
+compileSeq( lnA_Compiler* c, unsigned alt, char close ) {
+    unsigned prev = 0;
+    for( ;; ) {
+        // Skip whitespace
+        while( isspace( cPeek( c ) ) )
+            cAdv( c );
+        
+        char chr = cPeek( c );
+        if( chr == close || ( close && chr == '|' ) )
+            return true;
+        
+        if( chr == '\0' || chr == ']' || chr == '}' ) {
+            if( !close )
+                return cError( c, lnA_E_STRAY_BRACKET, "Stray bracket" );
+            if( close == ']' )
+                return cError( c, lnA_E_UNTERMINATED_OPTIONAL, "Unterminated optional group" );
+            else
+                return cError( c, lnA_E_UNTERMINATED_REQUIRED, "Unterminated required group" );
+        }
+        
+        if( !compileThing( c, alt, &prev ) )
+            return false;
+    }
+}
+
+#define fSet( u, n ) (&(u)->first[(n)*(u)->fWords])
+#define lSet( u, f, n ) (&(f)[(size_t)(n)*(u)->fWords])
+
+static void
+setAdd( uint64_t* dst, uint64_t* src, unsigned words ) {
+    for( unsigned i = 0 ; i < words ; i++ )
+        dst[i] |= src[i];
+}
+
+static bool
+setMeets( uint64_t* a, uint64_t* b, unsigned words ) {
+    for( unsigned i = 0 ; i < words ; i++ ) {
+        if( a[i] & b[i] )
+            return true;
+    }
+    return false;
+}
+
+static void
+findFirst( lnA_Parser* par, lnA_Usage* usg ) {
+    
+    // Give each distinct long option name a token bit
+    for( unsigned n = 0 ; n < usg->nCount ; n++ ) {
+        lnA_Node* node = &usg->nodes[n];
+        if( node->kind != lnA_LONG )
+            continue;
+        
+        unsigned id = 0;
+        while( id < usg->lCount ) {
+            lnA_Node* other = &usg->nodes[usg->lNode[id]];
+            if( other->nLen == node->nLen &&
+                !strncmp( &usg->usage[other->uIdx], &usg->usage[node->uIdx], node->nLen ) )
+                break;
+            id++;
+        }
+        if( id == usg->lCount ) {
+            usg->lNode = mResize( par, usg->lNode, id*sizeof(unsigned), (id + 1)*sizeof(unsigned) );
+            usg->lNode[usg->lCount++] = n;
+        }
+        node->lId = id;
+    }
+    
+    usg->fWords = (lnA_T_LONG + usg->lCount + 63)/64;
+    size_t fLen = (size_t)usg->nCount*usg->fWords*sizeof(uint64_t);
+    usg->first  = mAlloc( par, fLen );
+    memset( usg->first, 0, fLen );
+    
+    // Children always come after their parents, so going
+    // backwards finds the FIRST set of children first
+    for( unsigned n = usg->nCount ; n-- > 0 ; ) {
+        lnA_Node* node = &usg->nodes[n];
+        uint64_t* set  = fSet( usg, n );
+        switch( node->kind ) {
+            case lnA_PARAM:
+                set[lnA_T_PARAM/64] |= (uint64_t)1 << lnA_T_PARAM%64;
+            break;
+            case lnA_SHORT:
+                for( unsigned i = 0 ; i < node->uLen ; i++ ) {
+                    unsigned tok = lnA_T_SHORT + (unsigned char)usg->usage[node->uIdx + i];
+                    set[tok/64] |= (uint64_t)1 << tok%64;
+                }
+            break;
+            case lnA_LONG: {
+                unsigned tok = lnA_T_LONG + node->lId;
+                set[tok/64] |= (uint64_t)1 << tok%64;
+            }
+            break;
+            case lnA_ALT: {
+                node->null = true;
+                unsigned it = node->child;
+                while( it && node->null ) {
+                    setAdd( set, fSet( usg, it ), usg->fWords );
+                    node->null = usg->nodes[it].null;
+                    it = usg->nodes[it].next;
+                }
+            }
+            break;
+            default: {
+                node->null = node->kind == lnA_OPTIONAL;
+                unsigned it = node->child;
+                while( it ) {
+                    setAdd( set, fSet( usg, it ), usg->fWords );
+                    node->null |= usg->nodes[it].null;
+                    it = usg->nodes[it].next;
+                }
+            }
+            break;
+        }
+    }
+}
+
+// Checks that every choice in a usage can be decided by the
+// next argument, which takes the FOLLOW set of each thing.
+// Parents come before their children, so going forwards
+// finds the FOLLOW set of each sequence before the things in
+// it, and each sequence is walked back to front.  All the sets
+// are allocated at once, with room for the sequence at the end
+static bool
+checkChoices( lnA_Parser* par, lnA_Usage* usg ) {
+    unsigned  words  = usg->fWords;
+    size_t    fLen   = (size_t)usg->nCount*words*sizeof(uint64_t);
+    size_t    size   = fLen + usg->nCount*sizeof(unsigned);
+    uint64_t* follow = mAlloc( par, size );
+    unsigned* seq    = (unsigned*)((char*)follow + fLen);
+    memset( follow, 0, fLen );
+    
+    // Only the end of the arguments can follow the usage
+    follow[lnA_T_END/64] |= (uint64_t)1 << lnA_T_END%64;
+    
+    bool det = true;
+    for( unsigned n = 0 ; n < usg->nCount ; n++ ) {
+        lnA_Node* node = &usg->nodes[n];
+        uint64_t* set  = lSet( usg, follow, n );
+        
+        // Each thing in a sequence is followed by the next
+        // one's FIRST set, and by what follows that if it
+        // can match nothing
+        if( node->kind == lnA_ALT ) {
+            unsigned sLen = 0;
+            for( unsigned it = node->child ; it ; it = usg->nodes[it].next )
+                seq[sLen++] = it;
+            
+            for( unsigned i = sLen ; i-- > 0 ; ) {
+                uint64_t* dst = lSet( usg, follow, seq[i] );
+                if( i + 1 == sLen ) {
+                    memcpy( dst, set, words*sizeof(uint64_t) );
+                    continue;
+                }
+                unsigned next = seq[i + 1];
+                if( usg->nodes[next].null )
+                    memcpy( dst, lSet( usg, follow, next ), words*sizeof(uint64_t) );
+                else
+                    memset( dst, 0, words*sizeof(uint64_t) );
+                setAdd( dst, fSet( usg, next ), words );
+            }
+            continue;
+        }
+        
+        // Deciding whether to match (again) needs
+        // the thing's FIRST and FOLLOW sets disjoint
+        if( ( node->null || node->rep ) && setMeets( fSet( usg, n ), set, words ) )
+            det = false;
+        if( node->kind != lnA_OPTIONAL && node->kind != lnA_REQUIRED )
+            continue;
+        
+        for( unsigned alt = node->child ; alt ; alt = usg->nodes[alt].next ) {
+            
+            // Alternatives must start differently, and one
+            // that can match nothing always wins, so it has
+            // to be the last
+            lnA_Node* aNode = &usg->nodes[alt];
+            if( aNode->null && aNode->next )
+                det = false;
+            for( unsigned other = aNode->next ; other ; other = usg->nodes[other].next ) {
+                if( setMeets( fSet( usg, alt ), fSet( usg, other ), words ) )
+                    det = false;
+            }
+            
+            uint64_t* dst = lSet( usg, follow, alt );
+            memcpy( dst, set, words*sizeof(uint64_t) );
+            if( node->rep )
+                setAdd( dst, fSet( usg, n ), words );
+        }
+    }
+    
+    mFree( par, follow, size );
+    return det;
+}
+
+// Cost of trying a node once at some argument, as degrees of
+// polynomials in the number of arguments
+typedef struct lnA_Cost {
+    unsigned deg;   // Degree of the time a try takes
+    int      wst;   // Degree of the time it can spend on alternatives that fail, -1 for none
+    unsigned exp;   // Nesting of groups where an alternative redoes the work of one that failed
+    bool     late;  // Can fail after matching some of its arguments
+    unsigned dAt;   // Node that made 'deg' superlinear, if any
+    unsigned eAt;   // Node that made 'exp' what it is
+} lnA_Cost;
+
+// Takes the worst of each measure, except whether it fails late
+static void
+costMerge( lnA_Cost* dst, lnA_Cost* src ) {
+    if( src->deg > dst->deg ) {
+        dst->deg = src->deg;
+        dst->dAt = src->dAt;
+    }
+    if( src->exp > dst->exp ) {
+        dst->exp = src->exp;
+        dst->eAt = src->eAt;
+    }
+    if( src->wst > dst->wst )
+        dst->wst = src->wst;
+}
+
+// Finds the worst case time of matching a usage without
+// memoization.  Matching never goes back into a repetition or
+// a group that matched, so time is only lost to alternatives
+// that fail after matching some arguments.  That time is lost
+// again for every repetition around them, and an alternative
+// that redoes the work of a failed one before it doubles the
+// time of each group it's nested in
+static void
+analyze( lnA_Parser* par, lnA_Usage* usg ) {
+    usg->cost = (lnA_Complexity){ .cls = lnA_C_LINEAR, .degree = 1 };
+    
+    // Only one alternative that consumes arguments is ever tried
+    if( usg->det )
+        return;
+    
+    // Children come after their parents, so going backwards
+    // finds the cost of children first
+    lnA_Cost* cost = mAlloc( par, usg->nCount*sizeof(lnA_Cost) );
+    for( unsigned n = usg->nCount ; n-- > 0 ; ) {
+        lnA_Node* node = &usg->nodes[n];
+        lnA_Cost* c    = &cost[n];
+        *c = (lnA_Cost){ .wst = -1 };
+        switch( node->kind ) {
+            case lnA_ALT:
+                // Anything but the first thing of a sequence
+                // can fail after the things before it matched
+                for( unsigned it = node->child ; it ; it = usg->nodes[it].next ) {
+                    costMerge( c, &cost[it] );
+                    c->late |= cost[it].late || ( it != node->child && !usg->nodes[it].null );
+                }
+            break;
+            case lnA_OPTIONAL:
+            case lnA_REQUIRED:
+                for( unsigned alt = node->child ; alt ; alt = usg->nodes[alt].next ) {
+                    lnA_Cost* a = &cost[alt];
+                    costMerge( c, a );
+                    if( a->late && (int)a->deg > c->wst )
+                        c->wst = a->deg;
+                    if( node->kind == lnA_REQUIRED )
+                        c->late |= a->late;
+                    
+                    // Alternatives tried after one that failed late
+                    for( unsigned it = node->child ; it != alt ; it = usg->nodes[it].next ) {
+                        if( !cost[it].late )
+                            continue;
+                        if( !usg->nodes[alt].null && !setMeets( fSet( usg, it ), fSet( usg, alt ), usg->fWords ) )
+                            continue;
+                        unsigned exp = 1 + (cost[it].exp < a->exp ? cost[it].exp : a->exp);
+                        if( exp > c->exp ) {
+                            c->exp = exp;
+                            c->eAt = n;
+                        }
+                    }
+                }
+            break;
+            default:
+            break;
+        }
+        if( !node->rep )
+            continue;
+        
+        // Each repetition can lose the time again
+        unsigned deg = c->deg > 1 ? c->deg : 1;
+        if( c->wst >= 0 && (unsigned)c->wst + 1 > deg ) {
+            deg    = c->wst + 1;
+            c->dAt = n;
+        }
+        c->deg = deg;
+        if( c->wst >= 0 )
+            c->wst++;
+    }
+    
+    lnA_Cost* root = &cost[0];
+    unsigned  at   = 0;
+    if( root->exp >= 2 ) {
+        usg->cost.cls = lnA_C_EXPONENTIAL;
+        at = root->eAt;
+    }
+    else
+    if( root->deg >= 2 ) {
+        usg->cost.cls = lnA_C_POLYNOMIAL;
+        at = root->dAt;
+    }
+    usg->cost.degree = root->deg > 1 ? root->deg : 1;
+    if( at ) {
+        lnA_Node* node = &usg->nodes[at];
+        usg->cost.uIdx = node->uIdx;
+        usg->cost.uLen = node->uLen + (node->rep ? 3 : 0);
+    }
+    mFree( par, cost, usg->nCount*sizeof(lnA_Cost) );
+}
+
+static void
+compileUsage( lnA_Parser* par, lnA_Usage* usg ) {
+    lnA_Compiler c = { .par = par, .usg = usg, .text = usg->usage };
+    usg->cost = (lnA_Complexity){ .cls = lnA_C_LINEAR, .degree = 1 };
+    
+    // The root holds the top level sequence
+    unsigned root = addNode( &c, lnA_ALT, 0, 0 );
+    if( !compileSeq( &c, root, '\0' ) )
+        return;
+    usg->nodes[root].uLen = c.uIdx;
+    
+    findFirst( par, usg );
+    usg->det = checkChoices( par, usg );
+    analyze( par, usg );
+}
+
+// Saved parsers start with this header, everything else is
+// found by offsets from the start of the blob, so it can be
+// used wherever it's loaded or mapped.  String offsets of 0
+// are NULL.  Records for usages, options, and parameters
+// follow the header in that order, then the data they point to
+#define lnA_BLOB_MAGIC   (0x416E6C00)
+#define lnA_BLOB_VERSION (1)
+
+// Everything in a blob is stored as little endian 32 bit
+// words or single bytes at fixed offsets, so a blob doesn't
+// depend on the compiler's layout or the machine's byte order
+enum {
+    lnA_BH_MAGIC,    // lnA_BLOB_MAGIC
+    lnA_BH_VERSION,  // lnA_BLOB_VERSION
+    lnA_BH_SIZE,     // Size of the whole blob
+    lnA_BH_CHECK,    // FNV-1a hash of the blob
+    lnA_BH_FLAGS,    // Matching flags
+    lnA_BH_PNAME,    // Program name
+    lnA_BH_HTEXT,    // Header text
+    lnA_BH_FTEXT,    // Footer text
+    lnA_BH_UCOUNT,   // Usages, in the order they were added
+    lnA_BH_OCOUNT,   // Options, newest first like the option list
+    lnA_BH_PCOUNT,   // Parameters, newest first like the parameter list
+    lnA_BH_WORDS
+};
+
+// Each usage is its string, and the offset and number of its
+// nodes; each option its short and long forms and description;
+// each parameter its name.  Strings are offsets of NUL
+// terminated text, 0 for none
+#define lnA_BLOB_HEAD   (lnA_BH_WORDS*4)
+#define lnA_BLOB_USAGE  (3*4)
+#define lnA_BLOB_OPTION (3*4)
+#define lnA_BLOB_PARAM  (4)
+
+// Nodes are their kind and repetition as bytes, two zero
+// bytes, then the text offset and length, long option name
+// length, first child, and next sibling as words.  FIRST sets
+// and everything else worked out from the nodes are worked out
+// again when the blob is loaded, rather than trusted
+#define lnA_BLOB_NODE   (4 + 5*4)
+
+static uint32_t
+getWord( const char* at ) {
+    const unsigned char* b = (const unsigned char*)at;
+    return (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+static void
+putWord( char* at, uint32_t val ) {
+    for( unsigned i = 0 ; i < 4 ; i++ )
+        at[i] = (char)(val >> 8*i);
+}
+
+typedef struct lnA_Writer {
+    char*  buf;  // Blob being written, NULL when measuring
+    size_t len;  // Bytes written so far
+} lnA_Writer;
+
+// Reserves 'size' bytes at the given alignment and copies
+// 'data' there if it isn't NULL, returns the offset
+static size_t
+blobPut( lnA_Writer* w, const void* data, size_t size, size_t align ) {
+    while( w->len % align ) {
+        if( w->buf )
+            w->buf[w->len] = 0;
+        w->len++;
+    }
+    size_t off = w->len;
+    if( w->buf && data )
+        memcpy( &w->buf[off], data, size );
+    w->len += size;
+    return off;
+}
+
+// FNV-1a hash of the whole blob, reading the
+// checksum itself as 0
+static uint32_t
+blobHash( const char* base, size_t size ) {
+    size_t   cOff = lnA_BH_CHECK*4;
+    uint32_t hash = 2166136261u;
+    for( size_t i = 0 ; i < size ; i++ ) {
+        if( i < cOff || i >= cOff + 4 )
+            hash ^= (unsigned char)base[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t
+blobStr( lnA_Writer* w, const char* str ) {
+    return str ? blobPut( w, str, strlen( str ) + 1, 1 ) : 0;
+}
+
+// Writes a word at 'off' if the blob isn't just being measured
+static void
+blobWord( lnA_Writer* w, size_t off, size_t val ) {
+    if( w->buf )
+        putWord( &w->buf[off], val );
+}
+
+// Writes the blob to 'buf', or just measures it if 'buf'
+// is NULL; returns its size, or 0 if it's too big for the
+// 32 bit offsets
+static size_t
+saveBlob( lnA_Parser* par, char* buf ) {
+    lnA_Writer w = { buf, 0 };
+    unsigned oCount = 0, pCount = 0;
+    for( lnA_Option* oIt = par->oList ; oIt ; oIt = oIt->next )
+        oCount++;
+    for( lnA_Param* pIt = par->pList ; pIt ; pIt = pIt->next )
+        pCount++;
+    
+    size_t hOff = blobPut( &w, NULL, lnA_BLOB_HEAD, 4 );
+    size_t uOff = blobPut( &w, NULL, par->uCount*lnA_BLOB_USAGE, 4 );
+    size_t oOff = blobPut( &w, NULL, oCount*lnA_BLOB_OPTION, 4 );
+    size_t pOff = blobPut( &w, NULL, pCount*lnA_BLOB_PARAM, 4 );
+    
+    blobWord( &w, hOff + lnA_BH_MAGIC*4, lnA_BLOB_MAGIC );
+    blobWord( &w, hOff + lnA_BH_VERSION*4, lnA_BLOB_VERSION );
+    blobWord( &w, hOff + lnA_BH_FLAGS*4, par->flags );
+    blobWord( &w, hOff + lnA_BH_PNAME*4, blobStr( &w, par->pName ) );
+    blobWord( &w, hOff + lnA_BH_HTEXT*4, blobStr( &w, par->hText ) );
+    blobWord( &w, hOff + lnA_BH_FTEXT*4, blobStr( &w, par->fText ) );
+    blobWord( &w, hOff + lnA_BH_UCOUNT*4, par->uCount );
+    blobWord( &w, hOff + lnA_BH_OCOUNT*4, oCount );
+    blobWord( &w, hOff + lnA_BH_PCOUNT*4, pCount );
+    
+    for( unsigned i = 0 ; i < par->uCount ; i++ ) {
+        lnA_Usage* usg = par->uVec[i];
+        size_t rec = uOff + i*lnA_BLOB_USAGE;
+        size_t nOff = blobPut( &w, NULL, usg->nCount*lnA_BLOB_NODE, 4 );
+        blobWord( &w, rec, blobStr( &w, usg->usage ) );
+        blobWord( &w, rec + 4, nOff );
+        blobWord( &w, rec + 8, usg->nCount );
+        
+        for( unsigned n = 0 ; buf && n < usg->nCount ; n++ ) {
+            lnA_Node* node = &usg->nodes[n];
+            char*     raw  = &buf[nOff + n*lnA_BLOB_NODE];
+            raw[0] = node->kind;
+            raw[1] = node->rep;
+            raw[2] = raw[3] = 0;
+            putWord( &raw[4], node->uIdx );
+            putWord( &raw[8], node->uLen );
+            putWord( &raw[12], node->nLen );
+            putWord( &raw[16], node->child );
+            putWord( &raw[20], node->next );
+        }
+    }
+    
+    unsigned oIdx = 0;
+    for( lnA_Option* oIt = par->oList ; oIt ; oIt = oIt->next, oIdx++ ) {
+        size_t rec = oOff + oIdx*lnA_BLOB_OPTION;
+        blobWord( &w, rec, blobStr( &w, oIt->sForm ) );
+        blobWord( &w, rec + 4, blobStr( &w, oIt->lForm ) );
+        blobWord( &w, rec + 8, blobStr( &w, oIt->desc ) );
+    }
+    
+    unsigned pIdx = 0;
+    for( lnA_Param* pIt = par->pList ; pIt ; pIt = pIt->next, pIdx++ )
+        blobWord( &w, pOff + pIdx*lnA_BLOB_PARAM, blobStr( &w, pIt->name ) );
+    
+    if( w.len > UINT32_MAX )
+        return 0;
+    blobWord( &w, hOff + lnA_BH_SIZE*4, w.len );
+    blobWord( &w, hOff + lnA_BH_CHECK*4, 0 );
+    if( buf )
+        blobWord( &w, hOff + lnA_BH_CHECK*4, blobHash( buf, w.len ) );
+    return w.len;
+}
+
+size_t
+lnA_saveParser( lnA_Parser* par, void* buf, size_t size ) {
+    // Malformed usages have no nodes to save, and ones
+    // nested too deeply couldn't be loaded again
+    for( unsigned i = 0 ; i < par->uCount ; i++ ) {
+        if( par->uVec[i]->eText || par->uVec[i]->nest > lnA_MAX_BLOB_NEST )
+            return 0;
+    }
+    
+    size_t need = saveBlob( par, NULL );
+    if( need && need <= size )
+        saveBlob( par, buf );
+    return need;
+}
+
+// Checks a string offset, which must be NUL terminated
+// within the blob; 0 is only allowed if 'null' is set
+static bool
+blobStrOk( const char* base, size_t size, uint32_t off, bool null ) {
+    if( !off )
+        return null;
+    return off >= lnA_BLOB_HEAD && off < size && memchr( &base[off], '\0', size - off );
+}
+
+// Checks the offset of an array of 'count' records
+static bool
+blobArrOk( size_t size, uint32_t off, size_t count, size_t rec ) {
+    return off >= lnA_BLOB_HEAD && off <= size && count <= (size - off)/rec;
+}
+
+// Reads a saved node, returns false if its
+// bytes can't be those of any node
+static bool
+blobNode( const char* raw, lnA_Node* node ) {
+    if( (unsigned char)raw[0] > lnA_ALT || (unsigned char)raw[1] > 1 || raw[2] || raw[3] )
+        return false;
+    *node = (lnA_Node){
+        .kind  = (unsigned char)raw[0],
+        .rep   = raw[1],
+        .uIdx  = getWord( &raw[4] ),
+        .uLen  = getWord( &raw[8] ),
+        .nLen  = getWord( &raw[12] ),
+        .child = getWord( &raw[16] ),
+        .next  = getWord( &raw[20] )
+    };
+    return true;
+}
+
+// Node fields, read straight from a saved node
+#define bKind( raw, n )  ((unsigned char)(raw)[(size_t)(n)*lnA_BLOB_NODE])
+#define bChild( raw, n ) getWord( &(raw)[(size_t)(n)*lnA_BLOB_NODE + 16] )
+#define bNext( raw, n )  getWord( &(raw)[(size_t)(n)*lnA_BLOB_NODE + 20] )
+
+// Walks a saved usage's tree, which compileUsage() lays out
+// in preorder; each node has to be the one after the last,
+// so every node is reached exactly once.  The matcher recurses
+// through groups, so they can only nest lnA_MAX_BLOB_NEST deep.
+// Returns the deepest nesting, or UINT_MAX if the tree is bad
+static unsigned
+blobNest( const char* raw, unsigned nCount ) {
+    unsigned stack[2*lnA_MAX_BLOB_NEST + 1]; // Next of each node above
+    unsigned top  = 0;
+    unsigned nest = 0;
+    unsigned seen = 0;
+    unsigned cur  = 0;
+    for( ;; ) {
+        if( cur != seen++ )
+            return UINT_MAX;
+        
+        // Alternatives and groups alternate, so every other
+        // node on the stack is a group
+        if( bChild( raw, cur ) ) {
+            if( top == sizeof(stack)/sizeof(stack[0]) )
+                return UINT_MAX;
+            stack[top++] = bNext( raw, cur );
+            nest = top/2 > nest ? top/2 : nest;
+            cur  = bChild( raw, cur );
+            continue;
+        }
+        cur = bNext( raw, cur );
+        while( !cur && top )
+            cur = stack[--top];
+        if( !cur )
+            break;
+    }
+    return seen == nCount ? nest : UINT_MAX;
+}
+
+// Checks a saved usage's nodes can be matched without reading
+// outside of the usage string or looping forever; the tree
+// must have the shape compileUsage() gives it.  Returns the
+// deepest nesting, or UINT_MAX if the nodes are bad
+static unsigned
+blobNodes( const char* base, const char* rec ) {
+    const char* usage  = &base[getWord( rec )];
+    size_t      uLen   = strlen( usage );
+    const char* raw    = &base[getWord( &rec[4] )];
+    unsigned    nCount = getWord( &rec[8] );
+    for( unsigned i = 0 ; i < nCount ; i++ ) {
+        lnA_Node node;
+        if( !blobNode( &raw[i*lnA_BLOB_NODE], &node )
+         || node.uIdx > uLen || node.uLen > uLen - node.uIdx )
+            return UINT_MAX;
+        
+        // Links only go forward, so walking them always ends
+        if( (node.child && (node.child <= i || node.child >= nCount))
+         || (node.next && (node.next <= i || node.next >= nCount)) )
+            return UINT_MAX;
+        
+        // Alternatives and the rest alternate down the tree; the
+        // first child is checked here, and siblings match each other
+        bool alt = node.kind == lnA_ALT;
+        bool grp = alt || node.kind == lnA_OPTIONAL || node.kind == lnA_REQUIRED;
+        if( node.child && (!grp || (bKind( raw, node.child ) == lnA_ALT) == alt) )
+            return UINT_MAX;
+        if( node.next && (bKind( raw, node.next ) == lnA_ALT) != alt )
+            return UINT_MAX;
+        if( i == 0 && (!alt || node.next) )
+            return UINT_MAX;
+        
+        // The matcher splits '--name=PARAM' at the '='
+        if( node.kind == lnA_LONG ) {
+            if( node.nLen > node.uLen )
+                return UINT_MAX;
+            if( (usage[node.uIdx + node.nLen] == '=') != (node.nLen < node.uLen) )
+                return UINT_MAX;
+        }
+    }
+    return blobNest( raw, nCount );
+}
+
+// Checks the blob, and if 'par' isn't NULL reads
+// the usages into it as they're checked
+static int
+checkBlob( const void* blob, size_t size, lnA_Parser* par ) {
+    const char* base = blob;
+    if( !blob || size < lnA_BLOB_HEAD )
+        return lnA_E_BAD_BLOB;
+    
+    uint32_t head[lnA_BH_WORDS];
+    for( unsigned i = 0 ; i < lnA_BH_WORDS ; i++ )
+        head[i] = getWord( &base[i*4] );
+    if( head[lnA_BH_MAGIC] != lnA_BLOB_MAGIC || head[lnA_BH_VERSION] != lnA_BLOB_VERSION
+     || head[lnA_BH_SIZE] < lnA_BLOB_HEAD || head[lnA_BH_SIZE] > size )
+        return lnA_E_BAD_BLOB;
+    
+    // Anything past the saved size isn't part of the blob
+    size = head[lnA_BH_SIZE];
+    if( blobHash( base, size ) != head[lnA_BH_CHECK] )
+        return lnA_E_BAD_BLOB;
+    if( !blobStrOk( base, size, head[lnA_BH_PNAME], true )
+     || !blobStrOk( base, size, head[lnA_BH_HTEXT], true )
+     || !blobStrOk( base, size, head[lnA_BH_FTEXT], true ) )
+        return lnA_E_BAD_BLOB;
+    
+    size_t uOff = lnA_BLOB_HEAD;
+    size_t oOff = uOff + (size_t)head[lnA_BH_UCOUNT]*lnA_BLOB_USAGE;
+    size_t pOff = oOff + (size_t)head[lnA_BH_OCOUNT]*lnA_BLOB_OPTION;
+    if( !blobArrOk( size, uOff, head[lnA_BH_UCOUNT], lnA_BLOB_USAGE )
+     || !blobArrOk( size, oOff, head[lnA_BH_OCOUNT], lnA_BLOB_OPTION )
+     || !blobArrOk( size, pOff, head[lnA_BH_PCOUNT], lnA_BLOB_PARAM ) )
+        return lnA_E_BAD_BLOB;
+    
+    for( unsigned i = 0 ; i < head[lnA_BH_OCOUNT] ; i++ ) {
+        const char* rec = &base[oOff + i*lnA_BLOB_OPTION];
+        if( !blobStrOk( base, size, getWord( rec ), true )
+         || !blobStrOk( base, size, getWord( &rec[4] ), true )
+         || !blobStrOk( base, size, getWord( &rec[8] ), true ) )
+            return lnA_E_BAD_BLOB;
+    }
+    for( unsigned i = 0 ; i < head[lnA_BH_PCOUNT] ; i++ ) {
+        if( !blobStrOk( base, size, getWord( &base[pOff + i*lnA_BLOB_PARAM] ), false ) )
+            return lnA_E_BAD_BLOB;
+    }
+    
+    for( unsigned i = 0 ; i < head[lnA_BH_UCOUNT] ; i++ ) {
+        const char* rec    = &base[uOff + i*lnA_BLOB_USAGE];
+        unsigned    nCount = getWord( &rec[8] );
+        if( !blobStrOk( base, size, getWord( rec ), false ) || !nCount
+         || !blobArrOk( size, getWord( &rec[4] ), nCount, lnA_BLOB_NODE ) )
+            return lnA_E_BAD_BLOB;
+        
+        unsigned nest = blobNodes( base, rec );
+        if( nest == UINT_MAX )
+            return lnA_E_BAD_BLOB;
+        if( !par )
+            continue;
+        
+        // Everything worked out from the nodes is worked
+        // out again, just as compileUsage() would
+        lnA_Usage*  usg = &par->bUsg[i];
+        const char* raw = &base[getWord( &rec[4] )];
+        *usg = (lnA_Usage){ 0 };
+        usg->usage  = (char*)&base[getWord( rec )];
+        usg->nodes  = mAlloc( par, nCount*sizeof(lnA_Node) );
+        usg->nCount = nCount;
+        usg->nCap   = nCount;
+        usg->nest   = nest;
+        for( unsigned n = 0 ; n < nCount ; n++ )
+            blobNode( &raw[n*lnA_BLOB_NODE], &usg->nodes[n] );
+        findFirst( par, usg );
+        usg->det = checkChoices( par, usg );
+        analyze( par, usg );
+        linkUsage( par, usg );
+    }
+    return lnA_OK;
+}
+
+int
+lnA_checkParser( const void* blob, size_t size ) {
+    return checkBlob( blob, size, NULL );
+}
+
+static char*
+blobText( const char* base, uint32_t off ) {
+    return off ? (char*)&base[off] : NULL;
+}
+
+lnA_Parser*
+lnA_loadParser( const void* blob, size_t size, void* udata, lnA_Allocator* mem ) {
+    if( checkBlob( blob, size, NULL ) )
+        return NULL;
+    
+    const char* base = blob;
+    unsigned uCount = getWord( &base[lnA_BH_UCOUNT*4] );
+    unsigned oCount = getWord( &base[lnA_BH_OCOUNT*4] );
+    unsigned pCount = getWord( &base[lnA_BH_PCOUNT*4] );
+    lnA_Parser* par = lnA_makeParserEx( blobText( base, getWord( &base[lnA_BH_PNAME*4] ) ), udata, mem );
+    par->hText = blobText( base, getWord( &base[lnA_BH_HTEXT*4] ) );
+    par->fText = blobText( base, getWord( &base[lnA_BH_FTEXT*4] ) );
+    par->flags = getWord( &base[lnA_BH_FLAGS*4] );
+    
+    // Loaded items are allocated as one array of each kind,
+    // the strings they point to stay in the blob.  Each usage
+    // gets its nodes read into an array of its own
+    par->bUsg = mAlloc( par, uCount*sizeof(lnA_Usage) );
+    par->bOpt = mAlloc( par, oCount*sizeof(lnA_Option) );
+    par->bPrm = mAlloc( par, pCount*sizeof(lnA_Param) );
+    par->bUCount = uCount;
+    par->bOCount = oCount;
+    par->bPCount = pCount;
+    
+    // Already checked, so this only reads the usages
+    checkBlob( blob, size, par );
+    
+    // Options and parameters were saved newest first, so
+    // they're added back oldest first to keep the list order
+    const char* oRec = &base[lnA_BLOB_HEAD + uCount*lnA_BLOB_USAGE];
+    const char* pRec = &oRec[oCount*lnA_BLOB_OPTION];
+    for( unsigned i = oCount ; i-- ; ) {
+        lnA_Option* opt = &par->bOpt[i];
+        *opt = (lnA_Option){ 0 };
+        opt->sForm = blobText( base, getWord( &oRec[i*lnA_BLOB_OPTION] ) );
+        opt->lForm = blobText( base, getWord( &oRec[i*lnA_BLOB_OPTION + 4] ) );
+        opt->desc  = blobText( base, getWord( &oRec[i*lnA_BLOB_OPTION + 8] ) );
+        linkOption( par, opt );
+    }
+    for( unsigned i = pCount ; i-- ; ) {
+        lnA_Param* prm = &par->bPrm[i];
+        *prm = (lnA_Param){ 0 };
+        prm->name = blobText( base, getWord( &pRec[i*lnA_BLOB_PARAM] ) );
+        linkParam( par, prm );
+    }
+    return par;
+}
+
+lnA_Usage*
+lnA_getUsage( lnA_Parser* par, unsigned idx ) {
+    return idx < par->uCount ? par->uVec[idx] : NULL;
+}
+
+// Finds an option by its long form, or if that's
+// NULL by the first letter of its short form
+static lnA_Option*
+findOption( lnA_Parser* par, char* sf, char* lf ) {
+    if( lf )
+        return findOptionLong( par, lf, strlen( lf ) );
+    if( sf && *sf )
+        return findOptionShort( par, *sf );
+    return NULL;
+}
+
+int
+lnA_bindOption( lnA_Parser* par, char* sf, char* lf, lnA_OptionCb cb ) {
+    lnA_Option* opt = findOption( par, sf, lf );
+    if( !opt )
+        return -1;
+    opt->callback = cb;
+    return 0;
+}
+
+int
+lnA_optionId( lnA_Parser* par, char* sf, char* lf ) {
+    lnA_Option* opt = findOption( par, sf, lf );
+    return opt ? (int)opt->id : -1;
+}
+
+int
+lnA_paramId( lnA_Parser* par, char* name ) {
+    lnA_Param* prm = findParam( par, name, strlen( name ) );
+    return prm ? (int)prm->id : -1;
+}
+
+int
+lnA_bindParam( lnA_Parser* par, char* name, lnA_ParamCb cb ) {
+    lnA_Param* prm = findParam( par, name, strlen( name ) );
+    if( !prm )
+        return -1;
+    prm->callback = cb;
+    prm->slice    = NULL;
+    prm->val      = (lnA_Value){ 0 };
+    return 0;
+}
+
+int
+lnA_bindParamSlice( lnA_Parser* par, char* name, lnA_SliceCb cb ) {
+    lnA_Param* prm = findParam( par, name, strlen( name ) );
+    if( !prm )
+        return -1;
+    prm->callback = NULL;
+    prm->slice    = cb;
+    prm->val      = (lnA_Value){ 0 };
+    return 0;
+}
+
+int
+lnA_bindParamValue( lnA_Parser* par, char* name, lnA_Value* val ) {
+    lnA_Param* prm = findParam( par, name, strlen( name ) );
+    if( !prm )
+        return -1;
+    prm->callback = NULL;
+    prm->slice    = NULL;
+    prm->val      = *val;
+    return 0;
+}
+
+// Completion treats a usage as a grammar: the states are
+// positions in the node tree, either entering a node or having
+// just matched one, and each word moves every state that can
+// take it.  Only the leaves a word can be matched against are
+// kept for each word, the rest are found from them again
+#define lnA_ENTER( n ) ((n)*2)
+#define lnA_EXIT( n )  ((n)*2 + 1)
+
+// Leaf of a usage that could match the next word
+typedef struct lnA_Pos {
+    unsigned usg;   // Index of the usage
+    unsigned node;  // Index of the leaf
+} lnA_Pos;
+
+typedef struct lnA_Completer {
+    lnA_Parser*  par;
+    lnA_Context* ctx;     // Matches single words against leaves
+    unsigned     uCount;  // Usages the tables below were made for
+    
+    // Parent of each node, for finding what comes after a
+    // group's last alternative; nodes of usage 'u' start
+    // at 'nOff[u]' in these and the state marks
+    unsigned*    parent;
+    size_t*      nOff;
+    size_t       nCount;  // Nodes of all usages
+    unsigned*    mark;    // Generation each state was last reached in
+    unsigned     gen;
+    unsigned*    stack;   // States left to follow
+    
+    // Words the states were found for, copied since the
+    // caller's arguments may change between calls
+    char*        text;
+    size_t       tLen;
+    size_t       tCap;
+    size_t*      wOff;    // Offset of each word in 'text'
+    
+    // Leaves that could match the word after each of the
+    // words so far; level 'i' follows 'i' words and has its
+    // leaves from 'lOff[i]' to 'lOff[i+1]'
+    lnA_Pos*     pos;
+    size_t       pLen;
+    size_t       pCap;
+    size_t*      lOff;
+    bool*        ends;    // Whether the arguments can end at each level
+    unsigned     lCount;  // Levels found so far
+    unsigned     lCap;
+    
+    lnA_Completion res;
+    unsigned     wCap;    // Allocated result words
+    unsigned*    hash;    // Result word table, for merging duplicates
+    unsigned     hCap;
+} lnA_Completer;
+
+lnA_Completer*
+lnA_makeCompleter( lnA_Parser* par ) {
+    lnA_Completer* cmp = mAlloc( par, sizeof(lnA_Completer) );
+    *cmp = (lnA_Completer){ 0 };
+    cmp->par = par;
+    cmp->ctx = lnA_makeContext( par, NULL );
+    return cmp;
+}
+
+static void
+freeTables( lnA_Completer* cmp ) {
+    lnA_Parser* par = cmp->par;
+    mFree( par, cmp->parent, cmp->nCount*sizeof(unsigned) );
+    mFree( par, cmp->mark, cmp->nCount*2*sizeof(unsigned) );
+    mFree( par, cmp->stack, cmp->nCount*2*sizeof(unsigned) );
+    mFree( par, cmp->nOff, (cmp->uCount + 1)*sizeof(size_t) );
+}
+
+void
+lnA_freeCompleter( lnA_Completer* cmp ) {
+    lnA_Parser* par = cmp->par;
+    if( !par->mem.free )
+        return;
+    
+    freeTables( cmp );
+    lnA_freeContext( cmp->ctx );
+    mFree( par, cmp->text, cmp->tCap );
+    mFree( par, cmp->wOff, cmp->lCap*sizeof(size_t) );
+    mFree( par, cmp->pos, cmp->pCap*sizeof(lnA_Pos) );
+    mFree( par, cmp->lOff, (cmp->lCap + 1)*sizeof(size_t) );
+    mFree( par, cmp->ends, cmp->lCap*sizeof(bool) );
+    mFree( par, cmp->res.words, cmp->wCap*sizeof(lnA_Word) );
+    mFree( par, cmp->hash, cmp->hCap*sizeof(unsigned) );
+    mFree( par, cmp, sizeof(lnA_Completer) );
+}
+
+// Makes the parent tables for the parser's usages, and
+// forgets all levels since they might have changed
+static void
+makeTables( lnA_Completer* cmp ) {
+    lnA_Parser* par = cmp->par;
+    freeTables( cmp );
+    
+    cmp->uCount = par->uCount;
+    cmp->nOff   = mAlloc( par, (par->uCount + 1)*sizeof(size_t) );
+    cmp->nCount = 0;
+    for( unsigned u = 0 ; u < par->uCount ; u++ ) {
+        cmp->nOff[u] = cmp->nCount;
+        cmp->nCount += par->uVec[u]->nCount;
+    }
+    cmp->nOff[par->uCount] = cmp->nCount;
+    
+    cmp->parent = mAlloc( par, cmp->nCount*sizeof(unsigned) );
+    cmp->mark   = mAlloc( par, cmp->nCount*2*sizeof(unsigned) );
+    cmp->stack  = mAlloc( par, cmp->nCount*2*sizeof(unsigned) );
+    if( cmp->nCount )
+        memset( cmp->mark, 0, cmp->nCount*2*sizeof(unsigned) );
+    cmp->gen = 0;
+    
+    for( unsigned u = 0 ; u < par->uCount ; u++ ) {
+        lnA_Usage* usg    = par->uVec[u];
+        unsigned*  parent = &cmp->parent[cmp->nOff[u]];
+        parent[0] = 0;
+        for( unsigned n = 0 ; n < usg->nCount ; n++ ) {
+            for( unsigned c = usg->nodes[n].child ; c ; c = usg->nodes[c].next )
+                parent[c] = n;
+        }
+    }
+    cmp->lCount = 0;
+    cmp->tLen   = 0;
+    cmp->pLen   = 0;
+}
+
+static void
+addPos( lnA_Completer* cmp, unsigned usg, unsigned node ) {
+    if( cmp->pLen == cmp->pCap ) {
+        size_t pCap = cmp->pCap ? cmp->pCap*2 : 64;
+        cmp->pos  = mResize( cmp->par, cmp->pos, cmp->pCap*sizeof(lnA_Pos), pCap*sizeof(lnA_Pos) );
+        cmp->pCap = pCap;
+    }
+    cmp->pos[cmp->pLen++] = (lnA_Pos){ usg, node };
+}
+
+// Starts a new generation of state marks, so states
+// reached before count as not reached
+static void
+nextGen( lnA_Completer* cmp ) {
+    if( ++cmp->gen == 0 ) {
+        memset( cmp->mark, 0, cmp->nCount*2*sizeof(unsigned) );
+        cmp->gen = 1;
+    }
+}
+
+// Pushes a state on the stack unless it's already been reached
+static void
+pushState( lnA_Completer* cmp, unsigned* mark, unsigned* sLen, unsigned st ) {
+    if( mark[st] != cmp->gen ) {
+        mark[st] = cmp->gen;
+        cmp->stack[(*sLen)++] = st;
+    }
+}
+
+// Follows every state that doesn't take a word from the
+// states on the stack, adding the leaves it reaches to the
+// newest level.  Returns true if the end of the usage is
+// reached, so the arguments can end there
+static bool
+follow( lnA_Completer* cmp, unsigned u, unsigned sLen ) {
+    lnA_Usage* usg    = cmp->par->uVec[u];
+    unsigned*  parent = &cmp->parent[cmp->nOff[u]];
+    unsigned*  mark   = &cmp->mark[cmp->nOff[u]*2];
+    bool       end    = false;
+    
+    while( sLen ) {
+        unsigned  st   = cmp->stack[--sLen];
+        unsigned  n    = st/2;
+        lnA_Node* node = &usg->nodes[n];
+        
+        if( st == lnA_ENTER( n ) ) {
+            switch( node->kind ) {
+                case lnA_OPTIONAL:
+                    pushState( cmp, mark, &sLen, lnA_EXIT( n ) );
+                    // Fall through
+                case lnA_REQUIRED:
+                    for( unsigned alt = node->child ; alt ; alt = usg->nodes[alt].next )
+                        pushState( cmp, mark, &sLen, lnA_ENTER( alt ) );
+                break;
+                case lnA_ALT:
+                    if( node->child )
+                        pushState( cmp, mark, &sLen, lnA_ENTER( node->child ) );
+                    else
+                        pushState( cmp, mark, &sLen, lnA_EXIT( n ) );
+                break;
+                default:
+                    addPos( cmp, u, n );
+                break;
+            }
+            continue;
+        }
+        
+        // Finishing an alternative finishes its group,
+        // or the whole usage at the root
+        if( node->kind == lnA_ALT ) {
+            if( n == 0 )
+                end = true;
+            else
+                pushState( cmp, mark, &sLen, lnA_EXIT( parent[n] ) );
+            continue;
+        }
+        
+        if( node->rep )
+            pushState( cmp, mark, &sLen, lnA_ENTER( n ) );
+        if( node->next )
+            pushState( cmp, mark, &sLen, lnA_ENTER( node->next ) );
+        else
+            pushState( cmp, mark, &sLen, lnA_EXIT( parent[n] ) );
+    }
+    return end;
+}
+
+// Starts a new level, the leaves added after this belong to it
+static void
+addLevel( lnA_Completer* cmp ) {
+    if( cmp->lCount + 1 >= cmp->lCap ) {
+        unsigned lCap = cmp->lCap ? cmp->lCap*2 : 16;
+        cmp->wOff = mResize( cmp->par, cmp->wOff, cmp->lCap*sizeof(size_t), lCap*sizeof(size_t) );
+        cmp->lOff = mResize( cmp->par, cmp->lOff, (cmp->lCap + 1)*sizeof(size_t), (lCap + 1)*sizeof(size_t) );
+        cmp->ends = mResize( cmp->par, cmp->ends, cmp->lCap*sizeof(bool), lCap*sizeof(bool) );
+        cmp->lCap = lCap;
+    }
+    cmp->lOff[cmp->lCount] = cmp->pLen;
+    cmp->ends[cmp->lCount] = false;
+    cmp->lCount++;
+}
+
+// The first level is the start of every usage
+static void
+firstLevel( lnA_Completer* cmp ) {
+    lnA_Parser* par = cmp->par;
+    addLevel( cmp );
+    for( unsigned u = 0 ; u < par->uCount ; u++ ) {
+        // Malformed usages never match
+        if( par->uVec[u]->eText )
+            continue;
+        unsigned sLen = 0;
+        nextGen( cmp );
+        pushState( cmp, &cmp->mark[cmp->nOff[u]*2], &sLen, lnA_ENTER( 0 ) );
+        cmp->ends[0] |= follow( cmp, u, sLen );
+    }
+    cmp->lOff[1] = cmp->pLen;
+}
+
+// Adds the level after 'word', matching it against each leaf of
+// the last level the same way the matcher would
+static void
+nextLevel( lnA_Completer* cmp, char* word ) {
+    lnA_Context* ctx  = cmp->ctx;
+    char*        argv[] = { word, NULL };
+    unsigned     lIdx = cmp->lCount - 1;
+    size_t       pEnd = cmp->lOff[lIdx + 1];
+    
+    beginParse( ctx );
+    tokenize( ctx, argv );
+    ctx->quiet = true;
+    addLevel( cmp );
+    
+    // Leaves are grouped by usage, each usage's matches
+    // are followed together
+    size_t p = cmp->lOff[lIdx];
+    while( p < pEnd ) {
+        unsigned u    = cmp->pos[p].usg;
+        unsigned sLen = 0;
+        nextGen( cmp );
+        ctx->uNow = cmp->par->uVec[u];
+        for( ; p < pEnd && cmp->pos[p].usg == u ; p++ ) {
+            unsigned  n    = cmp->pos[p].node;
+            lnA_Node* node = uNode( ctx, n );
+            int       err;
+            ctx->aIdx = 0;
+            switch( node->kind ) {
+                case lnA_PARAM:
+                    err = parseParam( ctx, node );
+                break;
+                case lnA_SHORT:
+                    err = parseShort( ctx, node );
+                break;
+                default:
+                    err = parseLong( ctx, node );
+                break;
+            }
+            unsigned* mark = &cmp->mark[cmp->nOff[u]*2];
+            if( !err )
+                pushState( cmp, mark, &sLen, lnA_EXIT( n ) );
+        }
+        cmp->ends[lIdx + 1] |= follow( cmp, u, sLen );
+    }
+    
+    ctx->quiet = false;
+    ctx->uNow  = NULL;
+    cmp->lOff[lIdx + 2] = cmp->pLen;
+}
+
+// Remembers a word of the arguments, for the next call
+// to see which levels it can keep
+static void
+keepWord( lnA_Completer* cmp, char* word ) {
+    size_t len = strlen( word ) + 1;
+    if( cmp->tLen + len > cmp->tCap ) {
+        size_t tCap = cmp->tCap ? cmp->tCap*2 : 256;
+        while( tCap < cmp->tLen + len )
+            tCap *= 2;
+        cmp->text = mResize( cmp->par, cmp->text, cmp->tCap, tCap );
+        cmp->tCap = tCap;
+    }
+    cmp->wOff[cmp->lCount - 1] = cmp->tLen;
+    memcpy( &cmp->text[cmp->tLen], word, len );
+    cmp->tLen += len;
+}
+
+// Adds a word to the result unless it's already there
+static void
+addWord( lnA_Completer* cmp, lnA_Word word ) {
+    lnA_Completion* res = &cmp->res;
+    uint32_t hash = hashName( word.name, word.nLen ) ^ word.kind;
+    unsigned slot = hash & (cmp->hCap - 1);
+    for( ; cmp->hash[slot] ; slot = (slot + 1) & (cmp->hCap - 1) ) {
+        lnA_Word* other = &res->words[cmp->hash[slot] - 1];
+        if( other->kind == word.kind && other->nLen == word.nLen
+         && !memcmp( other->name, word.name, word.nLen )
+         && other->vLen == word.vLen && (!word.vLen || !memcmp( other->value, word.value, word.vLen )) )
+            return;
+    }
+    
+    res->words[res->count++] = word;
+    cmp->hash[slot] = res->count;
+}
+
+// Lists the words that can match the leaves of a level
+static void
+listWords( lnA_Completer* cmp, unsigned lIdx ) {
+    lnA_Parser*     par = cmp->par;
+    lnA_Completion* res = &cmp->res;
+    
+    // Each leaf gives at most a word per short option letter
+    size_t most = 0;
+    for( size_t p = cmp->lOff[lIdx] ; p < cmp->lOff[lIdx + 1] ; p++ ) {
+        lnA_Node* node = &par->uVec[cmp->pos[p].usg]->nodes[cmp->pos[p].node];
+        most += node->kind == lnA_SHORT ? node->uLen : 1;
+    }
+    if( most > cmp->wCap ) {
+        res->words = mResize( par, res->words, cmp->wCap*sizeof(lnA_Word), most*sizeof(lnA_Word) );
+        cmp->wCap  = most;
+    }
+    unsigned hCap = 16;
+    while( hCap < most*2 )
+        hCap *= 2;
+    if( hCap > cmp->hCap ) {
+        cmp->hash = mResize( par, cmp->hash, cmp->hCap*sizeof(unsigned), hCap*sizeof(unsigned) );
+        cmp->hCap = hCap;
+    }
+    memset( cmp->hash, 0, cmp->hCap*sizeof(unsigned) );
+    
+    res->count = 0;
+    res->end   = cmp->ends[lIdx];
+    for( size_t p = cmp->lOff[lIdx] ; p < cmp->lOff[lIdx + 1] ; p++ ) {
+        lnA_Usage* usg  = par->uVec[cmp->pos[p].usg];
+        lnA_Node*  node = &usg->nodes[cmp->pos[p].node];
+        char*      text = &usg->usage[node->uIdx];
+        switch( node->kind ) {
+            case lnA_PARAM:
+                addWord( cmp, (lnA_Word){ lnA_W_PARAM, text, node->uLen, NULL, 0 } );
+            break;
+            case lnA_SHORT:
+                // Letters without option info never match
+                for( unsigned i = 0 ; i < node->uLen ; i++ ) {
+                    if( findOptionShort( par, text[i] ) )
+                        addWord( cmp, (lnA_Word){ lnA_W_SHORT, &text[i], 1, NULL, 0 } );
+                }
+            break;
+            default:
+                if( !findOptionLong( par, text, node->nLen ) )
+                    break;
+                if( node->nLen < node->uLen )
+                    addWord( cmp, (lnA_Word){ lnA_W_LONG, text, node->nLen, &text[node->nLen + 1], node->uLen - node->nLen - 1 } );
+                else
+                    addWord( cmp, (lnA_Word){ lnA_W_LONG, text, node->nLen, NULL, 0 } );
+            break;
+        }
+    }
+}
+
+const lnA_Completion*
+lnA_complete( lnA_Completer* cmp, char** argv ) {
+    if( !cmp->nOff || cmp->uCount != cmp->par->uCount )
+        makeTables( cmp );
+    if( !cmp->lCount )
+        firstLevel( cmp );
+    
+    // Keep the levels for the words that haven't changed
+    unsigned same = 0;
+    while( argv[same] && same + 1 < cmp->lCount && !strcmp( argv[same], &cmp->text[cmp->wOff[same]] ) )
+        same++;
+    cmp->lCount = same + 1;
+    cmp->pLen   = cmp->lOff[same + 1];
+    cmp->tLen   = same ? cmp->wOff[same - 1] + strlen( &cmp->text[cmp->wOff[same - 1]] ) + 1 : 0;
+    
+    for( unsigned i = same ; argv[i] ; i++ ) {
+        keepWord( cmp, argv[i] );
+        nextLevel( cmp, argv[i] );
+    }
+    
+    listWords( cmp, cmp->lCount - 1 );
+    return &cmp->res;
+}
+
+// Columns taken by UTF-8 text, one for each character
+static unsigned
+textCols( const char* str, size_t len ) {
+    unsigned cols = 0;
+    for( size_t i = 0 ; i < len ; i++ )
+        cols += ((unsigned char)str[i] & 0xC0) != 0x80;
+    return cols;
+}
+
+// Length of the first 'cols' characters of UTF-8 text
+static size_t
+colsLen( const char* str, size_t len, unsigned cols ) {
+    size_t i = 0;
+    while( i < len && cols ) {
+        i++;
+        while( i < len && ((unsigned char)str[i] & 0xC0) == 0x80 )
+            i++;
+        cols--;
+    }
+    return i;
+}
+
+static void
+helpPut( lnA_Writer* w, const char* str ) {
+    blobPut( w, str, strlen( str ), 1 );
+}
+
+static void
+helpPad( lnA_Writer* w, unsigned cols ) {
+    static const char spaces[] = "                                ";
+    while( cols ) {
+        unsigned n = cols < sizeof(spaces) - 1 ? cols : sizeof(spaces) - 1;
+        blobPut( w, spaces, n, 1 );
+        cols -= n;
+    }
+}
+
+// Breaks a line of text at spaces, words wider than
+// a whole line are broken wherever they have to be
+static void
+wrapLine( lnA_Writer* w, const char* str, size_t len, unsigned indent, unsigned col, unsigned width ) {
+    bool   fresh = true;
+    size_t i     = 0;
+    while( i < len ) {
+        while( i < len && str[i] == ' ' )
+            i++;
+        if( i == len )
+            break;
+        
+        size_t   end   = i + strcspn( &str[i], " " );
+        end = end < len ? end : len;
+        unsigned wCols = textCols( &str[i], end - i );
+        if( !fresh && col + 1 + wCols > width ) {
+            blobPut( w, "\n", 1, 1 );
+            helpPad( w, indent );
+            col   = indent;
+            fresh = true;
+        }
+        if( !fresh ) {
+            blobPut( w, " ", 1, 1 );
+            col++;
+        }
+        
+        while( col + wCols > width ) {
+            if( col < width ) {
+                size_t part = colsLen( &str[i], end - i, width - col );
+                blobPut( w, &str[i], part, 1 );
+                i    += part;
+                wCols = textCols( &str[i], end - i );
+            }
+            blobPut( w, "\n", 1, 1 );
+            helpPad( w, indent );
+            col = indent;
+        }
+        blobPut( w, &str[i], end - i, 1 );
+        col  += wCols;
+        i     = end;
+        fresh = false;
+    }
+}
+
+// Writes text from column 'col' to at most 'width' columns,
+// lines after the first start at column 'indent'.  Lines of
+// the text that already fit are kept as they are
+static void
+helpWrap( lnA_Writer* w, const char* text, unsigned indent, unsigned col, unsigned width ) {
+    for( ;; ) {
+        size_t len = strcspn( text, "\n" );
+        if( col + textCols( text, len ) <= width )
+            blobPut( w, text, len, 1 );
+        else
+            wrapLine( w, text, len, indent, col, width );
+        
+        text += len;
+        if( !text[0] || !text[1] )
+            break;
+        blobPut( w, "\n", 1, 1 );
+        text++;
+        if( *text != '\n' )
+            helpPad( w, indent );
+        col = indent;
+    }
+    blobPut( w, "\n", 1, 1 );
+}
+
+static unsigned
+labelCols( lnA_Option* opt ) {
+    unsigned cols = 0;
+    if( opt->sForm )
+        cols += 1 + textCols( opt->sForm, strlen( opt->sForm ) );
+    if( opt->sForm && opt->lForm )
+        cols += 2;
+    if( opt->lForm )
+        cols += 2 + textCols( opt->lForm, opt->lLen );
+    return cols;
+}
+
+static void
+helpLabel( lnA_Writer* w, lnA_Option* opt ) {
+    if( opt->sForm ) {
+        helpPut( w, "-" );
+        helpPut( w, opt->sForm );
+    }
+    if( opt->sForm && opt->lForm )
+        helpPut( w, ", " );
+    if( opt->lForm ) {
+        helpPut( w, "--" );
+        helpPut( w, opt->lForm );
+    }
+}
+
+// Writes the description of an option or command after its
+// label, in the column at 'dCol'; it starts on the next line
+// if the label reaches the column
+static void
+helpDesc( lnA_Writer* w, const char* desc, unsigned col, unsigned dCol, unsigned width ) {
+    if( !desc || !*desc ) {
+        blobPut( w, "\n", 1, 1 );
+        return;
+    }
+    if( col + 2 > dCol ) {
+        blobPut( w, "\n", 1, 1 );
+        col = 0;
+    }
+    helpPad( w, dCol - col );
+    
+    // Long lines are hard to read, even on wide terminals
+    if( width > dCol + lnA_MAX_DESC_WIDTH )
+        width = dCol + lnA_MAX_DESC_WIDTH;
+    helpWrap( w, desc, dCol, dCol, width );
+}
+
+static void
+renderHelp( lnA_Writer* w, lnA_Parser* par, unsigned width ) {
+    
+    // Usages that don't fit continue under where they start
+    unsigned uCol = 3 + textCols( par->pName, strlen( par->pName ) );
+    helpPut( w, "Usage:\n" );
+    for( lnA_Usage* uIt = par->uList ; uIt ; uIt = uIt->next ) {
+        helpPad( w, 2 );
+        helpPut( w, par->pName );
+        helpPut( w, " " );
+        helpWrap( w, uIt->usage, uCol, uCol, width );
+    }
+    if( par->cList ) {
+        helpPad( w, 2 );
+        helpPut( w, par->pName );
+        helpPut( w, " COMMAND ...\n" );
+    }
+    helpPut( w, "\n" );
+    
+    if( par->hText ) {
+        helpWrap( w, par->hText, 0, 0, width );
+        helpPut( w, "\n" );
+    }
+    
+    // Descriptions are lined up in a column after the widest
+    // label that takes at most a third of the width, wider
+    // labels have their descriptions on the next line
+    unsigned lMax  = width/3 - 4;
+    unsigned lCols = 0;
+    for( lnA_Command* cIt = par->cList ; cIt ; cIt = cIt->next ) {
+        unsigned cols = textCols( cIt->name, cIt->nLen );
+        lCols = cols > lCols && cols <= lMax ? cols : lCols;
+    }
+    for( lnA_Option* oIt = par->oList ; oIt ; oIt = oIt->next ) {
+        unsigned cols = labelCols( oIt );
+        lCols = cols > lCols && cols <= lMax ? cols : lCols;
+    }
+    unsigned dCol = 2 + lCols + 2;
+    
+    // Commands are listed without making their parsers
+    if( par->cList ) {
+        helpPut( w, "Commands:\n" );
+        for( lnA_Command* cIt = par->cList ; cIt ; cIt = cIt->next ) {
+            helpPad( w, 2 );
+            helpPut( w, cIt->name );
+            helpDesc( w, cIt->desc, 2 + textCols( cIt->name, cIt->nLen ), dCol, width );
+        }
+        helpPut( w, "\n" );
+    }
+    
+    if( par->oList ) {
+        helpPut( w, "Options:\n" );
+        for( lnA_Option* oIt = par->oList ; oIt ; oIt = oIt->next ) {
+            helpPad( w, 2 );
+            helpLabel( w, oIt );
+            helpDesc( w, oIt->desc, 2 + labelCols( oIt ), dCol, width );
+        }
+        helpPut( w, "\n" );
+    }
+    
+    if( par->fText )
+        helpWrap( w, par->fText, 0, 0, width );
+}
+
+// Renders the help text unless it's already been rendered
+// for this width since the parser last changed
+static const char*
+helpText( lnA_Parser* par, unsigned width, size_t* len ) {
+    if( width < lnA_MIN_HELP_WIDTH )
+        width = lnA_MIN_HELP_WIDTH;
+    
+    if( par->hCols != width ) {
+        lnA_Writer w = { NULL, 0 };
+        renderHelp( &w, par, width );
+        if( w.len + 1 > par->hCap ) {
+            par->hBuf = mResize( par, par->hBuf, par->hCap, w.len + 1 );
+            par->hCap = w.len + 1;
+        }
+        
+        w = (lnA_Writer){ par->hBuf, 0 };
+        renderHelp( &w, par, width );
+        par->hBuf[w.len] = '\0';
+        par->hLen  = w.len;
+        par->hCols = width;
+    }
+    *len = par->hLen;
+    return par->hBuf;
+}
+
+// Width of the terminal at 'fd', or failing that of $COLUMNS
+static unsigned
+termWidth( int fd ) {
+    struct winsize ws;
+    if( fd >= 0 && isatty( fd ) && !ioctl( fd, TIOCGWINSZ, &ws ) && ws.ws_col )
+        return ws.ws_col;
+    
+    char* env = getenv( "COLUMNS" );
+    long  cols = env ? strtol( env, NULL, 10 ) : 0;
+    if( cols > 0 && cols < INT_MAX )
+        return cols;
+    return lnA_HELP_WIDTH;
+}
+
+int
+lnA_printHelp( lnA_Parser* par, FILE* out, unsigned width ) {
+    size_t      len;
+    const char* text = helpText( par, width ? width : termWidth( fileno( out ) ), &len );
+    return fwrite( text, 1, len, out ) == len ? 0 : -1;
+}
+
+int
+lnA_writeHelp( lnA_Parser* par, int fd, unsigned width ) {
+    size_t      len;
+    const char* text = helpText( par, width ? width : termWidth( fd ), &len );
+    while( len ) {
+        ssize_t n = write( fd, text, len );
+        if( n < 0 && errno == EINTR )
+            continue;
+        if( n < 0 )
+            return -1;
+        text += n;
+        len  -= n;
+    }
+    return 0;
+}
+
+size_t
+lnA_copyHelp( lnA_Parser* par, char* buf, size_t size, unsigned width ) {
+    size_t      len;
+    const char* text = helpText( par, width ? width : termWidth( -1 ), &len );
+    if( len < size )
+        memcpy( buf, text, len + 1 );
+    return len;
+}
+
+void
+lnA_printUsage( lnA_Parser* par ) {
+    lnA_printHelp( par, stdout, 0 );
+}
+
+// Length of the argument at 'str', which ends at a NUL
+// character or newline within the 'size' bytes left
+static size_t
+argLen( char* str, size_t size ) {
+    size_t len = strnlen( str, size );
+    char*  nl  = memchr( str, '\n', len );
+    return nl ? (size_t)(nl - str) : len;
+}
+
+// Block of arguments read or copied by a source, older
+// ones are kept since arguments returned from them must
+// stay valid until they're released
+typedef struct lnA_Chunk {
+    struct lnA_Chunk* next;
+    size_t            cap;     // Bytes that can be put in the chunk
+    char              data[];  // One extra byte for a terminator
+} lnA_Chunk;
+
+#define lnA_CHUNK_SIZE (64*1024)
+#define lnA_COPY_SIZE  (4*1024)
+
+// Frees the chunks older than the one holding 'arg', or
+// all but the newest if 'arg' is NULL
+static void
+freeChunks( lnA_Chunk* list, char* arg ) {
+    lnA_Chunk* keep = list;
+    while( arg && keep ) {
+        uintptr_t at = (uintptr_t)arg;
+        if( at >= (uintptr_t)keep->data && at <= (uintptr_t)&keep->data[keep->cap] )
+            break;
+        keep = keep->next;
+    }
+    if( !keep )
+        return;
+    
+    lnA_Chunk* old = keep->next;
+    keep->next = NULL;
+    while( old ) {
+        lnA_Chunk* tmp = old->next;
+        free( old );
+        old = tmp;
+    }
+}
+
+// Response file mapped into memory read only, arguments
+// ended by a NUL are used in place and others are copied
+typedef struct lnA_FileSrc {
+    char*      data;   // Mapped file
+    size_t     size;   // Size of the file
+    size_t     pos;    // Start of the next argument
+    lnA_Chunk* copy;   // Chunk copies are made in
+    size_t     cLen;   // Bytes used in the chunk
+    int        err;    // Why an argument couldn't be copied
+} lnA_FileSrc;
+
+static char*
+fileCopy( lnA_FileSrc* f, const char* arg, size_t len ) {
+    if( !f->copy || f->cLen + len + 1 > f->copy->cap ) {
+        size_t     cap  = len + 1 > lnA_COPY_SIZE ? len + 1 : lnA_COPY_SIZE;
+        lnA_Chunk* next = malloc( sizeof(lnA_Chunk) + cap );
+        if( !next )
+            return NULL;
+        next->next = f->copy;
+        next->cap  = cap;
+        f->copy = next;
+        f->cLen = 0;
+    }
+    
+    char* str = &f->copy->data[f->cLen];
+    memcpy( str, arg, len );
+    str[len] = '\0';
+    f->cLen += len + 1;
+    return str;
+}
+
+static char*
+filePull( void* ctx ) {
+    lnA_FileSrc* f = ctx;
+    if( f->err )
+        return NULL;
+    while( f->pos < f->size && (f->data[f->pos] == '\0' || f->data[f->pos] == '\n') )
+        f->pos++;
+    if( f->pos == f->size )
+        return NULL;
+    
+    char*  arg = &f->data[f->pos];
+    size_t len = argLen( arg, f->size - f->pos );
+    f->pos += len;
+    if( f->pos < f->size && arg[len] == '\0' )
+        return arg;
+    
+    // Writing a terminator would copy the page anyway
+    char* str = fileCopy( f, arg, len );
+    if( !str )
+        f->err = ENOMEM;
+    return str;
+}
+
+static void
+fileRelease( void* ctx, char* arg ) {
+    lnA_FileSrc* f = ctx;
+    freeChunks( f->copy, arg );
+}
+
+static int
+fileError( void* ctx ) {
+    lnA_FileSrc* f = ctx;
+    return f->err;
+}
+
+static void
+fileClose( void* ctx ) {
+    lnA_FileSrc* f = ctx;
+    if( f->data )
+        munmap( f->data, f->size );
+    freeChunks( f->copy, NULL );
+    free( f->copy );
+    free( f );
+}
+
+int
+lnA_openFile( lnA_Source* src, char* path ) {
+    int fd = open( path, O_RDONLY );
+    if( fd < 0 )
+        return -1;
+    
+    struct stat st;
+    lnA_FileSrc* f = calloc( 1, sizeof(lnA_FileSrc) );
+    if( !f || fstat( fd, &st ) ) {
+        free( f );
+        close( fd );
+        return -1;
+    }
+    
+    f->size = st.st_size;
+    if( f->size ) {
+        f->data = mmap( NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( f->data == MAP_FAILED ) {
+            free( f );
+            close( fd );
+            return -1;
+        }
+    }
+    close( fd );
+    
+    *src = (lnA_Source){
+        .pull    = &filePull,
+        .close   = &fileClose,
+        .ctx     = f,
+        .release = &fileRelease,
+        .error   = &fileError
+    };
+    return 0;
+}
+
+typedef struct lnA_StreamSrc {
+    int        fd;
+    lnA_Chunk* chunk;  // Chunk being read into
+    size_t     pos;    // Start of the next argument
+    size_t     len;    // Bytes read into the chunk
+    bool       eof;    // Nothing more to read
+    int        err;    // Why reading stopped early
+} lnA_StreamSrc;
+
+static char*
+streamPull( void* ctx ) {
+    lnA_StreamSrc* s = ctx;
+    while( !s->err ) {
+        char* data = s->chunk->data;
+        while( s->pos < s->len && (data[s->pos] == '\0' || data[s->pos] == '\n') )
+            s->pos++;
+        
+        // Return the next argument once its end has been read
+        if( s->pos < s->len ) {
+            char*  arg = &data[s->pos];
+            size_t len = argLen( arg, s->len - s->pos );
+            bool ended = s->pos + len < s->len;
+            if( ended || s->eof ) {
+                arg[len] = '\0';
+                s->pos  += ended ? len + 1 : len;
+                return arg;
+            }
+        }
+        else
+        if( s->eof ) {
+            return NULL;
+        }
+        
+        // Move a partial argument to a new chunk when
+        // there's no room left to read the rest of it
+        if( s->len == s->chunk->cap ) {
+            size_t     part = s->len - s->pos;
+            lnA_Chunk* next = malloc( sizeof(lnA_Chunk) + part + lnA_CHUNK_SIZE + 1 );
+            if( !next ) {
+                s->err = ENOMEM;
+                break;
+            }
+            memcpy( next->data, &data[s->pos], part );
+            next->next = s->chunk;
+            next->cap  = part + lnA_CHUNK_SIZE;
+            s->chunk = next;
+            s->pos   = 0;
+            s->len   = part;
+        }
+        
+        ssize_t got = read( s->fd, &s->chunk->data[s->len], s->chunk->cap - s->len );
+        if( got < 0 && errno == EINTR )
+            continue;
+        if( got < 0 )
+            s->err = errno;
+        else
+        if( !got )
+            s->eof = true;
+        else
+            s->len += got;
+    }
+    return NULL;
+}
+
+// The chunk being read into is always kept, so only
+// a window's worth of chunks are ever held
+static void
+streamRelease( void* ctx, char* arg ) {
+    lnA_StreamSrc* s = ctx;
+    freeChunks( s->chunk, arg );
+}
+
+static int
+streamError( void* ctx ) {
+    lnA_StreamSrc* s = ctx;
+    return s->err;
+}
+
+static void
+streamClose( void* ctx ) {
+    lnA_StreamSrc* s = ctx;
+    freeChunks( s->chunk, NULL );
+    free( s->chunk );
+    free( s );
+}
+
+int
+lnA_openStream( lnA_Source* src, int fd ) {
+    lnA_StreamSrc* s = calloc( 1, sizeof(lnA_StreamSrc) );
+    lnA_Chunk*     c = malloc( sizeof(lnA_Chunk) + lnA_CHUNK_SIZE + 1 );
+    if( !s || !c ) {
+        free( s );
+        free( c );
+        return -1;
+    }
+    c->next  = NULL;
+    c->cap   = lnA_CHUNK_SIZE;
+    s->fd    = fd;
+    s->chunk = c;
+    
+    *src = (lnA_Source){
+        .pull    = &streamPull,
+        .close   = &streamClose,
+        .ctx     = s,
+        .release = &streamRelease,
+        .error   = &streamError
+    };
+    return 0;
+}
+
+// Response file opened for an argument list
+typedef struct lnA_ArgsFile {
+    lnA_Source src;
+    char**     after;  // Argument after the file's '@path'
+} lnA_ArgsFile;
+
+// Argument list with response files expanded, each file is
+// kept open until the arguments it returned are released
+typedef struct lnA_ArgsSrc {
+    char**        argv;     // Next argument
+    char**        kept;     // Oldest argument that may still be needed
+    lnA_ArgsFile* files;    // Opened response files, oldest first
+    unsigned      fCount;   // Number of opened files
+    unsigned      fCap;     // Allocated files
+    bool          reading;  // Still reading the last file
+    int           err;      // Why the arguments ended early
+} lnA_ArgsSrc;
+
+static char*
+argsPull( void* ctx ) {
+    lnA_ArgsSrc* a = ctx;
+    while( !a->err ) {
+        if( a->reading ) {
+            lnA_Source* file = &a->files[a->fCount - 1].src;
+            char*       arg  = file->pull( file->ctx );
+            if( arg )
+                return arg;
+            a->reading = false;
+            a->err     = file->error( file->ctx );
+            continue;
+        }
+        
+        char* arg = *a->argv;
+        if( !arg )
+            return NULL;
+        a->argv++;
+        if( arg[0] != '@' || !arg[1] )
+            return arg;
+        
+        if( a->fCount == a->fCap ) {
+            unsigned      fCap  = a->fCap ? a->fCap*2 : 4;
+            lnA_ArgsFile* files = realloc( a->files, fCap*sizeof(lnA_ArgsFile) );
+            if( !files ) {
+                a->err = ENOMEM;
+                break;
+            }
+            a->files = files;
+            a->fCap  = fCap;
+        }
+        lnA_ArgsFile* file = &a->files[a->fCount];
+        if( lnA_openFile( &file->src, &arg[1] ) )
+            return arg;
+        file->after = a->argv;
+        a->fCount++;
+        a->reading = true;
+    }
+    return NULL;
+}
+
+static bool
+fileHas( lnA_Source* src, char* arg ) {
+    lnA_FileSrc* f  = src->ctx;
+    uintptr_t    at = (uintptr_t)arg;
+    if( at >= (uintptr_t)f->data && at < (uintptr_t)f->data + f->size )
+        return true;
+    for( lnA_Chunk* c = f->copy ; c ; c = c->next ) {
+        if( at >= (uintptr_t)c->data && at <= (uintptr_t)&c->data[c->cap] )
+            return true;
+    }
+    return false;
+}
+
+// Closes the files that come before 'arg', they're done with.
+// An argument of the list itself is found from where the last
+// one was, so a string that's in it twice is taken to be the
+// first one that's still kept.  The file holding 'arg', if
+// any, releases what it returned before it
+static void
+argsRelease( void* ctx, char* arg ) {
+    lnA_ArgsSrc* a    = ctx;
+    lnA_Source*  part = NULL;  // File that keeps some of its arguments
+    unsigned     done = 0;
+    while( arg && done < a->fCount && !fileHas( &a->files[done].src, arg ) )
+        done++;
+    
+    if( !arg ) {
+        a->kept = a->argv;
+        done    = a->reading ? a->fCount - 1 : a->fCount;
+        if( a->reading )
+            part = &a->files[done].src;
+    }
+    else
+    if( done < a->fCount ) {
+        a->kept = a->files[done].after;
+        part    = &a->files[done].src;
+    }
+    else {
+        char** it = a->kept;
+        while( it < a->argv && *it != arg )
+            it++;
+        if( it == a->argv )
+            return;
+        a->kept = it;
+        done    = 0;
+        while( done < a->fCount && a->files[done].after <= it )
+            done++;
+    }
+    
+    if( part )
+        part->release( part->ctx, arg );
+    for( unsigned i = 0 ; i < done ; i++ )
+        lnA_closeSource( &a->files[i].src );
+    a->fCount -= done;
+    memmove( a->files, &a->files[done], a->fCount*sizeof(lnA_ArgsFile) );
+}
+
+static int
+argsError( void* ctx ) {
+    lnA_ArgsSrc* a = ctx;
+    return a->err;
+}
+
+static void
+argsClose( void* ctx ) {
+    lnA_ArgsSrc* a = ctx;
+    for( unsigned i = 0 ; i < a->fCount ; i++ )
+        lnA_closeSource( &a->files[i].src );
+    free( a->files );
+    free( a );
+}
+
+int
+lnA_openArgs( lnA_Source* src, char** argv ) {
+    lnA_ArgsSrc* a = calloc( 1, sizeof(lnA_ArgsSrc) );
+    if( !a )
+        return -1;
+    a->argv = argv;
+    a->kept = argv;
+    
+    *src = (lnA_Source){
+        .pull    = &argsPull,
+        .close   = &argsClose,
+        .ctx     = a,
+        .release = &argsRelease,
+        .error   = &argsError
+    };
+    return 0;
+}
+
+void
+lnA_closeSource( lnA_Source* src ) {
+    if( src->close )
+        src->close( src->ctx );
+    *src = (lnA_Source){ 0 };
 }
@@ -1,10 +1,59 @@
 #ifndef lnA_line_arg_h
 #define lnA_line_arg_h
 
-#define lnA_MAX_DESC_WIDTH (70)
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
-typedef struct lnA_Parser lnA_Parser;
-typedef struct lnA_Usage  lnA_Usage;
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define lnA_MAX_DESC_WIDTH (70)  // Widest descriptions get in help text
+#define lnA_HELP_WIDTH     (80)  // Width of help text when the terminal's isn't known
+#define lnA_MIN_HELP_WIDTH (20)  // Narrowest help text is rendered
+#define lnA_MAX_BLOB_NEST  (256) // Deepest groups can nest in a loaded blob
+#define lnA_MAX_NEST       (256) // Deepest groups can nest in any usage
+
+typedef struct lnA_Parser  lnA_Parser;
+typedef struct lnA_Usage   lnA_Usage;
+typedef struct lnA_Context lnA_Context;
+typedef struct lnA_Completer lnA_Completer;
+
+// Error codes, the first few are for malformed usages
+#define lnA_OK                      (0)
+#define lnA_E_STRAY_BRACKET         (1)
+#define lnA_E_UNTERMINATED_OPTIONAL (2)
+#define lnA_E_UNTERMINATED_REQUIRED (3)
+#define lnA_E_UNEXPECTED_CHAR       (4)
+#define lnA_E_OPTION_INFO           (5)  // No lnA_addOption() for a usage option
+#define lnA_E_MISSING_OPTION        (6)  // Expected a long option
+#define lnA_E_UNEXPECTED_VALUE      (7)  // Long option given '=VALUE' it doesn't take
+#define lnA_E_MISSING_VALUE         (8)  // Long option not given its '=VALUE'
+#define lnA_E_MISSING_FLAG          (9)  // Expected short option flags
+#define lnA_E_INVALID_FLAG          (10) // Flag not allowed at this point
+#define lnA_E_MISSING_PARAM         (11) // Expected a parameter
+#define lnA_E_MISSING_GROUP         (12) // No alternative of a required group matched
+#define lnA_E_EXTRA_WORD            (13) // Arguments left after the usage matched
+#define lnA_E_NO_USAGES             (14) // lnA_tryAll() with no usages
+#define lnA_E_SOURCE_FAILED         (15) // Argument source failed before its end
+#define lnA_E_BAD_BLOB              (16) // lnA_checkParser() given an invalid blob
+#define lnA_E_BAD_VALUE             (17) // Argument isn't a valid value of a typed parameter
+#define lnA_E_UNKNOWN_COMMAND       (18) // lnA_tryCommand() not given a command
+#define lnA_E_STEP_LIMIT            (19) // Matching took more steps than lnA_setLimits() allows
+#define lnA_E_DEPTH_LIMIT           (20) // Usage nests groups deeper than lnA_setLimits() or lnA_MAX_NEST allows
+
+// Describes why a match failed, the message for it is
+// only formatted when asked for
+typedef struct lnA_Error {
+    int        code;   // One of the codes above
+    lnA_Usage* usg;    // Usage that failed, NULL for lnA_E_NO_USAGES
+    unsigned   uIdx;   // Offset of the failed part of the usage string
+    unsigned   uLen;   // Length of the failed part (names without hyphens)
+    unsigned   aIdx;   // Index of the argument it failed at
+    char*      arg;    // That argument, NULL past the end
+    char       chr;    // Offending character, if any
+} lnA_Error;
 
 typedef void
 (*lnA_ParamCb)( char* arg, void* udata );
@@ -12,21 +61,336 @@ typedef void
 typedef void
 (*lnA_OptionCb)( char* opt, void* udata );
 
+typedef void
+(*lnA_SliceCb)( char** args, size_t n, void* udata );
+
+// Makes the parser for a subcommand, it's passed the
+// command's name and the parent parser's udata
+typedef lnA_Parser*
+(*lnA_CommandCb)( char* name, void* udata );
+
+// Argument source, 'pull' returns the next argument or
+// NULL once there are no more.  Returned strings must stay
+// valid until the source is closed or they're released,
+// 'close', 'release', and 'error' can be NULL
+typedef struct lnA_Source {
+    char*
+    (*pull)( void* ctx );
+    
+    void
+    (*close)( void* ctx );
+    
+    void* ctx;
+    
+    // Called as the lnA_STREAM window moves on, 'arg' is the
+    // oldest returned string that's still needed (NULL if none
+    // are) so any returned before it can be freed
+    void
+    (*release)( void* ctx, char* arg );
+    
+    // Returns 0, or an errno value if 'pull' returned NULL
+    // because it failed; arguments were lost, so the match
+    // fails with lnA_E_SOURCE_FAILED
+    int
+    (*error)( void* ctx );
+} lnA_Source;
+
+// Types of typed parameters, and what their destinations
+// point to.  Numbers are decimal, read the same in any locale
+typedef enum lnA_ValueKind {
+    lnA_V_INT,     // int64_t, with an optional sign
+    lnA_V_UINT,    // uint64_t
+    lnA_V_DOUBLE,  // double, with an optional sign, fraction, and exponent
+    lnA_V_BOOL,    // int, 1 for 1/true/yes/on and 0 for 0/false/no/off
+    lnA_V_ENUM,    // int, index of the value in 'names'
+    lnA_V_RANGE    // int64_t, like lnA_V_INT but from 'lo' to 'hi'
+} lnA_ValueKind;
+
+typedef struct lnA_Value {
+    lnA_ValueKind kind;
+    void*         dest;   // Where the value is stored
+    const char**  names;  // Values of lnA_V_ENUM, ending with NULL
+    int64_t       lo;     // Inclusive bounds of lnA_V_RANGE
+    int64_t       hi;
+} lnA_Value;
+
+// What a parse matched, collected in place of invoking
+// callbacks (see lnA_setMatches()).  Options and parameters
+// are indexed by their IDs; values point into the arguments,
+// nothing is copied.  Start with a zeroed one, it's only
+// allocated when it has to grow, so parsing into the same
+// one again doesn't allocate.  Each is for one parser
+typedef struct lnA_Matches {
+    lnA_Usage* usg;     // Usage that matched, NULL if none did
+    unsigned*  oCount;  // Times each option was given
+    unsigned*  pCount;  // Number of values of each parameter
+    unsigned*  pFirst;  // Index of each parameter's first value
+    
+    // Values of all parameters, in the order they were given
+    unsigned   vCount;  // Number of values
+    unsigned*  vParam;  // Parameter ID of each value
+    char**     vStr;    // Each value
+    unsigned*  vLen;    // Length of each value
+    unsigned*  vArg;    // Index of each value's argument
+    unsigned*  vOff;    // Offset of each value in its argument, after the '=' of '--name=value'
+    
+    unsigned   oCap;    // Allocated option counts
+    unsigned   pCap;    // Allocated parameter counts
+    unsigned   vCap;    // Allocated values
+} lnA_Matches;
+
+// Allocator hooks, each is passed the 'ctx' pointer.  The
+// resize hook is passed the old size and can be NULL, in which
+// case resizing allocates and copies.  The free hook is passed
+// the allocation's size and can also be NULL for arena style
+// allocators; memory is then never freed by lnA, so releasing
+// the arena releases the parser
+typedef struct lnA_Allocator {
+    void*
+    (*alloc)( size_t size, void* ctx );
+    
+    void*
+    (*resize)( void* ptr, size_t old, size_t size, void* ctx );
+    
+    void
+    (*free)( void* ptr, size_t size, void* ctx );
+    
+    void* ctx;
+} lnA_Allocator;
+
+// Descriptors of a whole parser, for lnA_makeParserDef(); they
+// can be static const tables so defining a parser doesn't take
+// a call for each item.  Each array ends with an empty entry
+typedef struct lnA_OptionDef {
+    char*        sf;    // Short forms, or NULL
+    char*        lf;    // Long form, or NULL
+    char*        desc;  // Description text
+    lnA_OptionCb cb;
+} lnA_OptionDef;
+
+// At most one of 'cb', 'slice', and 'val' is set, see
+// lnA_addParam(), lnA_addParamSlice(), and lnA_addParamValue()
+typedef struct lnA_ParamDef {
+    char*       name;
+    lnA_ParamCb cb;
+    lnA_SliceCb slice;
+    lnA_Value   val;
+} lnA_ParamDef;
+
+typedef struct lnA_ParserDef {
+    char*                name;     // Program name
+    char*                header;   // Header text, or NULL
+    char*                footer;   // Footer text, or NULL
+    unsigned             flags;    // See lnA_setFlags()
+    char* const*         usages;   // Usage strings, ending with NULL
+    const lnA_OptionDef* options;  // Ending with one that has neither form
+    const lnA_ParamDef*  params;   // Ending with one that has no name
+} lnA_ParserDef;
+
 lnA_Parser*
 lnA_makeParser( char* name, void* udata );
 
+// Same as lnA_makeParser() but everything the parser
+// allocates comes from the given allocator, or from
+// malloc() if 'mem' is NULL
+lnA_Parser*
+lnA_makeParserEx( char* name, void* udata, lnA_Allocator* mem );
+
+// Makes a parser from descriptors, as if each item was added
+// in order.  The descriptors must outlive the parser, nothing
+// they point to is copied.  Items are allocated as one array
+// of each kind, so with a buffer allocator making the parser
+// and matching with it doesn't have to call malloc()
+lnA_Parser*
+lnA_makeParserDef( const lnA_ParserDef* def, void* udata, lnA_Allocator* mem );
+
+// Makes an allocator that hands out memory from the given
+// buffer, like a static array, and gets the rest from malloc()
+// once it runs out.  Memory freed or grown last is reused.
+// The buffer must outlive everything made with the allocator
+void
+lnA_bufferAllocator( lnA_Allocator* mem, void* buf, size_t size );
+
+// Returns about how big the buffer of a buffer allocator must
+// be for nothing to have come from malloc() so far, to size
+// the buffer for a program's parser
+size_t
+lnA_bufferNeeded( lnA_Allocator* mem );
+
 void
 lnA_freeParser( lnA_Parser* par );
 
+// Makes a context for matching with the parser, which holds
+// everything that changes while matching; so each thread
+// can match with its own context at the same time.  Callbacks
+// invoked through the context are passed 'udata'.  The parser
+// must not be changed while its contexts are in use, and
+// its contexts must be freed before it is
+lnA_Context*
+lnA_makeContext( lnA_Parser* par, void* udata );
+
+void
+lnA_freeContext( lnA_Context* ctx );
+
+// Gives the parser a scratch arena for per-parse data, like
+// the callback queue and memo table.  The whole arena is reset
+// at the start of each lnA_tryUsage() or lnA_tryAll(), data
+// that doesn't fit goes to the allocator and is kept for later
+// parses.  The arena must outlive the parser, or be replaced
+// by calling this again; pass NULL to stop using an arena
+void
+lnA_setScratch( lnA_Parser* par, void* mem, size_t size );
+
+// Makes each parse after this collect what it matched in
+// 'out' instead of invoking callbacks, until it's called
+// again with NULL.  'out' is emptied at the start of each
+// parse, its usage is only set if the parse succeeds
+void
+lnA_setMatches( lnA_Parser* par, lnA_Matches* out );
+
+// Frees the arrays of 'out' and zeroes it, it can still
+// be used with the parser after this
+void
+lnA_freeMatches( lnA_Parser* par, lnA_Matches* out );
+
+// Compiles the usage string and adds it to the parser,
+// malformed usages are still added but will fail to
+// match, see lnA_usageError()
 lnA_Usage*
 lnA_addUsage( lnA_Parser* par, char* usage );
 
-void
+// Returns the error message for a malformed usage
+// string, or NULL if the usage compiled successfully
+char*
+lnA_usageError( lnA_Usage* usg );
+
+// Returns 1 if the next argument is always enough to decide
+// which alternative of each group to match and whether to
+// match an optional or repeated form, 0 otherwise.  Matching
+// such a usage never tries more than one alternative that
+// consumes arguments
+int
+lnA_isDeterministic( lnA_Usage* usg );
+
+// Classes of the worst case time of matching a usage without
+// lnA_MEMOIZE, which makes every usage linear
+#define lnA_C_LINEAR      (0)
+#define lnA_C_POLYNOMIAL  (1) // Failed alternatives are retried for each repetition around them
+#define lnA_C_EXPONENTIAL (2) // Alternatives redo failed ones, doubling the time at each level of nesting
+
+typedef struct lnA_Complexity {
+    int      cls;     // One of the classes above
+    unsigned degree;  // Degree of the polynomial in the number of arguments
+    unsigned uIdx;    // Offset of the part of the usage string that causes it
+    unsigned uLen;    // Length of that part, 0 for linear usages
+} lnA_Complexity;
+
+// Returns the worst case time of matching the usage, found
+// when it was added.  Deterministic usages are always linear;
+// the others are judged by where alternatives can fail after
+// matching some arguments, so a usage might be faster than
+// its class but never slower.  Malformed usages are linear
+const lnA_Complexity*
+lnA_usageComplexity( lnA_Usage* usg );
+
+// Adds a parameter, returns its ID; parameters are
+// numbered from 0 in the order they're added
+int
 lnA_addParam( lnA_Parser* par, char* name, lnA_ParamCb cb );
 
-void
+// Same as lnA_addParam() but a repeated parameter, like
+// 'FILES...', is passed to the callback once with all of
+// its arguments; 'args' points into the argument list
+// given to the parser, nothing is copied.  Parameters
+// matched on their own are passed as slices of one
+int
+lnA_addParamSlice( lnA_Parser* par, char* name, lnA_SliceCb cb );
+
+// Adds a parameter whose arguments are converted to a type while
+// matching, rather than passed to a callback.  An argument that
+// isn't a valid value doesn't match the parameter, failing with
+// lnA_E_BAD_VALUE; a repeated parameter stops at such arguments.
+// Values are stored in the destination once the usage matches,
+// like callbacks are invoked, so repeated ones keep the last.
+// Negative numbers only work as '--name=VALUE' values, since
+// other arguments starting with '-' are options
+int
+lnA_addParamValue( lnA_Parser* par, char* name, lnA_Value* val );
+
+// Adds an option, returns its ID; options are numbered
+// from 0 in the order they're added
+int
 lnA_addOption( lnA_Parser* par, char* sf, char* lf, char* desc, lnA_OptionCb cb );
 
+// Return the ID of an existing option (found like with
+// lnA_bindOption()) or parameter, or -1 if there's none
+int
+lnA_optionId( lnA_Parser* par, char* sf, char* lf );
+
+int
+lnA_paramId( lnA_Parser* par, char* name );
+
+// Adds a subcommand, returns its ID; commands are numbered
+// from 0 in the order they're added.  The command's parser
+// is only made, by 'make', the first time it's needed, and
+// belongs to the parent from then on; lnA_freeParser() frees
+// it, even if the parent's allocator has no free hook.  'make'
+// can return the same parser for several commands, like
+// aliases, it's only freed once.  Making it isn't thread safe,
+// use lnA_getCommand() first to share a command's parser
+// between threads
+int
+lnA_addCommand( lnA_Parser* par, char* name, char* desc, lnA_CommandCb make );
+
+// Returns the parser of a command, making it if it wasn't yet,
+// or NULL if there's no such command or it couldn't be made
+lnA_Parser*
+lnA_getCommand( lnA_Parser* par, char* name );
+
+// Matches a command line that starts with a command, like
+// 'git commit -m MSG', by trying all usages of the command's
+// parser on the arguments after the command's name.  Arguments
+// that don't start with a command are tried with the parser's
+// own usages, or fail with lnA_E_UNKNOWN_COMMAND if it has none.
+// The parser that was tried is stored in *cmd (if not NULL), on
+// failure it has the error.  Returns like lnA_tryAll()
+char*
+lnA_tryCommand( lnA_Parser* par, char** argv, lnA_Parser** cmd, lnA_Usage** match );
+
+// Flags for lnA_setFlags():
+//  lnA_MEMOIZE: Remember the result of matching each part of
+//               a usage at each argument, so that alternatives
+//               and sequences never rematch the same arguments;
+//               matching takes linear time in the number of
+//               arguments, but needs a table of usage nodes
+//               times arguments
+//  lnA_STREAM:  Invoke callbacks for each part of a usage that
+//               isn't inside a group as soon as it matches,
+//               instead of once the whole usage has matched;
+//               queued callbacks then stay bounded, but if the
+//               usage fails to match later then callbacks for
+//               its start have already been invoked.  With
+//               lnA_MEMOIZE callbacks only start once all of
+//               the arguments are known to match
+#define lnA_MEMOIZE (1 << 0)
+#define lnA_STREAM  (1 << 1)
+
+// Sets flags that change how arguments are matched, all
+// flags are off by default
+void
+lnA_setFlags( lnA_Parser* par, unsigned flags );
+
+// Limits matching for arguments that can't be trusted, 0 is
+// no limit (the default).  A parse that takes more than 'steps'
+// steps, each a try of a usage item at some argument, fails
+// with lnA_E_STEP_LIMIT; lnA_tryAll() counts the steps of all
+// the usages it tries.  Usages nesting groups more than 'depth'
+// deep fail with lnA_E_DEPTH_LIMIT instead of being matched,
+// and ones added after this are reported as malformed, as are
+// usages nesting them more than lnA_MAX_NEST deep with no limit
+void
+lnA_setLimits( lnA_Parser* par, unsigned long steps, unsigned depth );
+
 void
 lnA_setHeader( lnA_Parser* par, char* header );
 
@@ -39,10 +403,267 @@ lnA_setFooter( lnA_Parser* par, char* footer );
 void
 lnA_printUsage( lnA_Parser* par );
 
+// The help text is rendered once into a buffer that's kept by
+// the parser, and rendered again only when the parser changes
+// or a different width is asked for.  Text is wrapped at spaces
+// to 'width' columns with descriptions lined up in a column;
+// a width of 0 is the terminal's, or $COLUMNS or lnA_HELP_WIDTH
+// if the output isn't a terminal.  lnA_printUsage() is the same
+// as lnA_printHelp( par, stdout, 0 )
+
+// Writes the help text with a single fwrite(), returns 0 or
+// -1 on failure
+int
+lnA_printHelp( lnA_Parser* par, FILE* out, unsigned width );
+
+// Writes the help text to a file descriptor, returns 0 or
+// -1 on failure with errno set
+int
+lnA_writeHelp( lnA_Parser* par, int fd, unsigned width );
+
+// Returns the length of the help text, which is copied with a
+// terminating NUL only if that fits in 'size' bytes
+size_t
+lnA_copyHelp( lnA_Parser* par, char* buf, size_t size, unsigned width );
+
+// Saves the parser's usages, options, parameters, flags, and
+// text as a blob for lnA_loadParser(), like a file or a const
+// array in the program; callbacks aren't saved.  Blobs are the
+// same on any machine.  Returns the size of the blob, which is
+// only written if it fits in 'size' bytes; returns 0 if any
+// usage is malformed or nests deeper than lnA_MAX_BLOB_NEST
+size_t
+lnA_saveParser( lnA_Parser* par, void* buf, size_t size );
+
+// Checks that a blob was saved by this version of lnA and
+// that it's intact, returns lnA_OK or lnA_E_BAD_BLOB.  Usages
+// nesting groups deeper than lnA_MAX_BLOB_NEST are rejected,
+// whatever the limits
+int
+lnA_checkParser( const void* blob, size_t size );
+
+// Makes a parser from a saved blob without parsing the usage
+// strings; the nodes are read from the blob, the rest is
+// worked out again from them.  Strings stay in the blob, so
+// it must outlive the parser.  Returns NULL if lnA_checkParser()
+// rejects it.  Callbacks are set with the bind functions,
+// usages can be found with lnA_getUsage()
+lnA_Parser*
+lnA_loadParser( const void* blob, size_t size, void* udata, lnA_Allocator* mem );
+
+// Returns a usage by the order it was added, or NULL
+lnA_Usage*
+lnA_getUsage( lnA_Parser* par, unsigned idx );
+
+// Sets the callback of an existing option, found by its long
+// form or if that's NULL by the first letter of its short form;
+// returns 0, or -1 if there's no such option
+int
+lnA_bindOption( lnA_Parser* par, char* sf, char* lf, lnA_OptionCb cb );
+
+// Sets the callback of an existing parameter, returns 0 or
+// -1 if there's no such parameter
+int
+lnA_bindParam( lnA_Parser* par, char* name, lnA_ParamCb cb );
+
+int
+lnA_bindParamSlice( lnA_Parser* par, char* name, lnA_SliceCb cb );
+
+int
+lnA_bindParamValue( lnA_Parser* par, char* name, lnA_Value* val );
+
 // Tries to parse the given argument set with
 // the specified usage, on success returns NULL,
 // on failure returns a brief error message
 char*
 lnA_tryUsage( lnA_Parser* par, lnA_Usage* usg, char** argv );
 
+// Same as lnA_tryUsage() but returns an error code, the
+// error is described by lnA_getError() and its message
+// isn't formatted unless lnA_errorText() is called
+int
+lnA_matchUsage( lnA_Parser* par, lnA_Usage* usg, char** argv );
+
+// Same as lnA_matchUsage() but pulls the arguments from
+// a source as they're needed.  With lnA_STREAM only a window
+// of arguments is kept, from the start of the last part of
+// the usage that invoked its callbacks; otherwise all of
+// them are kept for the parse.  Slices passed to callbacks
+// point into the window, so are only valid during the call
+int
+lnA_matchSource( lnA_Parser* par, lnA_Usage* usg, lnA_Source* src );
+
+// Opens a response file as a source, the file is mapped
+// into memory read only and split on NUL characters and
+// newlines; arguments ended by a NUL are used in place, the
+// rest are copied, so only NUL separated files are read
+// without copying.  Empty arguments are skipped.  Returns
+// 0 on success, or -1 and sets errno
+int
+lnA_openFile( lnA_Source* src, char* path );
+
+// Opens a source that reads arguments from a file descriptor
+// (like 0 for stdin) as they're needed, split the same way
+// as response files.  Input is freed once the lnA_STREAM
+// window has moved past it.  Returns 0 on success, or -1
+int
+lnA_openStream( lnA_Source* src, int fd );
+
+// Opens a source for an argument list where each '@path'
+// argument is replaced by the arguments of that response
+// file; if the file can't be opened the argument is kept
+// as is.  With lnA_STREAM files are closed once the window
+// has moved past them.  Returns 0 on success, or -1
+int
+lnA_openArgs( lnA_Source* src, char** argv );
+
+// Closes a source and releases its memory, after this the
+// strings it returned are no longer valid
+void
+lnA_closeSource( lnA_Source* src );
+
+// Returns the error from the last lnA_matchUsage(),
+// lnA_tryUsage(), or lnA_tryAll(); the code is lnA_OK
+// if it matched
+const lnA_Error*
+lnA_getError( lnA_Parser* par );
+
+// Returns the number of steps the last parse took, including
+// those of a failed parse, to help choose a step limit
+unsigned long
+lnA_stepsUsed( lnA_Parser* par );
+
+// Formats the message for lnA_getError(), or returns
+// NULL if there wasn't an error.  The message is only
+// available until the next call into the parser
+char*
+lnA_errorText( lnA_Parser* par );
+
+// Tries all usages in the order they were added, as if
+// they were alternatives of a single group; the first
+// usage to match has its callbacks invoked and is stored
+// in *match (if not NULL).  Each usage is matched once, and
+// the callbacks it queued are dropped if it fails; they're
+// only invoked once a usage has matched, even with lnA_STREAM.
+// On success returns NULL, on failure returns the error for
+// the usage that matched the most arguments
+char*
+lnA_tryAll( lnA_Parser* par, char** argv, lnA_Usage** match );
+
+// Returns the error for a usage tried by the last call to
+// lnA_tryAll(), or NULL if it matched or wasn't tried since
+// an earlier usage matched.  The arguments given to
+// lnA_tryAll() must still be valid
+char*
+lnA_matchError( lnA_Parser* par, lnA_Usage* usg );
+
+// The lnA_Parser functions that match arguments use a
+// context that belongs to the parser, so they can't be
+// called from several threads at once; these versions
+// match with the given context instead
+void
+lnA_setScratchCtx( lnA_Context* ctx, void* mem, size_t size );
+
+void
+lnA_setMatchesCtx( lnA_Context* ctx, lnA_Matches* out );
+
+char*
+lnA_tryUsageCtx( lnA_Context* ctx, lnA_Usage* usg, char** argv );
+
+int
+lnA_matchUsageCtx( lnA_Context* ctx, lnA_Usage* usg, char** argv );
+
+int
+lnA_matchSourceCtx( lnA_Context* ctx, lnA_Usage* usg, lnA_Source* src );
+
+const lnA_Error*
+lnA_getErrorCtx( lnA_Context* ctx );
+
+unsigned long
+lnA_stepsUsedCtx( lnA_Context* ctx );
+
+char*
+lnA_errorTextCtx( lnA_Context* ctx );
+
+char*
+lnA_tryAllCtx( lnA_Context* ctx, char** argv, lnA_Usage** match );
+
+char*
+lnA_matchErrorCtx( lnA_Context* ctx, lnA_Usage* usg );
+
+// Result of matching one argument vector in a batch
+typedef struct lnA_Result {
+    lnA_Usage* usg;  // First usage that matched, NULL if none did
+    lnA_Error  err;  // Error for the usage that got the farthest
+} lnA_Result;
+
+// Matches each of 'n' argument vectors against all usages,
+// like lnA_tryAll(), spread over 'workers' threads (0 for one
+// per CPU) that each match with their own context.  No
+// callbacks are invoked; each vector's result goes in the
+// same slot of 'res'.  The parser must not be changed during
+// the call and its allocator must be safe to use from several
+// threads.  Returns the number of vectors that matched
+size_t
+lnA_tryBatch( lnA_Parser* par, char*** argvs, size_t n, unsigned workers, lnA_Result* res );
+
+// Invokes the callbacks for the vectors that matched in
+// lnA_tryBatch(), in order, by matching each one again
+// with its usage
+void
+lnA_replayBatch( lnA_Parser* par, char*** argvs, size_t n, lnA_Result* res );
+
+// Formats the error message for a batch result, or returns
+// NULL if it matched.  The message is only available until
+// the next call into the parser
+char*
+lnA_resultText( lnA_Parser* par, lnA_Result* res );
+
+// Kinds of words lnA_complete() lists
+#define lnA_W_SHORT (0)  // Short option letter
+#define lnA_W_LONG  (1)  // Long option name
+#define lnA_W_PARAM (2)  // Parameter name, standing for any argument
+
+// A word that can come next, the names point into usage
+// strings so they aren't NUL terminated
+typedef struct lnA_Word {
+    int      kind;   // One of the kinds above
+    char*    name;   // Letter, long name without '--', or parameter name
+    unsigned nLen;   // Length of the name
+    char*    value;  // Name of the '=VALUE' a long option takes, or NULL
+    unsigned vLen;   // Length of the value's name
+} lnA_Word;
+
+typedef struct lnA_Completion {
+    lnA_Word* words;  // Each word that can come next, once
+    unsigned  count;  // Number of words
+    int       end;    // The arguments can end here
+} lnA_Completion;
+
+// Makes a completer for finding the words that can follow
+// some arguments in any of the parser's usages.  It keeps what
+// it found for the arguments of the last call, so each call
+// only has to match the words that changed since then.  The
+// parser must not be changed while the completer is in use,
+// except to add usages, which makes it start over
+lnA_Completer*
+lnA_makeCompleter( lnA_Parser* par );
+
+void
+lnA_freeCompleter( lnA_Completer* cmp );
+
+// Lists the words that can come after the arguments, which
+// should only be complete words; the word being typed can be
+// checked against the list.  The list stays valid until the
+// next call.  Usages are taken as grammars here, any way they
+// could match counts; so once in a while a word is listed that
+// the matcher's ordered choices and greedy repetition won't
+// take at that point
+const lnA_Completion*
+lnA_complete( lnA_Completer* cmp, char** argv );
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,579 @@
+#ifndef lnA_line_arg_hpp
+#define lnA_line_arg_hpp
+
+// C++17 front end that compiles usage strings while the program
+// is being compiled.  A malformed usage is a compile error, and
+// matching walks the compiled nodes through templates, so there's
+// no parsing of the usage, no lookups, and no heap at run time:
+//
+//     static constexpr auto usg = lnA_USAGE( "[-v | --width=W]... FILES..." );
+//
+//     int err = lnA::match<usg>( &argv[1], [&]( std::uint32_t id, char* arg ) {
+//         switch( id ) {
+//             case lnA::id( "v" ):     verbose = true;     break;
+//             case lnA::id( "width" ):                     break;
+//             case lnA::id( "W" ):     width = atoi( arg ); break;
+//             case lnA::id( "FILES" ): addFile( arg );    break;
+//         }
+//     } );
+//
+// Matching follows the same rules as lnA_matchUsage() and reports
+// the same lnA_Error (without a usage pointer).  Every option and
+// parameter in the usage is passed to the one handler, by the id
+// of its name: the parameter name, the long option name, or the
+// short option letter.  Handlers are called once the whole usage
+// has matched, in order, with the argument (or a long option's
+// value for its parameter).
+
+#include "line-arg.h"
+#include <cstdint>
+#include <cstdio>
+
+namespace lnA {
+
+// Same FNV-1a hash the parser uses for its tables
+constexpr std::uint32_t
+id( const char* name, unsigned len ) {
+    std::uint32_t hash = 2166136261u;
+    for( unsigned i = 0 ; i < len ; i++ ) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+constexpr unsigned
+length( const char* str ) {
+    unsigned len = 0;
+    while( str[len] )
+        len++;
+    return len;
+}
+
+constexpr std::uint32_t
+id( const char* name ) {
+    return id( name, length( name ) );
+}
+
+enum class Kind {
+    PARAM,     // NAME
+    SHORT,     // -abc
+    LONG,      // --name or --name=PARAM
+    OPTIONAL,  // [...], children are alternatives
+    REQUIRED,  // {...}, children are alternatives
+    ALT        // Alternative, children are a sequence
+};
+
+// Same layout as the nodes line-arg.c compiles usages to, node 0
+// is the root and children and siblings are linked by index
+struct Node {
+    Kind          kind  = Kind::ALT;
+    bool          rep   = false;  // Followed by '...'
+    unsigned      uIdx  = 0;      // Offset of the node text in the usage string
+    unsigned      uLen  = 0;      // Length of the node text
+    unsigned      nLen  = 0;      // Length of a long option's name (before '=')
+    unsigned      child = 0;      // First child
+    unsigned      next  = 0;      // Next sibling
+    std::uint32_t nId   = 0;      // Id of a parameter or long option name
+    std::uint32_t vId   = 0;      // Id of a long option's parameter
+};
+
+template<unsigned N, unsigned L>
+struct Grammar {
+    char usage[L] = {};
+    Node nodes[N] = {};
+
+    // Checks that a name is in the usage, for static_assert()s
+    // that each case of a handler is something that can match
+    constexpr bool
+    has( std::uint32_t name ) const {
+        for( unsigned i = 1 ; i < N ; i++ ) {
+            const Node& node = nodes[i];
+            if( (node.kind == Kind::PARAM || node.kind == Kind::LONG) && node.nId == name )
+                return true;
+            if( node.kind == Kind::LONG && usage[node.uIdx + node.nLen] == '=' && node.vId == name )
+                return true;
+            for( unsigned j = 0 ; node.kind == Kind::SHORT && j < node.uLen ; j++ ) {
+                if( id( &usage[node.uIdx + j], 1 ) == name )
+                    return true;
+            }
+        }
+        return false;
+    }
+};
+
+namespace detail {
+
+// Malformed usages call these while being compiled, which
+// can't be done in a constant expression, so the compiler
+// reports the error with the function's name
+inline void strayBracketInUsage() {}
+inline void unterminatedOptionalGroupInUsage() {}
+inline void unterminatedRequiredGroupInUsage() {}
+inline void unexpectedCharacterInUsage() {}
+inline void namesInUsageHaveTheSameId() {}
+
+constexpr bool
+isSpace( char chr ) {
+    return chr == ' ' || (chr >= '\t' && chr <= '\r');
+}
+
+constexpr bool
+isGraph( char chr ) {
+    return chr > ' ' && chr < 127;
+}
+
+constexpr bool
+isOptChr( const char* c ) {
+    if( c[0] == '.' && c[1] == '.' && c[2] == '.' )
+        return false;
+    return isGraph( *c ) &&
+           *c != '[' && *c != ']' &&
+           *c != '{' && *c != '}';
+}
+
+// Compiles a usage the way compileUsage() in line-arg.c does,
+// once without a node array to count the nodes and again to
+// fill in the nodes
+struct Compiler {
+    const char* text;
+    unsigned    uIdx  = 0;
+    Node*       nodes = nullptr;
+    unsigned    count = 0;
+    Node        spare = {};  // Stands in for nodes while counting
+
+    constexpr Node&
+    at( unsigned idx ) {
+        return nodes ? nodes[idx] : spare;
+    }
+
+    constexpr unsigned
+    addNode( Kind kind, unsigned parent, unsigned prev ) {
+        unsigned idx = count++;
+        at( idx ) = Node{};
+        at( idx ).kind = kind;
+        at( idx ).uIdx = uIdx;
+        if( prev )
+            at( prev ).next = idx;
+        else
+        if( idx )
+            at( parent ).child = idx;
+        return idx;
+    }
+
+    constexpr void
+    compileGroup( unsigned group, char close ) {
+        unsigned prev = 0;
+        for( ;; ) {
+            prev = addNode( Kind::ALT, group, prev );
+            compileSeq( prev, close );
+
+            // Skip the '|' or closing bracket
+            char sep = text[uIdx++];
+            if( sep == close )
+                return;
+        }
+    }
+
+    constexpr void
+    compileThing( unsigned alt, unsigned* prev ) {
+        unsigned nIdx = 0;
+        switch( text[uIdx] ) {
+            case '-':
+                uIdx++;
+                if( text[uIdx] == '-' ) {
+                    uIdx++;
+                    nIdx = addNode( Kind::LONG, alt, *prev );
+                    const char* uStr = &text[uIdx];
+                    unsigned uBrk = 0;
+                    while( isOptChr( &uStr[uBrk] ) && uStr[uBrk] != '=' )
+                        uBrk++;
+                    unsigned uLen = uBrk;
+                    while( isOptChr( &uStr[uLen] ) )
+                        uLen++;
+                    uIdx += uLen;
+
+                    Node& node = at( nIdx );
+                    node.nLen = uBrk;
+                    node.uLen = uLen;
+                    node.nId  = id( uStr, uBrk );
+                    if( uStr[uBrk] == '=' )
+                        node.vId = id( &uStr[uBrk + 1], uLen - uBrk - 1 );
+                }
+                else {
+                    nIdx = addNode( Kind::SHORT, alt, *prev );
+                    unsigned fLen = 0;
+                    while( isOptChr( &text[uIdx] ) ) {
+                        uIdx++;
+                        fLen++;
+                    }
+                    at( nIdx ).uLen = fLen;
+                }
+            break;
+            case '[':
+            case '{': {
+                char open = text[uIdx];
+                nIdx = addNode( open == '[' ? Kind::OPTIONAL : Kind::REQUIRED, alt, *prev );
+                uIdx++;
+                compileGroup( nIdx, open == '[' ? ']' : '}' );
+                at( nIdx ).uLen = uIdx - at( nIdx ).uIdx;
+            }
+            break;
+            default: {
+                unsigned uLen = 0;
+                while( isOptChr( &text[uIdx] ) ) {
+                    uIdx++;
+                    uLen++;
+                }
+                if( uLen == 0 ) {
+                    unexpectedCharacterInUsage();
+                    return;
+                }
+                nIdx = addNode( Kind::PARAM, alt, *prev );
+                Node& node = at( nIdx );
+                node.uIdx -= uLen;
+                node.uLen  = uLen;
+                node.nId   = id( &text[node.uIdx], uLen );
+            }
+            break;
+        }
+
+        const char* end = &text[uIdx];
+        if( end[0] == '.' && end[1] == '.' && end[2] == '.' ) {
+            at( nIdx ).rep = true;
+            uIdx += 3;
+        }
+        *prev = nIdx;
+    }
+
+    constexpr void
+    compileSeq( unsigned alt, char close ) {
+        unsigned prev = 0;
+        for( ;; ) {
+            while( isSpace( text[uIdx] ) )
+                uIdx++;
+
+            char chr = text[uIdx];
+            if( chr == close || (close && chr == '|') )
+                return;
+
+            if( chr == '\0' || chr == ']' || chr == '}' ) {
+                if( !close )
+                    strayBracketInUsage();
+                else
+                if( close == ']' )
+                    unterminatedOptionalGroupInUsage();
+                else
+                    unterminatedRequiredGroupInUsage();
+                return;
+            }
+
+            compileThing( alt, &prev );
+        }
+    }
+
+    constexpr void
+    compile() {
+        unsigned root = addNode( Kind::ALT, 0, 0 );
+        compileSeq( root, '\0' );
+        at( root ).uLen = uIdx;
+    }
+};
+
+constexpr unsigned
+countNodes( const char* text ) {
+    Compiler c = { text };
+    c.compile();
+    return c.count;
+}
+
+// Different names with the same id couldn't be told apart
+// by handlers, so that's an error too
+template<unsigned N, unsigned L>
+constexpr void
+checkIds( const Grammar<N, L>& g ) {
+    struct Name {
+        const char*   str;
+        unsigned      len;
+        std::uint32_t id;
+    };
+    Name     names[N*2 + L] = {};
+    unsigned count = 0;
+    for( unsigned i = 1 ; i < N ; i++ ) {
+        const Node& node = g.nodes[i];
+        const char* uStr = &g.usage[node.uIdx];
+        if( node.kind == Kind::PARAM )
+            names[count++] = { uStr, node.uLen, node.nId };
+        if( node.kind == Kind::LONG ) {
+            names[count++] = { uStr, node.nLen, node.nId };
+            if( uStr[node.nLen] == '=' )
+                names[count++] = { &uStr[node.nLen + 1], node.uLen - node.nLen - 1, node.vId };
+        }
+        for( unsigned j = 0 ; node.kind == Kind::SHORT && j < node.uLen ; j++ )
+            names[count++] = { &uStr[j], 1, id( &uStr[j], 1 ) };
+    }
+
+    for( unsigned i = 0 ; i < count ; i++ ) {
+        for( unsigned j = 0 ; j < i ; j++ ) {
+            if( names[i].id != names[j].id )
+                continue;
+            bool same = names[i].len == names[j].len;
+            for( unsigned k = 0 ; same && k < names[i].len ; k++ )
+                same = names[i].str[k] == names[j].str[k];
+            if( !same )
+                namesInUsageHaveTheSameId();
+        }
+    }
+}
+
+template<unsigned N, unsigned L>
+constexpr Grammar<N, L>
+build( const char* text ) {
+    Grammar<N, L> g = {};
+    for( unsigned i = 0 ; i < L ; i++ )
+        g.usage[i] = text[i];
+
+    Compiler c = { g.usage };
+    c.nodes = g.nodes;
+    c.compile();
+    checkIds( g );
+    return g;
+}
+
+} // namespace detail
+
+// Compiles the usage returned by a constexpr function object,
+// see lnA_USAGE()
+template<class S>
+constexpr auto
+compile( S str ) {
+    constexpr const char* text = str();
+    constexpr unsigned    n    = detail::countNodes( text );
+    constexpr unsigned    len  = length( text ) + 1;
+    constexpr Grammar<n, len> g = detail::build<n, len>( text );
+    return g;
+}
+
+// Matches arguments with a compiled usage, all of
+// the work is spread over templates for each node
+template<const auto& G>
+struct Matcher {
+    char**     argv;
+    lnA_Error* err;
+
+    // Records a failure, returns -1 for the caller to return
+    int
+    fail( int code, unsigned uIdx, unsigned uLen, char chr, unsigned aIdx ) {
+        *err = lnA_Error{};
+        err->code = code;
+        err->uIdx = uIdx;
+        err->uLen = uLen;
+        err->aIdx = aIdx;
+        err->arg  = argv[aIdx];
+        err->chr  = chr;
+        return -1;
+    }
+
+    static bool
+    isParam( const char* arg ) {
+        return arg && arg[0] != '-';
+    }
+
+    // Matching returns the index past the match, or -1 on
+    // failure.  Handlers are only called when 'Emit' is set,
+    // and never for a match that fails
+    template<unsigned I, bool Emit, class F>
+    int
+    once( unsigned aIdx, F& f ) {
+        constexpr Node node = G.nodes[I];
+        constexpr const char* uStr = &G.usage[node.uIdx];
+        char* arg = argv[aIdx];
+
+        if constexpr( node.kind == Kind::PARAM ) {
+            if( !isParam( arg ) )
+                return fail( lnA_E_MISSING_PARAM, node.uIdx, node.uLen, 0, aIdx );
+            if constexpr( Emit )
+                f( node.nId, arg );
+            return aIdx + 1;
+        }
+        else
+        if constexpr( node.kind == Kind::SHORT ) {
+            if( !arg || arg[0] != '-' || arg[1] == '-' || !detail::isGraph( arg[1] ) )
+                return fail( lnA_E_MISSING_FLAG, node.uIdx, node.uLen, 0, aIdx );
+            for( char* c = &arg[1] ; *c ; c++ ) {
+                bool ok = false;
+                for( unsigned i = 0 ; i < node.uLen ; i++ )
+                    ok |= uStr[i] == *c;
+                if( !ok )
+                    return fail( lnA_E_INVALID_FLAG, node.uIdx, node.uLen, *c, aIdx );
+            }
+            if constexpr( Emit ) {
+                for( char* c = &arg[1] ; *c ; c++ )
+                    f( id( c, 1 ), arg );
+            }
+            return aIdx + 1;
+        }
+        else
+        if constexpr( node.kind == Kind::LONG ) {
+            if( !arg || arg[0] != '-' || arg[1] != '-' )
+                return fail( lnA_E_MISSING_OPTION, node.uIdx, node.nLen, 0, aIdx );
+            for( unsigned i = 0 ; i < node.nLen ; i++ ) {
+                if( arg[2 + i] != uStr[i] )
+                    return fail( lnA_E_MISSING_OPTION, node.uIdx, node.nLen, 0, aIdx );
+            }
+
+            // The name has to end there too
+            char brk = arg[2 + node.nLen];
+            if( detail::isGraph( brk ) && brk != '=' )
+                return fail( lnA_E_MISSING_OPTION, node.uIdx, node.nLen, 0, aIdx );
+
+            constexpr bool value = uStr[node.nLen] == '=';
+            if( !value && brk == '=' )
+                return fail( lnA_E_UNEXPECTED_VALUE, node.uIdx, node.nLen, 0, aIdx );
+            if( value && brk != '=' )
+                return fail( lnA_E_MISSING_VALUE, node.uIdx, node.nLen, 0, aIdx );
+
+            if constexpr( Emit ) {
+                f( node.nId, arg );
+                if constexpr( value )
+                    f( node.vId, &arg[3 + node.nLen] );
+            }
+            return aIdx + 1;
+        }
+        else {
+            return group<I, node.child, Emit>( aIdx, f );
+        }
+    }
+
+    // Tries alternative 'A' of group 'I' and the ones after it,
+    // the first to match wins.  Handlers are only called for
+    // an alternative once it's known to match
+    template<unsigned I, unsigned A, bool Emit, class F>
+    int
+    group( unsigned aIdx, F& f ) {
+        if constexpr( A == 0 ) {
+            return fail( lnA_E_MISSING_GROUP, G.nodes[I].uIdx, G.nodes[I].uLen, 0, aIdx );
+        }
+        else {
+            int end = seq<G.nodes[A].child, false>( aIdx, f );
+            if( end >= 0 ) {
+                if constexpr( Emit )
+                    seq<G.nodes[A].child, true>( aIdx, f );
+                return end;
+            }
+            return group<I, G.nodes[A].next, Emit>( aIdx, f );
+        }
+    }
+
+    template<unsigned I, bool Emit, class F>
+    int
+    thing( unsigned aIdx, F& f ) {
+        constexpr Node node = G.nodes[I];
+
+        // Repeated parameters are matched with a single scan
+        if constexpr( node.kind == Kind::PARAM && node.rep ) {
+            unsigned end = aIdx;
+            while( isParam( argv[end] ) )
+                end++;
+            if( end == aIdx )
+                return fail( lnA_E_MISSING_PARAM, node.uIdx, node.uLen, 0, aIdx );
+            if constexpr( Emit ) {
+                for( unsigned i = aIdx ; i < end ; i++ )
+                    f( node.nId, argv[i] );
+            }
+            return end;
+        }
+        else {
+            // Optional groups always match, sequences match once
+            // one repetition has matched, and stop once a match
+            // fails or stops consuming arguments
+            bool one = node.kind == Kind::OPTIONAL;
+            for( ;; ) {
+                int end = once<I, Emit>( aIdx, f );
+                if( end < 0 )
+                    return one ? (int)aIdx : -1;
+                if( !node.rep || (unsigned)end == aIdx )
+                    return end;
+                aIdx = end;
+                one  = true;
+            }
+        }
+    }
+
+    template<unsigned I, bool Emit, class F>
+    int
+    seq( unsigned aIdx, F& f ) {
+        if constexpr( I == 0 ) {
+            return aIdx;
+        }
+        else {
+            int end = thing<I, Emit>( aIdx, f );
+            if( end < 0 )
+                return -1;
+            return seq<G.nodes[I].next, Emit>( end, f );
+        }
+    }
+};
+
+// Matches the arguments with a usage from lnA_USAGE(), on
+// success calls the handler for each option and parameter
+// and returns lnA_OK; otherwise returns the error code and
+// describes it in *err, if given
+template<const auto& G, class F>
+int
+match( char** argv, F&& f, lnA_Error* err = nullptr ) {
+    lnA_Error   e = {};
+    Matcher<G> m = { argv, &e };
+
+    int end = m.template seq<G.nodes[0].child, false>( 0, f );
+    if( end >= 0 && argv[end] )
+        end = m.fail( lnA_E_EXTRA_WORD, 0, 0, 0, end );
+    if( end >= 0 ) {
+        m.template seq<G.nodes[0].child, true>( 0, f );
+        e = lnA_Error{};
+    }
+
+    if( err )
+        *err = e;
+    return e.code;
+}
+
+// Formats the message for an error from match() like
+// lnA_errorText(), but into the given buffer; returns
+// the length like snprintf()
+template<const auto& G>
+int
+errorText( const lnA_Error& err, char* buf, size_t size ) {
+    const char* uStr = &G.usage[err.uIdx];
+    int         uLen = err.uLen;
+    switch( err.code ) {
+        case lnA_OK:
+            if( size )
+                *buf = '\0';
+            return 0;
+        case lnA_E_MISSING_OPTION:
+            return snprintf( buf, size, "Missing --%.*s option", uLen, uStr );
+        case lnA_E_UNEXPECTED_VALUE:
+            return snprintf( buf, size, "Unexpected argument for --%.*s option", uLen, uStr );
+        case lnA_E_MISSING_VALUE:
+            return snprintf( buf, size, "Missing argument for --%.*s option", uLen, uStr );
+        case lnA_E_MISSING_FLAG:
+            return snprintf( buf, size, "Missing -%.*s flag(s)", uLen, uStr );
+        case lnA_E_INVALID_FLAG:
+            return snprintf( buf, size, "Invalid flag '%c' for -%.*s flag(s)", err.chr, uLen, uStr );
+        case lnA_E_MISSING_PARAM:
+            return snprintf( buf, size, "Missing %.*s parameter", uLen, uStr );
+        case lnA_E_MISSING_GROUP:
+            return snprintf( buf, size, "Missing group %.*s", uLen, uStr );
+        default:
+            return snprintf( buf, size, "Extra or unmatched word '%s'", err.arg );
+    }
+}
+
+} // namespace lnA
+
+// Compiles a usage string literal into a constexpr grammar,
+// which is an error if the usage is malformed
+#define lnA_USAGE( str ) (::lnA::compile( []{ return str; } ))
+
+#endif
@@ -0,0 +1,1076 @@
+// Generates a standalone C matcher from a spec file holding
+// the lnA_addUsage(), lnA_addOption(), lnA_addParam(), and
+// lnA_addParamSlice() calls a program would make at startup.
+// Usages are compiled by line-arg.c itself, so the generated
+// code follows exactly the same nodes and matching rules;
+// each node becomes a function with its option and parameter
+// lookups resolved ahead of time.
+//
+//     lnA-gen SPEC NAME
+//
+// Writes NAME.c and NAME.h, with every symbol prefixed by the
+// base name of NAME.  The generated code only needs line-arg.h
+// for the error codes and lnA_Error.
+//
+// Calls the generated code can't honor, like typed parameters,
+// limits, and matching flags, are rejected rather than ignored.
+
+// For strdup()
+#define _POSIX_C_SOURCE 200809L
+
+#include "line-arg-int.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <errno.h>
+
+typedef enum lnA_GenKind {
+    lnA_G_END,
+    lnA_G_IDENT,
+    lnA_G_STRING,
+    lnA_G_PUNCT
+} lnA_GenKind;
+
+typedef struct lnA_GenLexer {
+    char*       path;   // Spec file name, for errors
+    char*       text;   // Spec file contents
+    char*       pos;    // Current position
+    unsigned    line;   // Current line
+    
+    lnA_GenKind kind;   // Kind of the current token
+    char*       tStr;   // Identifier or string value
+    size_t      tLen;   // Length of the token value
+    char        tChr;   // Punctuation character
+} lnA_GenLexer;
+
+// An option or parameter from the spec, along with
+// the name of its callback
+typedef struct lnA_GenItem {
+    void* item;   // lnA_Option* or lnA_Param*
+    char* cb;     // Callback name, NULL if none
+} lnA_GenItem;
+
+typedef struct lnA_Gen {
+    lnA_Parser*  par;
+    lnA_GenItem* items;
+    unsigned     iCount;
+    unsigned     iCap;
+    
+    FILE*        out;    // Generated source
+    char*        pre;    // Symbol prefix
+    lnA_Usage*   usg;    // Usage being generated
+} lnA_Gen;
+
+static void
+genDie( lnA_GenLexer* lex, char* fmt, ... ) {
+    va_list args;
+    va_start( args, fmt );
+    fprintf( stderr, "%s:%u: ", lex->path, lex->line );
+    vfprintf( stderr, fmt, args );
+    fprintf( stderr, "\n" );
+    va_end( args );
+    exit( 1 );
+}
+
+static char*
+genRead( char* path ) {
+    FILE* file = fopen( path, "rb" );
+    if( !file )
+        return NULL;
+    
+    size_t size = 0;
+    size_t cap  = 4096;
+    char*  text = malloc( cap );
+    size_t got;
+    while( (got = fread( &text[size], 1, cap - size - 1, file )) > 0 ) {
+        size += got;
+        if( cap - size == 1 ) {
+            cap *= 2;
+            text = realloc( text, cap );
+        }
+    }
+    fclose( file );
+    text[size] = '\0';
+    return text;
+}
+
+// Appends a string literal's value to the token,
+// the opening quote has already been skipped
+static void
+genString( lnA_GenLexer* lex, char** buf, size_t* cap ) {
+    char* c = lex->pos;
+    while( *c != '"' ) {
+        if( !*c || *c == '\n' )
+            genDie( lex, "Unterminated string" );
+        
+        char chr = *c++;
+        if( chr == '\\' ) {
+            chr = *c++;
+            switch( chr ) {
+                case 'n': chr = '\n'; break;
+                case 't': chr = '\t'; break;
+                case 'r': chr = '\r'; break;
+                case '0': chr = '\0'; break;
+                case '\\':
+                case '\'':
+                case '"':
+                case '?':
+                break;
+                default:
+                    genDie( lex, "Unsupported escape '\\%c'", chr );
+            }
+            if( !chr )
+                genDie( lex, "Strings can't hold NUL characters" );
+        }
+        
+        if( lex->tLen + 2 > *cap ) {
+            *cap = *cap ? *cap*2 : 64;
+            *buf = realloc( *buf, *cap );
+        }
+        (*buf)[lex->tLen++] = chr;
+        (*buf)[lex->tLen]   = '\0';
+    }
+    lex->pos = c + 1;
+}
+
+// Skips whitespace and comments
+static void
+genSkip( lnA_GenLexer* lex ) {
+    for( ;; ) {
+        char* c = lex->pos;
+        if( *c == '\n' ) {
+            lex->line++;
+            lex->pos++;
+        }
+        else
+        if( isspace( (unsigned char)*c ) ) {
+            lex->pos++;
+        }
+        else
+        if( c[0] == '/' && c[1] == '/' ) {
+            while( *lex->pos && *lex->pos != '\n' )
+                lex->pos++;
+        }
+        else
+        if( c[0] == '/' && c[1] == '*' ) {
+            char* end = strstr( &c[2], "*/" );
+            if( !end )
+                genDie( lex, "Unterminated comment" );
+            for( ; c < end ; c++ )
+                lex->line += *c == '\n';
+            lex->pos = end + 2;
+        }
+        else {
+            return;
+        }
+    }
+}
+
+// Reads the next token, adjacent string literals
+// are joined like the compiler would
+static void
+genNext( lnA_GenLexer* lex ) {
+    genSkip( lex );
+    char* c = lex->pos;
+    if( !*c ) {
+        lex->kind = lnA_G_END;
+        return;
+    }
+    
+    if( isalpha( (unsigned char)*c ) || *c == '_' ) {
+        while( isalnum( (unsigned char)*c ) || *c == '_' )
+            c++;
+        lex->kind = lnA_G_IDENT;
+        lex->tStr = lex->pos;
+        lex->tLen = c - lex->pos;
+        lex->pos  = c;
+        return;
+    }
+    
+    if( *c == '"' ) {
+        char*  buf = NULL;
+        size_t cap = 0;
+        lex->kind = lnA_G_STRING;
+        lex->tLen = 0;
+        while( *lex->pos == '"' ) {
+            lex->pos++;
+            genString( lex, &buf, &cap );
+            genSkip( lex );
+        }
+        if( !buf )
+            buf = calloc( 1, 1 );
+        lex->tStr = buf;
+        return;
+    }
+    
+    // Character literals could hold a quote
+    if( *c == '\'' ) {
+        c++;
+        while( *c && *c != '\'' && *c != '\n' )
+            c += *c == '\\' ? 2 : 1;
+        lex->pos = *c == '\'' ? c + 1 : c;
+        lex->kind = lnA_G_PUNCT;
+        lex->tChr = '\'';
+        return;
+    }
+    
+    lex->kind = lnA_G_PUNCT;
+    lex->tChr = *c;
+    lex->pos++;
+}
+
+static bool
+genIs( lnA_GenLexer* lex, char* ident ) {
+    return lex->kind == lnA_G_IDENT && lex->tLen == strlen( ident ) && !memcmp( lex->tStr, ident, lex->tLen );
+}
+
+static bool
+genPunct( lnA_GenLexer* lex, char chr ) {
+    return lex->kind == lnA_G_PUNCT && lex->tChr == chr;
+}
+
+// Argument of a spec call, a string, NULL, or the last
+// identifier in the argument (so '&cb' and casts work)
+typedef struct lnA_GenArg {
+    bool  isStr;
+    char* str;    // String or identifier, NULL for NULL
+} lnA_GenArg;
+
+// Reads the arguments of a call, the current token
+// is the function name
+static unsigned
+genArgs( lnA_GenLexer* lex, lnA_GenArg* args, unsigned max ) {
+    genNext( lex );
+    if( !genPunct( lex, '(' ) )
+        genDie( lex, "Expected '('" );
+    genNext( lex );
+    
+    unsigned count = 0;
+    unsigned depth = 0;
+    lnA_GenArg arg = { 0 };
+    for( ;; ) {
+        if( lex->kind == lnA_G_END )
+            genDie( lex, "Unterminated call" );
+        
+        if( depth == 0 && (genPunct( lex, ',' ) || genPunct( lex, ')' )) ) {
+            if( count == max )
+                genDie( lex, "Too many arguments" );
+            args[count++] = arg;
+            arg = (lnA_GenArg){ 0 };
+            if( genPunct( lex, ')' ) )
+                return count;
+        }
+        else
+        if( genPunct( lex, '(' ) ) {
+            depth++;
+        }
+        else
+        if( genPunct( lex, ')' ) ) {
+            depth--;
+        }
+        else
+        if( lex->kind == lnA_G_STRING ) {
+            arg.isStr = true;
+            arg.str   = lex->tStr;
+        }
+        else
+        if( lex->kind == lnA_G_IDENT && !arg.isStr ) {
+            bool null = genIs( lex, "NULL" );
+            arg.str = null ? NULL : strndup( lex->tStr, lex->tLen );
+        }
+        else
+        if( lex->kind == lnA_G_PUNCT && lex->tChr == '0' && !arg.isStr ) {
+            arg.str = NULL;
+        }
+        genNext( lex );
+    }
+}
+
+// Spec strings are the only copy, so they're kept
+// for the life of the generator like lnA expects
+static char*
+genStr( lnA_GenLexer* lex, lnA_GenArg* arg, bool null ) {
+    if( !arg->isStr && (!null || arg->str) )
+        genDie( lex, "Expected a string literal" );
+    return arg->str;
+}
+
+static char*
+genCb( lnA_GenLexer* lex, lnA_GenArg* arg ) {
+    if( arg->isStr )
+        genDie( lex, "Expected a callback name" );
+    return arg->str;
+}
+
+static void
+genItem( lnA_Gen* gen, void* item, char* cb ) {
+    if( gen->iCount == gen->iCap ) {
+        gen->iCap  = gen->iCap ? gen->iCap*2 : 16;
+        gen->items = realloc( gen->items, gen->iCap*sizeof(lnA_GenItem) );
+    }
+    gen->items[gen->iCount++] = (lnA_GenItem){ item, cb };
+}
+
+static char*
+genCbOf( lnA_Gen* gen, void* item ) {
+    for( unsigned i = 0 ; i < gen->iCount ; i++ ) {
+        if( gen->items[i].item == item )
+            return gen->items[i].cb;
+    }
+    return NULL;
+}
+
+// Stands in for callbacks named in the spec, so the
+// parser knows which options and parameters have one
+static void
+genOptionCb( char* str, void* udata ) {
+    (void)str;
+    (void)udata;
+}
+
+static void
+genSliceCb( char** args, size_t n, void* udata ) {
+    (void)args;
+    (void)n;
+    (void)udata;
+}
+
+static void
+genSpec( lnA_Gen* gen, lnA_GenLexer* lex ) {
+    lnA_GenArg args[6];
+    for( genNext( lex ) ; lex->kind != lnA_G_END ; genNext( lex ) ) {
+        if( genIs( lex, "lnA_addUsage" ) ) {
+            if( genArgs( lex, args, 6 ) != 2 )
+                genDie( lex, "lnA_addUsage() takes 2 arguments" );
+            lnA_Usage* usg = lnA_addUsage( gen->par, genStr( lex, &args[1], false ) );
+            if( usg->eText )
+                genDie( lex, "%s in usage \"%s\"", usg->eText, usg->usage );
+        }
+        else
+        if( genIs( lex, "lnA_addOption" ) ) {
+            if( genArgs( lex, args, 6 ) != 5 )
+                genDie( lex, "lnA_addOption() takes 5 arguments" );
+            char* cb = genCb( lex, &args[4] );
+            lnA_addOption(
+                gen->par,
+                genStr( lex, &args[1], true ),
+                genStr( lex, &args[2], true ),
+                genStr( lex, &args[3], true ),
+                cb ? &genOptionCb : NULL
+            );
+            genItem( gen, gen->par->oList, cb );
+        }
+        else
+        if( genIs( lex, "lnA_addParam" ) || genIs( lex, "lnA_addParamSlice" ) ) {
+            bool slice = genIs( lex, "lnA_addParamSlice" );
+            if( genArgs( lex, args, 6 ) != 3 )
+                genDie( lex, "Parameters take 3 arguments" );
+            char* name = genStr( lex, &args[1], false );
+            char* cb   = genCb( lex, &args[2] );
+            if( slice )
+                lnA_addParamSlice( gen->par, name, cb ? &genSliceCb : NULL );
+            else
+                lnA_addParam( gen->par, name, cb ? &genOptionCb : NULL );
+            genItem( gen, gen->par->pList, cb );
+        }
+        else
+        if( lex->kind == lnA_G_IDENT && lex->tLen > 4 && !memcmp( lex->tStr, "lnA_", 4 ) ) {
+            // Typed parameters, limits, flags like lnA_STREAM, and
+            // collected matches would silently do nothing
+            genDie( lex, "%.*s isn't supported by generated matchers", (int)lex->tLen, lex->tStr );
+        }
+    }
+    
+    if( !gen->par->uCount )
+        genDie( lex, "No usages" );
+}
+
+// Writes a string as a C literal, '?' is escaped
+// so it can't start a trigraph
+static void
+genLiteral( FILE* out, char* str, size_t len ) {
+    fputc( '"', out );
+    for( size_t i = 0 ; i < len ; i++ ) {
+        unsigned char chr = str[i];
+        if( chr == '"' || chr == '\\' || chr == '?' )
+            fprintf( out, "\\%c", chr );
+        else
+        if( isprint( chr ) )
+            fputc( chr, out );
+        else
+            fprintf( out, "\\%03o", chr );
+    }
+    fputc( '"', out );
+}
+
+// Writes text with each '@' replaced by the prefix
+static void
+genText( lnA_Gen* gen, char* text ) {
+    for( char* c = text ; *c ; c++ ) {
+        if( *c == '@' )
+            fputs( gen->pre, gen->out );
+        else
+            fputc( *c, gen->out );
+    }
+}
+
+static char* lnA_genHead =
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "#include <ctype.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdbool.h>\n"
+    "\n"
+    "// Callback journal entry, a slice with 'str' set is just that string\n"
+    "typedef struct @_Queued {\n"
+    "    void\n"
+    "    (*callback)( char* str, void* udata );\n"
+    "    \n"
+    "    lnA_SliceCb slice;\n"
+    "    char*       str;\n"
+    "    unsigned    aIdx;\n"
+    "    unsigned    nArgs;\n"
+    "} @_Queued;\n"
+    "\n"
+    "typedef struct @_State {\n"
+    "    char**     argv;   // Arguments being matched\n"
+    "    unsigned   aIdx;   // Index into the arguments\n"
+    "    lnA_Error* err;    // Where failures are recorded\n"
+    "    @_Queued*  queue;  // Callback journal\n"
+    "    unsigned   qLen;   // Number of queued callbacks\n"
+    "    unsigned   qCap;   // Allocated journal entries\n"
+    "    @_Queued   local[32]; // Journal entries that don't need malloc()\n"
+    "} @_State;\n"
+    "\n"
+    "static inline void\n"
+    "@_queue( @_State* st, void (*cb)( char* str, void* udata ), lnA_SliceCb slice, char* str, unsigned aIdx, unsigned n ) {\n"
+    "    if( st->qLen == st->qCap ) {\n"
+    "        unsigned qCap = st->qCap*2;\n"
+    "        if( st->queue == st->local ) {\n"
+    "            st->queue = malloc( qCap*sizeof(@_Queued) );\n"
+    "            memcpy( st->queue, st->local, st->qLen*sizeof(@_Queued) );\n"
+    "        }\n"
+    "        else {\n"
+    "            st->queue = realloc( st->queue, qCap*sizeof(@_Queued) );\n"
+    "        }\n"
+    "        st->qCap = qCap;\n"
+    "    }\n"
+    "    st->queue[st->qLen++] = (@_Queued){ cb, slice, str, aIdx, n };\n"
+    "}\n"
+    "\n"
+    "static inline int\n"
+    "@_fail( @_State* st, int code, unsigned uIdx, unsigned uLen, char chr ) {\n"
+    "    *st->err = (lnA_Error){\n"
+    "        .code = code,\n"
+    "        .uIdx = uIdx,\n"
+    "        .uLen = uLen,\n"
+    "        .aIdx = st->aIdx,\n"
+    "        .arg  = st->argv[st->aIdx],\n"
+    "        .chr  = chr\n"
+    "    };\n"
+    "    return code;\n"
+    "}\n"
+    "\n"
+    "static inline bool\n"
+    "@_isParam( char* arg ) {\n"
+    "    return arg && arg[0] != '-';\n"
+    "}\n"
+    "\n"
+    "static inline bool\n"
+    "@_isShort( char* arg ) {\n"
+    "    return arg && arg[0] == '-' && arg[1] != '-' && isgraph( (unsigned char)arg[1] );\n"
+    "}\n"
+    "\n"
+    "static inline bool\n"
+    "@_isLong( char* arg ) {\n"
+    "    return arg && arg[0] == '-' && arg[1] == '-';\n"
+    "}\n"
+    "\n"
+    "// Long option names end at the first '=' or non graphic character\n"
+    "static inline bool\n"
+    "@_isName( char chr ) {\n"
+    "    return isgraph( (unsigned char)chr ) && chr != '=';\n"
+    "}\n"
+    "\n";
+
+static char* lnA_genTail =
+    "static int\n"
+    "@_run( @_State* st, unsigned usage ) {\n"
+    "    st->aIdx = 0;\n"
+    "    st->qLen = 0;\n"
+    "    int code = @_roots[usage]( st );\n"
+    "    if( !code && st->argv[st->aIdx] )\n"
+    "        code = @_fail( st, lnA_E_EXTRA_WORD, 0, 0, 0 );\n"
+    "    return code;\n"
+    "}\n"
+    "\n"
+    "static void\n"
+    "@_invoke( @_State* st, void* udata ) {\n"
+    "    for( unsigned i = 0 ; i < st->qLen ; i++ ) {\n"
+    "        @_Queued* q = &st->queue[i];\n"
+    "        if( q->slice )\n"
+    "            q->slice( q->str ? &q->str : &st->argv[q->aIdx], q->nArgs, udata );\n"
+    "        else\n"
+    "            q->callback( q->str, udata );\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static void\n"
+    "@_init( @_State* st, char** argv, lnA_Error* err ) {\n"
+    "    st->argv  = argv;\n"
+    "    st->aIdx  = 0;\n"
+    "    st->err   = err;\n"
+    "    st->queue = st->local;\n"
+    "    st->qLen  = 0;\n"
+    "    st->qCap  = sizeof(st->local)/sizeof(st->local[0]);\n"
+    "}\n"
+    "\n"
+    "static void\n"
+    "@_done( @_State* st, void* udata, int code ) {\n"
+    "    if( !code ) {\n"
+    "        @_invoke( st, udata );\n"
+    "        *st->err = (lnA_Error){ 0 };\n"
+    "    }\n"
+    "    if( st->queue != st->local )\n"
+    "        free( st->queue );\n"
+    "}\n"
+    "\n"
+    "int\n"
+    "@_match( unsigned usage, char** argv, void* udata, lnA_Error* err ) {\n"
+    "    @_State st;\n"
+    "    @_init( &st, argv, err );\n"
+    "    \n"
+    "    int code;\n"
+    "    if( usage < @_USAGE_COUNT )\n"
+    "        code = @_run( &st, usage );\n"
+    "    else\n"
+    "        code = @_fail( &st, lnA_E_NO_USAGES, 0, 0, 0 );\n"
+    "    @_done( &st, udata, code );\n"
+    "    return code;\n"
+    "}\n"
+    "\n"
+    "int\n"
+    "@_matchAll( char** argv, void* udata, lnA_Error* err, unsigned* usage ) {\n"
+    "    @_State st;\n"
+    "    @_init( &st, argv, err );\n"
+    "    \n"
+    "    // The first usage to match wins, otherwise the one\n"
+    "    // that got the farthest is reported\n"
+    "    lnA_Error best = { 0 };\n"
+    "    unsigned  bIdx = 0;\n"
+    "    int       code = lnA_E_NO_USAGES;\n"
+    "    for( unsigned i = 0 ; i < @_USAGE_COUNT ; i++ ) {\n"
+    "        code = @_run( &st, i );\n"
+    "        if( !code ) {\n"
+    "            bIdx = i;\n"
+    "            break;\n"
+    "        }\n"
+    "        if( !i || err->aIdx > best.aIdx ) {\n"
+    "            best = *err;\n"
+    "            bIdx = i;\n"
+    "        }\n"
+    "    }\n"
+    "    if( code ) {\n"
+    "        *err = best;\n"
+    "        code = best.code;\n"
+    "    }\n"
+    "    if( usage )\n"
+    "        *usage = bIdx;\n"
+    "    \n"
+    "    @_done( &st, udata, code );\n"
+    "    return code;\n"
+    "}\n"
+    "\n"
+    "int\n"
+    "@_errorText( unsigned usage, const lnA_Error* err, char* buf, size_t size ) {\n"
+    "    if( !err->code ) {\n"
+    "        if( size )\n"
+    "            *buf = '\\0';\n"
+    "        return 0;\n"
+    "    }\n"
+    "    \n"
+    "    char*    uStr = usage < @_USAGE_COUNT ? &@_usages[usage][err->uIdx] : \"\";\n"
+    "    unsigned uLen = err->uLen;\n"
+    "    switch( err->code ) {\n"
+    "        case lnA_E_OPTION_INFO:\n"
+    "            return snprintf( buf, size, \"Missing option info\" );\n"
+    "        case lnA_E_MISSING_OPTION:\n"
+    "            return snprintf( buf, size, \"Missing --%.*s option\", uLen, uStr );\n"
+    "        case lnA_E_UNEXPECTED_VALUE:\n"
+    "            return snprintf( buf, size, \"Unexpected argument for --%.*s option\", uLen, uStr );\n"
+    "        case lnA_E_MISSING_VALUE:\n"
+    "            return snprintf( buf, size, \"Missing argument for --%.*s option\", uLen, uStr );\n"
+    "        case lnA_E_MISSING_FLAG:\n"
+    "            return snprintf( buf, size, \"Missing -%.*s flag(s)\", uLen, uStr );\n"
+    "        case lnA_E_INVALID_FLAG:\n"
+    "            return snprintf( buf, size, \"Invalid flag '%c' for -%.*s flag(s)\", err->chr, uLen, uStr );\n"
+    "        case lnA_E_MISSING_PARAM:\n"
+    "            return snprintf( buf, size, \"Missing %.*s parameter\", uLen, uStr );\n"
+    "        case lnA_E_MISSING_GROUP:\n"
+    "            return snprintf( buf, size, \"Missing group %.*s\", uLen, uStr );\n"
+    "        case lnA_E_EXTRA_WORD:\n"
+    "            return snprintf( buf, size, \"Extra or unmatched word '%s'\", err->arg );\n"
+    "        case lnA_E_SOURCE_FAILED:\n"
+    "            return snprintf( buf, size, \"Couldn't read all of the arguments\" );\n"
+    "        case lnA_E_BAD_VALUE: {\n"
+    "            // Just the value of a '--name=value' argument\n"
+    "            char* val = err->arg;\n"
+    "            if( val[0] == '-' && val[1] == '-' && strchr( val, '=' ) )\n"
+    "                val = strchr( val, '=' ) + 1;\n"
+    "            return snprintf( buf, size, \"Invalid %.*s value '%s'\", uLen, uStr, val );\n"
+    "        }\n"
+    "        case lnA_E_STEP_LIMIT:\n"
+    "            return snprintf( buf, size, \"Gave up matching after too many steps\" );\n"
+    "        case lnA_E_DEPTH_LIMIT:\n"
+    "            return snprintf( buf, size, \"Usage nests groups too deeply\" );\n"
+    "        default:\n"
+    "            return snprintf( buf, size, \"No usages\" );\n"
+    "    }\n"
+    "}\n";
+
+// Node functions are named by usage and node index, 'n'
+// for a single match of a node and 's' for the sequence
+// of an alternative
+static void
+genName( lnA_Gen* gen, char kind, unsigned nIdx ) {
+    fprintf( gen->out, "%s_u%u_%c%u", gen->pre, gen->usg->id, kind, nIdx );
+}
+
+static void
+genFail( lnA_Gen* gen, char* code, unsigned uIdx, unsigned uLen, char* chr ) {
+    fprintf( gen->out, "return %s_fail( st, %s, %u, %u, %s );\n", gen->pre, code, uIdx, uLen, chr );
+}
+
+static void
+genCase( lnA_Gen* gen, unsigned char chr ) {
+    if( isalnum( chr ) )
+        fprintf( gen->out, "            case '%c':", chr );
+    else
+        fprintf( gen->out, "            case (char)%u:", chr );
+}
+
+// Writes a call that queues the callback of a parameter
+static void
+genQueueParam( lnA_Gen* gen, lnA_Param* prm, char* pad, char* str, char* aIdx, char* n ) {
+    char* cb = prm ? genCbOf( gen, prm ) : NULL;
+    if( !cb )
+        return;
+    if( prm->slice )
+        fprintf( gen->out, "%s%s_queue( st, NULL, &%s, %s, %s, %s );\n", pad, gen->pre, cb, str, aIdx, n );
+    else
+        fprintf( gen->out, "%s%s_queue( st, &%s, NULL, %s, 0, 0 );\n", pad, gen->pre, cb, str );
+}
+
+static void
+genParam( lnA_Gen* gen, lnA_Node* node ) {
+    FILE* out = gen->out;
+    fprintf( out, "    if( !%s_isParam( st->argv[st->aIdx] ) )\n        ", gen->pre );
+    genFail( gen, "lnA_E_MISSING_PARAM", node->uIdx, node->uLen, "0" );
+    
+    lnA_Param* prm = lnA_findParam( gen->par, &gen->usg->usage[node->uIdx], node->uLen );
+    if( prm && prm->slice )
+        genQueueParam( gen, prm, "    ", "NULL", "st->aIdx", "1" );
+    else
+        genQueueParam( gen, prm, "    ", "st->argv[st->aIdx]", "", "" );
+}
+
+static void
+genShort( lnA_Gen* gen, lnA_Node* node ) {
+    FILE* out  = gen->out;
+    char* fStr = &gen->usg->usage[node->uIdx];
+    
+    // Each allowed letter once, so they can be switch cases
+    bool seen[256] = { 0 };
+    char flags[256];
+    unsigned fCount = 0;
+    for( unsigned i = 0 ; i < node->uLen ; i++ ) {
+        unsigned char chr = fStr[i];
+        if( !seen[chr] ) {
+            seen[chr] = true;
+            flags[fCount++] = chr;
+        }
+    }
+    
+    fprintf( out, "    char* arg = st->argv[st->aIdx];\n" );
+    fprintf( out, "    if( !%s_isShort( arg ) )\n        ", gen->pre );
+    genFail( gen, "lnA_E_MISSING_FLAG", node->uIdx, node->uLen, "0" );
+    
+    fprintf( out, "    for( char* c = &arg[1] ; *c ; c++ ) {\n" );
+    fprintf( out, "        switch( *c ) {\n" );
+    for( unsigned i = 0 ; i < fCount ; i++ ) {
+        genCase( gen, flags[i] );
+        fprintf( out, "\n" );
+    }
+    fprintf( out, "            break;\n" );
+    fprintf( out, "            default:\n                " );
+    genFail( gen, "lnA_E_INVALID_FLAG", node->uIdx, node->uLen, "*c" );
+    fprintf( out, "        }\n    }\n" );
+    
+    fprintf( out, "    for( char* c = &arg[1] ; *c ; c++ ) {\n" );
+    fprintf( out, "        switch( *c ) {\n" );
+    for( unsigned i = 0 ; i < fCount ; i++ ) {
+        genCase( gen, flags[i] );
+        lnA_Option* opt = lnA_findOptionShort( gen->par, flags[i] );
+        char*       cb  = opt ? genCbOf( gen, opt ) : NULL;
+        if( !opt ) {
+            fprintf( out, "\n                " );
+            genFail( gen, "lnA_E_OPTION_INFO", node->uIdx, node->uLen, "*c" );
+            continue;
+        }
+        if( cb ) {
+            fprintf( out, "\n                %s_queue( st, &%s, NULL, ", gen->pre, cb );
+            genLiteral( out, opt->sForm, strlen( opt->sForm ) );
+            fprintf( out, ", 0, 0 );\n                break;\n" );
+        }
+        else {
+            fprintf( out, " break;\n" );
+        }
+    }
+    fprintf( out, "        }\n    }\n" );
+}
+
+static void
+genLong( lnA_Gen* gen, lnA_Node* node ) {
+    FILE*    out  = gen->out;
+    char*    uStr = &gen->usg->usage[node->uIdx];
+    unsigned uBrk = node->nLen;
+    unsigned uLen = node->uLen;
+    
+    lnA_Option* opt = lnA_findOptionLong( gen->par, uStr, uBrk );
+    if( !opt ) {
+        fprintf( out, "    " );
+        genFail( gen, "lnA_E_OPTION_INFO", node->uIdx, uBrk, "0" );
+        return;
+    }
+    
+    fprintf( out, "    char* arg = st->argv[st->aIdx];\n" );
+    fprintf( out, "    if( !%s_isLong( arg ) || strncmp( &arg[2], ", gen->pre );
+    genLiteral( out, uStr, uBrk );
+    fprintf( out, ", %u ) || %s_isName( arg[%u] ) )\n        ", uBrk, gen->pre, 2 + uBrk );
+    genFail( gen, "lnA_E_MISSING_OPTION", node->uIdx, uBrk, "0" );
+    
+    if( uStr[uBrk] != '=' ) {
+        fprintf( out, "    if( arg[%u] == '=' )\n        ", 2 + uBrk );
+        genFail( gen, "lnA_E_UNEXPECTED_VALUE", node->uIdx, uBrk, "0" );
+    }
+    else {
+        fprintf( out, "    if( arg[%u] != '=' )\n        ", 2 + uBrk );
+        genFail( gen, "lnA_E_MISSING_VALUE", node->uIdx, uBrk, "0" );
+    }
+    
+    char* cb = genCbOf( gen, opt );
+    if( cb ) {
+        fprintf( out, "    %s_queue( st, &%s, NULL, ", gen->pre, cb );
+        genLiteral( out, opt->lForm, opt->lLen );
+        fprintf( out, ", 0, 0 );\n" );
+    }
+    if( uStr[uBrk] == '=' ) {
+        char value[32];
+        snprintf( value, sizeof(value), "&arg[%u]", 3 + uBrk );
+        lnA_Param* prm = lnA_findParam( gen->par, &uStr[uBrk+1], uLen - uBrk - 1 );
+        genQueueParam( gen, prm, "    ", value, "0", "1" );
+    }
+}
+
+static void
+genGroup( lnA_Gen* gen, lnA_Node* node ) {
+    FILE* out = gen->out;
+    fprintf( out, "    unsigned qLen = st->qLen;\n" );
+    fprintf( out, "    unsigned aIdx = st->aIdx;\n" );
+    for( unsigned alt = node->child ; alt ; alt = gen->usg->nodes[alt].next ) {
+        fprintf( out, "    if( !" );
+        genName( gen, 's', alt );
+        fprintf( out, "( st ) )\n        return lnA_OK;\n" );
+        fprintf( out, "    st->qLen = qLen;\n" );
+        fprintf( out, "    st->aIdx = aIdx;\n" );
+    }
+    fprintf( out, "    " );
+    genFail( gen, "lnA_E_MISSING_GROUP", node->uIdx, node->uLen, "0" );
+}
+
+// Writes the sequence of an alternative, each node is
+// matched in turn with repetition handled in place
+static void
+genSeq( lnA_Gen* gen, lnA_Node* alt ) {
+    FILE* out = gen->out;
+    for( unsigned nIdx = alt->child ; nIdx ; nIdx = gen->usg->nodes[nIdx].next ) {
+        lnA_Node* node = &gen->usg->nodes[nIdx];
+        
+        // Repeated parameters are matched with a single scan
+        if( node->kind == lnA_PARAM && node->rep ) {
+            fprintf( out, "    {\n" );
+            fprintf( out, "        unsigned aIdx = st->aIdx;\n" );
+            fprintf( out, "        while( %s_isParam( st->argv[st->aIdx] ) )\n", gen->pre );
+            fprintf( out, "            st->aIdx++;\n" );
+            fprintf( out, "        if( st->aIdx == aIdx )\n            " );
+            genFail( gen, "lnA_E_MISSING_PARAM", node->uIdx, node->uLen, "0" );
+            
+            lnA_Param* prm = lnA_findParam( gen->par, &gen->usg->usage[node->uIdx], node->uLen );
+            if( prm && prm->slice ) {
+                genQueueParam( gen, prm, "        ", "NULL", "aIdx", "st->aIdx - aIdx" );
+            }
+            else
+            if( prm && genCbOf( gen, prm ) ) {
+                fprintf( out, "        for( unsigned i = aIdx ; i < st->aIdx ; i++ )\n" );
+                genQueueParam( gen, prm, "            ", "st->argv[i]", "", "" );
+            }
+            fprintf( out, "    }\n" );
+        }
+        else
+        if( node->rep ) {
+            // Stop repeating once a match fails or stops consuming
+            // arguments, optional groups never fail
+            fprintf( out, "    for( bool one = %s ;; one = true ) {\n", node->kind == lnA_OPTIONAL ? "true" : "false" );
+            fprintf( out, "        unsigned aIdx = st->aIdx;\n" );
+            fprintf( out, "        int      err  = " );
+            genName( gen, 'n', nIdx );
+            fprintf( out, "( st );\n" );
+            fprintf( out, "        if( err || st->aIdx == aIdx ) {\n" );
+            fprintf( out, "            if( err && !one )\n" );
+            fprintf( out, "                return err;\n" );
+            fprintf( out, "            break;\n" );
+            fprintf( out, "        }\n" );
+            fprintf( out, "    }\n" );
+        }
+        else
+        if( node->kind == lnA_OPTIONAL ) {
+            fprintf( out, "    " );
+            genName( gen, 'n', nIdx );
+            fprintf( out, "( st );\n" );
+        }
+        else {
+            fprintf( out, "    {\n" );
+            fprintf( out, "        int err = " );
+            genName( gen, 'n', nIdx );
+            fprintf( out, "( st );\n" );
+            fprintf( out, "        if( err )\n" );
+            fprintf( out, "            return err;\n" );
+            fprintf( out, "    }\n" );
+        }
+    }
+    fprintf( out, "    return lnA_OK;\n" );
+}
+
+// Option nodes start after their hyphens
+static unsigned
+genStart( lnA_Node* node ) {
+    if( node->kind == lnA_SHORT )
+        return node->uIdx - 1;
+    if( node->kind == lnA_LONG )
+        return node->uIdx - 2;
+    return node->uIdx;
+}
+
+static bool
+genNeeds( lnA_Node* node ) {
+    return node->kind == lnA_ALT || !(node->kind == lnA_PARAM && node->rep);
+}
+
+static void
+genNode( lnA_Gen* gen, unsigned nIdx ) {
+    lnA_Node* node = &gen->usg->nodes[nIdx];
+    if( !genNeeds( node ) )
+        return;
+    
+    // Alternatives are labeled with the text of their sequence
+    unsigned uIdx = genStart( node );
+    unsigned uEnd = node->uIdx + node->uLen;
+    if( !nIdx ) {
+        uEnd = strlen( gen->usg->usage );
+    }
+    else
+    if( node->kind == lnA_ALT && node->child ) {
+        uIdx = genStart( &gen->usg->nodes[node->child] );
+        for( unsigned n = node->child ; n ; n = gen->usg->nodes[n].next )
+            uEnd = gen->usg->nodes[n].uIdx + gen->usg->nodes[n].uLen;
+    }
+    fprintf( gen->out, "// " );
+    genLiteral( gen->out, &gen->usg->usage[uIdx], uEnd - uIdx );
+    fprintf( gen->out, "\nstatic int\n" );
+    genName( gen, node->kind == lnA_ALT ? 's' : 'n', nIdx );
+    fprintf( gen->out, "( %s_State* st ) {\n", gen->pre );
+    switch( node->kind ) {
+        case lnA_PARAM:
+            genParam( gen, node );
+            fprintf( gen->out, "    st->aIdx++;\n    return lnA_OK;\n" );
+        break;
+        case lnA_SHORT:
+            genShort( gen, node );
+            fprintf( gen->out, "    st->aIdx++;\n    return lnA_OK;\n" );
+        break;
+        case lnA_LONG:
+            genLong( gen, node );
+            if( lnA_findOptionLong( gen->par, &gen->usg->usage[node->uIdx], node->nLen ) )
+                fprintf( gen->out, "    st->aIdx++;\n    return lnA_OK;\n" );
+        break;
+        case lnA_OPTIONAL:
+        case lnA_REQUIRED:
+            genGroup( gen, node );
+        break;
+        case lnA_ALT:
+            genSeq( gen, node );
+        break;
+    }
+    fprintf( gen->out, "}\n\n" );
+}
+
+static void
+genSource( lnA_Gen* gen, char* spec, char* header ) {
+    FILE*       out = gen->out;
+    lnA_Parser* par = gen->par;
+    
+    fprintf( out, "// Generated by lnA-gen from %s, don't edit\n", spec );
+    fprintf( out, "#include \"%s\"\n", header );
+    genText( gen, lnA_genHead );
+    
+    // Callbacks named in the spec
+    for( unsigned i = 0 ; i < gen->iCount ; i++ ) {
+        lnA_GenItem* it = &gen->items[i];
+        if( !it->cb )
+            continue;
+        bool dup = false;
+        for( unsigned j = 0 ; j < i ; j++ )
+            dup |= gen->items[j].cb && !strcmp( gen->items[j].cb, it->cb );
+        if( dup )
+            continue;
+        
+        bool slice = false;
+        for( lnA_Param* prm = par->pList ; prm ; prm = prm->next )
+            slice |= prm == it->item && prm->slice;
+        if( slice )
+            fprintf( out, "void\n%s( char** args, size_t n, void* udata );\n\n", it->cb );
+        else
+            fprintf( out, "void\n%s( char* str, void* udata );\n\n", it->cb );
+    }
+    
+    for( unsigned u = 0 ; u < par->uCount ; u++ ) {
+        gen->usg = par->uVec[u];
+        for( unsigned n = 0 ; n < gen->usg->nCount ; n++ ) {
+            lnA_Node* node = &gen->usg->nodes[n];
+            if( !genNeeds( node ) )
+                continue;
+            fprintf( out, "static int\n" );
+            genName( gen, node->kind == lnA_ALT ? 's' : 'n', n );
+            fprintf( out, "( %s_State* st );\n\n", gen->pre );
+        }
+    }
+    
+    for( unsigned u = 0 ; u < par->uCount ; u++ ) {
+        gen->usg = par->uVec[u];
+        for( unsigned n = 0 ; n < gen->usg->nCount ; n++ )
+            genNode( gen, n );
+    }
+    
+    fprintf( out, "char* const %s_usages[%s_USAGE_COUNT] = {\n", gen->pre, gen->pre );
+    for( unsigned u = 0 ; u < par->uCount ; u++ ) {
+        fprintf( out, "    " );
+        genLiteral( out, par->uVec[u]->usage, strlen( par->uVec[u]->usage ) );
+        fprintf( out, ",\n" );
+    }
+    fprintf( out, "};\n\n" );
+    
+    fprintf( out, "static int\n(*const %s_roots[%s_USAGE_COUNT])( %s_State* st ) = {\n", gen->pre, gen->pre, gen->pre );
+    for( unsigned u = 0 ; u < par->uCount ; u++ )
+        fprintf( out, "    &%s_u%u_s0,\n", gen->pre, u );
+    fprintf( out, "};\n\n" );
+    
+    genText( gen, lnA_genTail );
+}
+
+static char* lnA_genHeader =
+    "// Usage strings, in the order they were added\n"
+    "extern char* const @_usages[@_USAGE_COUNT];\n"
+    "\n"
+    "// Matches the arguments with a usage, like lnA_matchUsage(); on\n"
+    "// success invokes the callbacks and returns lnA_OK, otherwise\n"
+    "// returns the error code and describes it in *err (with no\n"
+    "// usage pointer, the error belongs to 'usage')\n"
+    "int\n"
+    "@_match( unsigned usage, char** argv, void* udata, lnA_Error* err );\n"
+    "\n"
+    "// Tries every usage in order like lnA_tryAll(), the index of the\n"
+    "// one that matched, or that got the farthest, goes in *usage\n"
+    "int\n"
+    "@_matchAll( char** argv, void* udata, lnA_Error* err, unsigned* usage );\n"
+    "\n"
+    "// Formats the message for an error like lnA_errorText(), but\n"
+    "// into the given buffer; returns the length like snprintf()\n"
+    "int\n"
+    "@_errorText( unsigned usage, const lnA_Error* err, char* buf, size_t size );\n"
+    "\n";
+
+static void
+genHeader( lnA_Gen* gen, char* spec ) {
+    FILE* out = gen->out;
+    fprintf( out, "// Generated by lnA-gen from %s, don't edit\n", spec );
+    fprintf( out, "#ifndef %s_h\n#define %s_h\n\n", gen->pre, gen->pre );
+    fprintf( out, "#include \"line-arg.h\"\n\n" );
+    
+    fprintf( out, "#define %s_USAGE_COUNT (%u)\n\n", gen->pre, gen->par->uCount );
+    genText( gen, lnA_genHeader );
+    fprintf( out, "#endif\n" );
+}
+
+static FILE*
+genOpen( char* name, char* ext ) {
+    size_t len  = strlen( name ) + strlen( ext ) + 1;
+    char*  path = malloc( len );
+    snprintf( path, len, "%s%s", name, ext );
+    FILE*  file = fopen( path, "w" );
+    if( !file ) {
+        fprintf( stderr, "Can't write %s: %s\n", path, strerror( errno ) );
+        exit( 1 );
+    }
+    free( path );
+    return file;
+}
+
+int
+main( int argc, char** argv ) {
+    if( argc != 3 ) {
+        fprintf( stderr, "Usage: lnA-gen SPEC NAME\n" );
+        return 1;
+    }
+    char* spec = argv[1];
+    char* name = argv[2];
+    
+    lnA_GenLexer lex = { .path = spec, .line = 1 };
+    lex.text = genRead( spec );
+    if( !lex.text ) {
+        fprintf( stderr, "Can't read %s: %s\n", spec, strerror( errno ) );
+        return 1;
+    }
+    lex.pos = lex.text;
+    
+    lnA_Gen gen = { .par = lnA_makeParser( "lnA-gen", NULL ) };
+    genSpec( &gen, &lex );
+    
+    // Symbols are prefixed by the base name, as an identifier
+    char* base = strrchr( name, '/' );
+    base = base ? base + 1 : name;
+    gen.pre = strdup( base );
+    for( char* c = gen.pre ; *c ; c++ ) {
+        if( !isalnum( (unsigned char)*c ) )
+            *c = '_';
+    }
+    if( isdigit( (unsigned char)gen.pre[0] ) )
+        gen.pre[0] = '_';
+    
+    size_t hLen   = strlen( base ) + 3;
+    char*  header = malloc( hLen );
+    snprintf( header, hLen, "%s.h", base );
+    
+    gen.out = genOpen( name, ".h" );
+    genHeader( &gen, spec );
+    fclose( gen.out );
+    
+    gen.out = genOpen( name, ".c" );
+    genSource( &gen, spec, header );
+    fclose( gen.out );
+    
+    lnA_freeParser( gen.par );
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "line-arg.h"
+#include "test.h"
+
+// lnA_tryAll() tries every usage, the first that matches wins
+// and only its callbacks are invoked
+
+static char got[256];
+
+static void
+optCb( char* opt, void* udata ) {
+    strcat( got, opt );
+    strcat( got, " " );
+}
+
+static void
+prmCb( char* arg, void* udata ) {
+    strcat( got, arg );
+    strcat( got, " " );
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "v", NULL, "", &optCb );
+    lnA_addOption( par, "h", "help", "", &optCb );
+    lnA_addParam( par, "SRC", &prmCb );
+    lnA_addParam( par, "DST", &prmCb );
+    
+    char* none[] = { NULL };
+    checkStr( lnA_tryAll( par, none, NULL ), "No usages" );
+    check( lnA_getError( par )->code == lnA_E_NO_USAGES );
+    
+    lnA_Usage* help = lnA_addUsage( par, "{-h | --help}" );
+    lnA_Usage* copy = lnA_addUsage( par, "[-v] SRC DST" );
+    lnA_Usage* list = lnA_addUsage( par, "[-v] SRC..." );
+    
+    lnA_Usage* won;
+    char* two[] = { "-v", "a", "b", NULL };
+    checkStr( lnA_tryAll( par, two, &won ), NULL );
+    check( won == copy );
+    checkStr( got, "v a b " );
+    
+    // Earlier usages that failed keep their errors
+    check( lnA_matchError( par, help ) != NULL );
+    checkStr( lnA_matchError( par, copy ), NULL );
+    checkStr( lnA_matchError( par, list ), NULL );
+    
+    got[0] = '\0';
+    char* three[] = { "a", "b", "c", NULL };
+    checkStr( lnA_tryAll( par, three, &won ), NULL );
+    check( won == list );
+    checkStr( got, "a b c " );
+    
+    // The error is from the usage that got the farthest
+    got[0] = '\0';
+    char* bad[] = { "-v", "a", "-x", NULL };
+    check( lnA_tryAll( par, bad, &won ) != NULL );
+    check( won == NULL );
+    checkStr( got, "" );
+    const lnA_Error* err = lnA_getError( par );
+    check( err->aIdx == 2 );
+    check( err->usg == copy );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
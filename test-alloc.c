@@ -0,0 +1,84 @@
+#include "line-arg.h"
+#include "test.h"
+#include <stdlib.h>
+
+// Everything the parser allocates goes through its allocator,
+// and per-parse data can live in a scratch arena
+
+typedef struct Counts {
+    size_t   live;   // Bytes allocated and not freed
+    unsigned calls;  // Calls to any hook
+} Counts;
+
+static void*
+countAlloc( size_t size, void* ctx ) {
+    Counts* cnt = ctx;
+    cnt->live += size;
+    cnt->calls++;
+    return malloc( size );
+}
+
+static void*
+countResize( void* ptr, size_t old, size_t size, void* ctx ) {
+    Counts* cnt = ctx;
+    cnt->live += size - old;
+    cnt->calls++;
+    return realloc( ptr, size );
+}
+
+static void
+countFree( void* ptr, size_t size, void* ctx ) {
+    Counts* cnt = ctx;
+    cnt->live -= size;
+    cnt->calls++;
+    free( ptr );
+}
+
+static void
+prmCb( char* arg, void* udata ) {
+}
+
+int
+main( void ) {
+    Counts        cnt = { 0 };
+    lnA_Allocator mem = { &countAlloc, &countResize, &countFree, &cnt };
+    
+    lnA_Parser* par = lnA_makeParserEx( "prog", NULL, &mem );
+    lnA_addOption( par, "v", "verbose", "Say more", NULL );
+    lnA_addParam( par, "FILE", &prmCb );
+    lnA_Usage* usg = lnA_addUsage( par, "[-v | --verbose]... FILE..." );
+    lnA_addUsage( par, "[-v" );
+    check( cnt.calls > 0 );
+    
+    static char arena[16*1024];
+    lnA_setScratch( par, arena, sizeof(arena) );
+    
+    char* argv[] = { "-v", "--verbose", "a", "b", "c", NULL };
+    checkStr( lnA_tryUsage( par, usg, argv ), NULL );
+    checkStr( lnA_tryAll( par, argv, NULL ), NULL );
+    char* bad[] = { "--verbose=x", NULL };
+    check( lnA_tryUsage( par, usg, bad ) != NULL );
+    check( lnA_errorText( par ) != NULL );
+    
+    // Once everything's been made, parses only use the arena
+    unsigned calls = cnt.calls;
+    for( unsigned i = 0 ; i < 10 ; i++ ) {
+        checkStr( lnA_tryUsage( par, usg, argv ), NULL );
+        checkStr( lnA_tryAll( par, argv, NULL ), NULL );
+    }
+    check( cnt.calls == calls );
+    
+    lnA_freeParser( par );
+    check( cnt.live == 0 );
+    
+    // Without a free hook nothing is freed one by one
+    mem.free = NULL;
+    cnt = (Counts){ 0 };
+    par = lnA_makeParserEx( "prog", NULL, &mem );
+    lnA_addUsage( par, "[-v] FILE" );
+    calls = cnt.calls;
+    lnA_freeParser( par );
+    check( cnt.calls == calls );
+    
+    return testResult();
+}
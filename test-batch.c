@@ -0,0 +1,69 @@
+#include "line-arg.h"
+#include "test.h"
+
+// Batches are matched on several threads, each vector on
+// its own as if by lnA_tryAll()
+
+#define VECTORS (200)
+
+static unsigned files;
+
+static void
+prmCb( char* arg, void* udata ) {
+    files++;
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "v", NULL, "", NULL );
+    lnA_addOption( par, "h", "help", "", NULL );
+    lnA_addParam( par, "F", &prmCb );
+    lnA_Usage* help = lnA_addUsage( par, "{-h | --help}" );
+    lnA_Usage* list = lnA_addUsage( par, "[-v] F..." );
+    
+    static char* good[] = { "-v", "a", "b", NULL };
+    static char* alt[]  = { "--help", NULL };
+    static char* bad[]  = { "-v", "-x", NULL };
+    char**     argvs[VECTORS];
+    lnA_Result res[VECTORS];
+    for( unsigned i = 0 ; i < VECTORS ; i++ )
+        argvs[i] = i % 10 == 3 ? bad : i % 10 == 7 ? alt : good;
+    
+    for( unsigned workers = 1 ; workers <= 4 ; workers++ ) {
+        memset( res, 0, sizeof(res) );
+        check( lnA_tryBatch( par, argvs, VECTORS, workers, res ) == VECTORS - VECTORS/10 );
+        for( unsigned i = 0 ; i < VECTORS ; i++ ) {
+            if( argvs[i] == bad ) {
+                check( res[i].usg == NULL );
+                check( res[i].err.code == lnA_E_MISSING_PARAM );
+                checkStr( lnA_resultText( par, &res[i] ), "Missing F parameter" );
+            }
+            else {
+                check( res[i].usg == (argvs[i] == alt ? help : list) );
+                checkStr( lnA_resultText( par, &res[i] ), NULL );
+            }
+        }
+    }
+    
+    // No callbacks until the batch is replayed
+    check( files == 0 );
+    lnA_replayBatch( par, argvs, VECTORS, res );
+    check( files == 2*(VECTORS - 2*VECTORS/10) );
+    
+    // Each vector gets the whole step budget
+    lnA_setLimits( par, 50, 0 );
+    char* one[] = { "-v", "a", "b", "c", NULL };
+    check( lnA_matchUsage( par, list, one ) == lnA_OK );
+    for( unsigned i = 0 ; i < VECTORS ; i++ )
+        argvs[i] = one;
+    check( lnA_tryBatch( par, argvs, VECTORS, 2, res ) == VECTORS );
+    
+    // But no more than that
+    lnA_setLimits( par, 3, 0 );
+    check( lnA_tryBatch( par, argvs, VECTORS, 2, res ) == 0 );
+    check( res[VECTORS - 1].err.code == lnA_E_STEP_LIMIT );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
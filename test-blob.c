@@ -0,0 +1,144 @@
+#include "line-arg.h"
+#include "test.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+// Parsers saved as blobs load and match like the parser
+// they were saved from; damaged blobs are rejected
+
+static char got[256];
+
+static void
+optCb( char* str, void* udata ) {
+    strcat( got, "-" );
+    strcat( got, str );
+    strcat( got, " " );
+}
+
+static void
+prmCb( char* str, void* udata ) {
+    strcat( got, str );
+    strcat( got, " " );
+}
+
+static void
+setup( lnA_Parser* par ) {
+    lnA_addOption( par, "v", "verbose", "Says more", &optCb );
+    lnA_addOption( par, NULL, "out", "Where it goes", &optCb );
+    lnA_addParam( par, "O", &prmCb );
+    lnA_addParam( par, "FILES", &prmCb );
+    lnA_addUsage( par, "{-v | --verbose}... [--out=O] FILES..." );
+    lnA_addUsage( par, "--out=O" );
+    lnA_addUsage( par, "[-v] -v O" );
+}
+
+static char* argvs[][5] = {
+    { "-v", "a", "b" },
+    { "--verbose", "--out=x", "a" },
+    { "--out=y" },
+    { "--out", "a" },
+    { "-x" },
+    { "-v", "-v", "o" },
+    { NULL }
+};
+
+static char*
+run( lnA_Parser* par, char** argv ) {
+    got[0] = '\0';
+    char* err = lnA_tryAll( par, argv, NULL );
+    strcat( got, "/" );
+    strcat( got, err ? err : "ok" );
+    return got;
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    setup( par );
+    
+    size_t    size = lnA_saveParser( par, NULL, 0 );
+    uint64_t* blob = calloc( size/8 + 1, 8 );
+    check( size > 0 );
+    check( lnA_saveParser( par, blob, size - 1 ) == size );
+    check( lnA_saveParser( par, blob, size ) == size );
+    check( lnA_checkParser( blob, size ) == lnA_OK );
+    check( lnA_checkParser( blob, size - 1 ) == lnA_E_BAD_BLOB );
+    
+    // Words are little endian whatever the machine
+    check( !memcmp( blob, "\0lnA", 4 ) );
+    
+    // Blobs don't have to be aligned
+    char* moved = malloc( size + 1 );
+    memcpy( &moved[1], blob, size );
+    lnA_Parser* ld = lnA_loadParser( &moved[1], size, NULL, NULL );
+    check( ld != NULL );
+    lnA_freeParser( ld );
+    free( moved );
+    
+    // Whether each usage is deterministic is worked
+    // out again rather than read from the blob
+    ld = lnA_loadParser( blob, size, NULL, NULL );
+    check( ld != NULL );
+    check( lnA_isDeterministic( lnA_getUsage( ld, 0 ) ) );
+    check( !lnA_isDeterministic( lnA_getUsage( ld, 2 ) ) );
+    for( unsigned i = 0 ; i < 3 ; i++ )
+        check( lnA_isDeterministic( lnA_getUsage( ld, i ) ) == lnA_isDeterministic( lnA_getUsage( par, i ) ) );
+    check( lnA_bindOption( ld, "v", "verbose", &optCb ) == 0 );
+    check( lnA_bindOption( ld, NULL, "out", &optCb ) == 0 );
+    check( lnA_bindParam( ld, "O", &prmCb ) == 0 );
+    check( lnA_bindParam( ld, "FILES", &prmCb ) == 0 );
+    check( lnA_bindParam( ld, "NONE", &prmCb ) == -1 );
+    for( unsigned i = 0 ; i < sizeof(argvs)/sizeof(argvs[0]) ; i++ ) {
+        char want[256];
+        strcpy( want, run( par, argvs[i] ) );
+        checkStr( run( ld, argvs[i] ), want );
+    }
+    lnA_freeParser( ld );
+    
+    // Any damage is caught, or leaves a blob that's still
+    // safe to match with
+    uint8_t* bytes = (uint8_t*)blob;
+    for( size_t i = 0 ; i < size ; i++ ) {
+        for( unsigned bit = 0 ; bit < 8 ; bit++ ) {
+            bytes[i] ^= 1 << bit;
+            ld = lnA_loadParser( blob, size, NULL, NULL );
+            check( (ld != NULL) == (lnA_checkParser( blob, size ) == lnA_OK) );
+            if( ld ) {
+                for( unsigned a = 0 ; a < sizeof(argvs)/sizeof(argvs[0]) ; a++ )
+                    lnA_tryAll( ld, argvs[a], NULL );
+                lnA_freeParser( ld );
+            }
+            bytes[i] ^= 1 << bit;
+        }
+    }
+    check( lnA_checkParser( blob, size ) == lnA_OK );
+    free( blob );
+    lnA_freeParser( par );
+    
+    // Usages nesting deeper than a blob allows aren't saved
+    char usage[4*lnA_MAX_BLOB_NEST + 16];
+    for( unsigned depth = lnA_MAX_BLOB_NEST ; depth <= lnA_MAX_BLOB_NEST + 1 ; depth++ ) {
+        par = lnA_makeParser( "prog", NULL );
+        lnA_addOption( par, "v", NULL, "", NULL );
+        memset( usage, '{', depth );
+        strcpy( &usage[depth], "-v" );
+        memset( &usage[depth + 2], '}', depth );
+        usage[2*depth + 2] = '\0';
+        check( lnA_addUsage( par, usage ) != NULL );
+        check( (lnA_tryAll( par, (char*[]){ "-v", NULL }, NULL ) == NULL) == (depth <= lnA_MAX_NEST) );
+        
+        size = lnA_saveParser( par, NULL, 0 );
+        check( (size != 0) == (depth <= lnA_MAX_BLOB_NEST) );
+        if( size ) {
+            blob = calloc( size/8 + 1, 8 );
+            lnA_saveParser( par, blob, size );
+            ld = lnA_loadParser( blob, size, NULL, NULL );
+            check( ld && lnA_tryAll( ld, (char*[]){ "-v", NULL }, NULL ) == NULL );
+            lnA_freeParser( ld );
+            free( blob );
+        }
+        lnA_freeParser( par );
+    }
+    
+    return testResult();
+}
@@ -0,0 +1,132 @@
+#include "line-arg.h"
+#include "test.h"
+#include <stdlib.h>
+
+// Subcommands have their own parsers, made the first time
+// they're needed and freed along with the parent
+
+static char     got[256];
+static unsigned made;
+static size_t   live;
+
+static void*
+countAlloc( size_t size, void* ctx ) {
+    live += size;
+    return malloc( size );
+}
+
+static void
+countFree( void* ptr, size_t size, void* ctx ) {
+    live -= size;
+    free( ptr );
+}
+
+static void
+optCb( char* str, void* udata ) {
+    strcat( got, "-" );
+    strcat( got, str );
+    strcat( got, " " );
+}
+
+static void
+prmCb( char* str, void* udata ) {
+    strcat( got, str );
+    strcat( got, " " );
+}
+
+static lnA_Parser* commit;
+
+static lnA_Parser*
+makeCmd( char* name, void* udata ) {
+    made++;
+    if( !strcmp( name, "broken" ) )
+        return NULL;
+    
+    // An alias shares the parser of the command it stands for
+    if( !strcmp( name, "ci" ) )
+        return commit;
+    
+    static lnA_Allocator mem = { &countAlloc, NULL, &countFree, NULL };
+    lnA_Parser* par = lnA_makeParserEx( name, udata, &mem );
+    lnA_addOption( par, "m", NULL, "", &optCb );
+    lnA_addParam( par, "MSG", &prmCb );
+    lnA_addUsage( par, !strcmp( name, "commit" ) ? "-m MSG" : "[-m]" );
+    if( !strcmp( name, "commit" ) )
+        commit = par;
+    return par;
+}
+
+// The parent's memory is never freed, only its commands'
+static char   arena[64*1024];
+static size_t aUsed;
+
+static void*
+arenaAlloc( size_t size, void* ctx ) {
+    size = (size + 15) & ~(size_t)15;
+    if( aUsed + size > sizeof(arena) )
+        return NULL;
+    aUsed += size;
+    return &arena[aUsed - size];
+}
+
+int
+main( void ) {
+    lnA_Allocator mem = { &arenaAlloc, NULL, NULL, NULL };
+    lnA_Parser*   par = lnA_makeParserEx( "git", NULL, &mem );
+    check( lnA_addCommand( par, "commit", "Records changes", &makeCmd ) == 0 );
+    check( lnA_addCommand( par, "status", "Shows changes", &makeCmd ) == 1 );
+    check( lnA_addCommand( par, "broken", "Can't be made", &makeCmd ) == 2 );
+    check( lnA_addCommand( par, "ci", "Same as commit", &makeCmd ) == 3 );
+    check( made == 0 );
+    
+    lnA_Parser* cmd;
+    lnA_Usage*  match;
+    char* argv[] = { "commit", "-m", "msg", NULL };
+    checkStr( lnA_tryCommand( par, argv, &cmd, &match ), NULL );
+    checkStr( got, "-m msg " );
+    check( made == 1 );
+    check( cmd == lnA_getCommand( par, "commit" ) );
+    check( match == lnA_getUsage( cmd, 0 ) );
+    check( made == 1 );
+    
+    char* missing[] = { "commit", "-m", NULL };
+    checkStr( lnA_tryCommand( par, missing, &cmd, NULL ), "Missing MSG parameter" );
+    check( cmd == lnA_getCommand( par, "commit" ) );
+    check( lnA_getError( cmd )->code == lnA_E_MISSING_PARAM );
+    
+    char* status[] = { "status", NULL };
+    checkStr( lnA_tryCommand( par, status, NULL, NULL ), NULL );
+    check( made == 2 );
+    
+    // With no usages of its own the parent only takes commands
+    char* other[] = { "push", NULL };
+    checkStr( lnA_tryCommand( par, other, &cmd, &match ), "Unknown command 'push'" );
+    check( cmd == par && match == NULL );
+    check( lnA_getError( par )->code == lnA_E_UNKNOWN_COMMAND );
+    check( lnA_getCommand( par, "push" ) == NULL );
+    
+    // A command that can't be made is tried again each time
+    check( lnA_getCommand( par, "broken" ) == NULL );
+    check( lnA_getCommand( par, "broken" ) == NULL );
+    check( made == 4 );
+    
+    // Both names match with the same parser, which is freed once
+    got[0] = '\0';
+    char* alias[] = { "ci", "-m", "again", NULL };
+    checkStr( lnA_tryCommand( par, alias, &cmd, NULL ), NULL );
+    checkStr( got, "-m again " );
+    check( cmd == lnA_getCommand( par, "commit" ) );
+    
+    lnA_addOption( par, NULL, "version", "", &optCb );
+    lnA_addUsage( par, "--version" );
+    got[0] = '\0';
+    char* version[] = { "--version", NULL };
+    checkStr( lnA_tryCommand( par, version, &cmd, NULL ), NULL );
+    checkStr( got, "-version " );
+    check( cmd == par );
+    
+    check( live > 0 );
+    lnA_freeParser( par );
+    check( live == 0 );
+    return testResult();
+}
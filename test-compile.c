@@ -0,0 +1,58 @@
+#include "line-arg.h"
+#include "test.h"
+
+// Usages are compiled when they're added, so malformed ones are
+// reported right away and every parse reuses the same nodes
+
+static char got[256];
+
+static void
+optCb( char* opt, void* udata ) {
+    strcat( got, "-" );
+    strcat( got, opt );
+    strcat( got, " " );
+}
+
+static void
+prmCb( char* arg, void* udata ) {
+    strcat( got, arg );
+    strcat( got, " " );
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "ab", NULL, "", &optCb );
+    lnA_addOption( par, NULL, "out", "", &optCb );
+    lnA_addParam( par, "FILE", &prmCb );
+    lnA_addParam( par, "O", &prmCb );
+    
+    lnA_Usage* bad1 = lnA_addUsage( par, "[-a FILE" );
+    lnA_Usage* bad2 = lnA_addUsage( par, "{-a | FILE" );
+    lnA_Usage* bad3 = lnA_addUsage( par, "-a ] FILE" );
+    lnA_Usage* bad4 = lnA_addUsage( par, "-a ... FILE" );
+    checkStr( lnA_usageError( bad1 ), "Unterminated optional group" );
+    checkStr( lnA_usageError( bad2 ), "Unterminated required group" );
+    checkStr( lnA_usageError( bad3 ), "Stray bracket" );
+    checkStr( lnA_usageError( bad4 ), "Unexpected character '.'" );
+    
+    // Malformed usages still fail with their compile error
+    char* none[] = { NULL };
+    checkStr( lnA_tryUsage( par, bad1, none ), "Unterminated optional group" );
+    
+    lnA_Usage* usg = lnA_addUsage( par, "[-ab | --out=O]... FILE..." );
+    checkStr( lnA_usageError( usg ), NULL );
+    for( int i = 0 ; i < 3 ; i++ ) {
+        char* argv[] = { "-ab", "--out=x", "f1", "f2", NULL };
+        got[0] = '\0';
+        checkStr( lnA_tryUsage( par, usg, argv ), NULL );
+        checkStr( got, "-ab -ab -out x f1 f2 " );
+    }
+    
+    char* argv[] = { "--out=x", NULL };
+    check( lnA_tryUsage( par, usg, argv ) != NULL );
+    check( lnA_getError( par )->code == lnA_E_MISSING_PARAM );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
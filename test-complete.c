@@ -0,0 +1,109 @@
+#include "line-arg.h"
+#include "test.h"
+#include <stdlib.h>
+
+// Completers list the words that can follow some arguments,
+// picking up where the last call left off
+
+static int
+cmpStr( const void* a, const void* b ) {
+    return strcmp( a, b );
+}
+
+// Lists the words, sorted since their order isn't given,
+// with a '$' if the arguments can end
+static char*
+list( const lnA_Completion* next ) {
+    static char names[32][32];
+    static char text[512];
+    unsigned n = next->count < 32 ? next->count : 32;
+    for( unsigned i = 0 ; i < n ; i++ ) {
+        lnA_Word* w = &next->words[i];
+        switch( w->kind ) {
+            case lnA_W_SHORT:
+                snprintf( names[i], 32, "-%.*s", w->nLen, w->name );
+            break;
+            case lnA_W_LONG:
+                if( w->value )
+                    snprintf( names[i], 32, "--%.*s=%.*s", w->nLen, w->name, w->vLen, w->value );
+                else
+                    snprintf( names[i], 32, "--%.*s", w->nLen, w->name );
+            break;
+            default:
+                snprintf( names[i], 32, "%.*s", w->nLen, w->name );
+            break;
+        }
+    }
+    qsort( names, n, 32, &cmpStr );
+    
+    text[0] = '\0';
+    for( unsigned i = 0 ; i < n ; i++ ) {
+        strcat( text, names[i] );
+        strcat( text, " " );
+    }
+    if( next->end )
+        strcat( text, "$" );
+    return text;
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "v", NULL, "", NULL );
+    lnA_addOption( par, "h", "help", "", NULL );
+    lnA_addOption( par, NULL, "out", "", NULL );
+    lnA_addParam( par, "O", NULL );
+    lnA_addParam( par, "SRC", NULL );
+    lnA_addParam( par, "DST", NULL );
+    lnA_addUsage( par, "{-h | --help}" );
+    lnA_addUsage( par, "[-v]... [--out=O] SRC... DST" );
+    
+    lnA_Completer* cmp = lnA_makeCompleter( par );
+    char* argv[8] = { NULL };
+    checkStr( list( lnA_complete( cmp, argv ) ), "--help --out=O -h -v SRC " );
+    
+    argv[0] = "-v";
+    checkStr( list( lnA_complete( cmp, argv ) ), "--out=O -v SRC " );
+    
+    argv[1] = "--out=x";
+    checkStr( list( lnA_complete( cmp, argv ) ), "SRC " );
+    
+    // Parameters can stand for more of themselves or what
+    // follows, since any argument fits them
+    argv[2] = "a";
+    checkStr( list( lnA_complete( cmp, argv ) ), "DST SRC " );
+    argv[3] = "b";
+    checkStr( list( lnA_complete( cmp, argv ) ), "DST SRC $" );
+    
+    // Going back picks up from an earlier word
+    argv[3] = NULL;
+    checkStr( list( lnA_complete( cmp, argv ) ), "DST SRC " );
+    argv[1] = NULL;
+    checkStr( list( lnA_complete( cmp, argv ) ), "--out=O -v SRC " );
+    
+    argv[0] = "--help";
+    checkStr( list( lnA_complete( cmp, argv ) ), "$" );
+    argv[1] = "-v";
+    check( lnA_complete( cmp, argv )->count == 0 );
+    check( !lnA_complete( cmp, argv )->end );
+    
+    // Adding a usage starts over
+    lnA_addUsage( par, "--help -v" );
+    argv[1] = NULL;
+    checkStr( list( lnA_complete( cmp, argv ) ), "-v $" );
+    
+    // Each word gets the whole step budget
+    lnA_setLimits( par, 50, 0 );
+    char* many[41] = { NULL };
+    for( unsigned i = 0 ; i < 40 ; i++ ) {
+        many[i] = "a";
+        checkStr( list( lnA_complete( cmp, many ) ), i ? "DST SRC $" : "DST SRC " );
+    }
+    lnA_freeCompleter( cmp );
+    cmp = lnA_makeCompleter( par );
+    checkStr( list( lnA_complete( cmp, many ) ), "DST SRC $" );
+    
+    lnA_freeCompleter( cmp );
+    lnA_freeParser( par );
+    return testResult();
+}
@@ -0,0 +1,62 @@
+#include "line-arg.h"
+#include "test.h"
+
+// Usages are classed by how their matching time can grow
+// with the number of arguments, and never grow faster
+
+// Steps taken to match 'n' "-a" arguments and maybe a parameter
+static unsigned long
+steps( lnA_Parser* par, lnA_Usage* usg, unsigned n, char* last ) {
+    static char* argv[130];
+    for( unsigned i = 0 ; i < n ; i++ )
+        argv[i] = "-a";
+    argv[n]     = last;
+    argv[n + 1] = NULL;
+    lnA_matchUsage( par, usg, argv );
+    return lnA_stepsUsed( par );
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "a", NULL, "", NULL );
+    lnA_addOption( par, "b", NULL, "", NULL );
+    lnA_addOption( par, "c", NULL, "", NULL );
+    lnA_addParam( par, "F", NULL );
+    
+    static const struct {
+        char*    usage;
+        int      cls;
+        unsigned degree;
+        char*    part;
+    } want[] = {
+        { "[-a]... F",                           lnA_C_LINEAR,      1, "" },
+        { "{-a -b | -a}... F",                   lnA_C_LINEAR,      1, "" },
+        { "{F -a | F}...",                       lnA_C_LINEAR,      1, "" },
+        { "{[-a]... -b | -a}...",                lnA_C_POLYNOMIAL,  2, "{[-a]... -b | -a}..." },
+        { "-c {{-a -b | -a}... -c | -a}...",     lnA_C_POLYNOMIAL,  2, "{{-a -b | -a}... -c | -a}..." },
+        { "{{-a -c | -a} -c | {-a -c | -a}} -b", lnA_C_EXPONENTIAL, 1, "{{-a -c | -a} -c | {-a -c | -a}}" },
+        { "{-a",                                 lnA_C_LINEAR,      1, "" }
+    };
+    for( unsigned i = 0 ; i < sizeof(want)/sizeof(want[0]) ; i++ ) {
+        lnA_Usage*            usg = lnA_addUsage( par, want[i].usage );
+        const lnA_Complexity* cx  = lnA_usageComplexity( usg );
+        check( cx->cls == want[i].cls );
+        check( cx->degree == want[i].degree );
+        check( cx->uLen == strlen( want[i].part ) );
+        check( !strncmp( &want[i].usage[cx->uIdx], want[i].part, cx->uLen ) );
+    }
+    
+    // Doubling the arguments at most doubles the steps of
+    // a linear usage, and quadruples those of a quadratic one
+    lnA_Usage* lin  = lnA_getUsage( par, 1 );
+    lnA_Usage* quad = lnA_getUsage( par, 3 );
+    for( unsigned n = 8 ; n <= 64 ; n *= 2 ) {
+        check( steps( par, lin, 2*n, "x" ) <= 2*steps( par, lin, n, "x" ) + 2 );
+        check( steps( par, quad, 2*n, NULL ) <= 4*steps( par, quad, n, NULL ) );
+    }
+    check( steps( par, quad, 64, NULL ) > 2*steps( par, quad, 32, NULL ) );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
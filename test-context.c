@@ -0,0 +1,75 @@
+#include "line-arg.h"
+#include "test.h"
+#include <pthread.h>
+
+// Each thread matches with its own context, callbacks get
+// the context's udata
+
+#define THREADS (8)
+
+typedef struct Count {
+    unsigned opts;
+    unsigned args;
+} Count;
+
+static lnA_Parser* par;
+static lnA_Usage*  usg;
+
+static void
+optCb( char* opt, void* udata ) {
+    ((Count*)udata)->opts++;
+}
+
+static void
+prmCb( char* arg, void* udata ) {
+    ((Count*)udata)->args++;
+}
+
+static void*
+run( void* arg ) {
+    Count*       cnt = arg;
+    lnA_Context* ctx = lnA_makeContext( par, cnt );
+    char* good[] = { "-v", "a", "-v", "b", "c", NULL };
+    char* bad[]  = { "-v", "-x", NULL };
+    for( unsigned i = 0 ; i < 1000 ; i++ ) {
+        if( lnA_tryUsageCtx( ctx, usg, good ) || !lnA_tryAllCtx( ctx, bad, NULL ) )
+            cnt->opts = cnt->args = 0;
+    }
+    lnA_freeContext( ctx );
+    return NULL;
+}
+
+int
+main( void ) {
+    par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "v", NULL, "", &optCb );
+    lnA_addParam( par, "F", &prmCb );
+    usg = lnA_addUsage( par, "{-v | F}..." );
+    
+    pthread_t tids[THREADS];
+    Count     counts[THREADS] = { { 0 } };
+    for( unsigned i = 0 ; i < THREADS ; i++ )
+        check( !pthread_create( &tids[i], NULL, &run, &counts[i] ) );
+    for( unsigned i = 0 ; i < THREADS ; i++ ) {
+        pthread_join( tids[i], NULL );
+        check( counts[i].opts == 2000 && counts[i].args == 3000 );
+    }
+    
+    // Contexts keep their own errors
+    Count        cnt = { 0 };
+    lnA_Context* c1  = lnA_makeContext( par, &cnt );
+    lnA_Context* c2  = lnA_makeContext( par, &cnt );
+    char* bad[]  = { "-x", NULL };
+    char* good[] = { "a", NULL };
+    check( lnA_matchUsageCtx( c1, usg, bad ) == lnA_E_MISSING_GROUP );
+    check( lnA_matchUsageCtx( c2, usg, good ) == lnA_OK );
+    check( lnA_getErrorCtx( c1 )->code == lnA_E_MISSING_GROUP );
+    checkStr( lnA_errorTextCtx( c1 ), "Missing group {-v | F}" );
+    checkStr( lnA_errorTextCtx( c2 ), NULL );
+    check( cnt.args == 1 );
+    lnA_freeContext( c1 );
+    lnA_freeContext( c2 );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
@@ -0,0 +1,85 @@
+#include "line-arg.hpp"
+#include "test.h"
+
+// Usages compiled by the C++ front end match like lnA,
+// handing every name to one handler by its id
+
+static constexpr auto usg = lnA_USAGE( "[-v | --width=W]... FILES..." );
+static constexpr auto alt = lnA_USAGE( "{-h | --help | -ab FILE [--out=O]}" );
+
+static_assert( usg.has( lnA::id( "W" ) ) );
+static_assert( usg.has( lnA::id( "FILES" ) ) );
+static_assert( !usg.has( lnA::id( "h" ) ) );
+static_assert( alt.has( lnA::id( "out" ) ) );
+
+static char got[256];
+
+static void
+add( std::uint32_t id, char* arg ) {
+    switch( id ) {
+        case lnA::id( "v" ):     strcat( got, "v" );     break;
+        case lnA::id( "a" ):     strcat( got, "a" );     break;
+        case lnA::id( "b" ):     strcat( got, "b" );     break;
+        case lnA::id( "h" ):     strcat( got, "h" );     break;
+        case lnA::id( "help" ):  strcat( got, "help" );  break;
+        case lnA::id( "width" ): strcat( got, "width" ); break;
+        case lnA::id( "out" ):   strcat( got, "out" );   break;
+        case lnA::id( "W" ):     strcat( got, "W=" );    break;
+        case lnA::id( "O" ):     strcat( got, "O=" );    break;
+        case lnA::id( "FILE" ):  strcat( got, "FILE=" ); break;
+        case lnA::id( "FILES" ): strcat( got, "F=" );    break;
+    }
+    if( got[strlen( got ) - 1] == '=' )
+        strcat( got, arg );
+    strcat( got, " " );
+}
+
+template<const auto& G>
+static int
+run( char** argv, lnA_Error* err ) {
+    got[0] = '\0';
+    return lnA::match<G>( argv, &add, err );
+}
+
+int
+main( void ) {
+    lnA_Error err;
+    char      msg[128];
+    
+    char* a1[] = { (char*)"-v", (char*)"--width=3", (char*)"a", (char*)"b", nullptr };
+    check( run<usg>( a1, &err ) == lnA_OK );
+    checkStr( got, "v width W=3 F=a F=b " );
+    check( err.code == lnA_OK );
+    check( lnA::errorText<usg>( err, msg, sizeof(msg) ) == 0 );
+    checkStr( msg, "" );
+    
+    // Nothing is handled unless the whole usage matches
+    char* a2[] = { (char*)"-v", nullptr };
+    check( run<usg>( a2, &err ) == lnA_E_MISSING_PARAM );
+    checkStr( got, "" );
+    check( err.aIdx == 1 );
+    lnA::errorText<usg>( err, msg, sizeof(msg) );
+    checkStr( msg, "Missing FILES parameter" );
+    check( run<usg>( a2, nullptr ) == lnA_E_MISSING_PARAM );
+    
+    char* b1[] = { (char*)"-ba", (char*)"x", (char*)"--out=y", nullptr };
+    check( run<alt>( b1, &err ) == lnA_OK );
+    checkStr( got, "b a FILE=x out O=y " );
+    
+    char* b2[] = { (char*)"--help", (char*)"x", nullptr };
+    check( run<alt>( b2, &err ) == lnA_E_EXTRA_WORD );
+    lnA::errorText<alt>( err, msg, sizeof(msg) );
+    checkStr( msg, "Extra or unmatched word 'x'" );
+    
+    char* b3[] = { (char*)"-ac", nullptr };
+    check( run<alt>( b3, &err ) != lnA_OK );
+    lnA::errorText<alt>( err, msg, sizeof(msg) );
+    checkStr( msg, "Missing group {-h | --help | -ab FILE [--out=O]}" );
+    
+    // Messages are cut to the buffer like snprintf()
+    int len = lnA::errorText<alt>( err, msg, 8 );
+    check( len == (int)strlen( "Missing group {-h | --help | -ab FILE [--out=O]}" ) );
+    checkStr( msg, "Missing" );
+    
+    return testResult();
+}
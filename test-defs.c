@@ -0,0 +1,115 @@
+#include "line-arg.h"
+#include "test.h"
+#include <stdlib.h>
+
+// Parsers made from descriptor tables match like ones built
+// call by call, and a buffer allocator can hold all of one
+
+static char got[256];
+
+static void
+optCb( char* str, void* udata ) {
+    strcat( got, "-" );
+    strcat( got, str );
+    strcat( got, " " );
+}
+
+static void
+prmCb( char* str, void* udata ) {
+    strcat( got, str );
+    strcat( got, " " );
+}
+
+static char* const usages[] = {
+    "{-h | --help}",
+    "[-v | --level=L]... FILES...",
+    NULL
+};
+
+static int64_t level;
+
+static const lnA_OptionDef options[] = {
+    { "h", "help",  "Shows this",  &optCb },
+    { "v", NULL,    "Says more",   &optCb },
+    { NULL, "level", "Sets level", &optCb },
+    { NULL }
+};
+
+static const lnA_ParamDef params[] = {
+    { "L", .val = { .kind = lnA_V_RANGE, .dest = &level, .lo = 0, .hi = 3 } },
+    { "FILES", &prmCb },
+    { NULL }
+};
+
+static const lnA_ParserDef def = {
+    .name    = "prog",
+    .header  = "Does things",
+    .usages  = usages,
+    .options = options,
+    .params  = params
+};
+
+static char* argv[] = { "-v", "--level=2", "a", "b", NULL };
+
+// Makes a parser in the buffer and matches with it, returning
+// how big the buffer would have had to be
+static size_t
+run( void* buf, size_t size ) {
+    lnA_Allocator mem;
+    lnA_bufferAllocator( &mem, buf, size );
+    lnA_Parser* par = lnA_makeParserDef( &def, NULL, &mem );
+    got[0] = '\0';
+    checkStr( lnA_tryAll( par, argv, NULL ), NULL );
+    checkStr( got, "-v -level a b " );
+    check( level == 2 );
+    
+    char* bad[] = { "--level=4", "a", NULL };
+    checkStr( lnA_tryUsage( par, lnA_getUsage( par, 1 ), bad ), "Missing FILES parameter" );
+    
+    size_t need = lnA_bufferNeeded( &mem );
+    lnA_freeParser( par );
+    return need;
+}
+
+int
+main( void ) {
+    // Same as adding each item in order
+    lnA_Parser* one = lnA_makeParser( "prog", NULL );
+    lnA_setHeader( one, "Does things" );
+    lnA_addOption( one, "h", "help", "Shows this", &optCb );
+    lnA_addOption( one, "v", NULL, "Says more", &optCb );
+    lnA_addOption( one, NULL, "level", "Sets level", &optCb );
+    lnA_addParamValue( one, "L", (lnA_Value*)&params[0].val );
+    lnA_addParam( one, "FILES", &prmCb );
+    lnA_addUsage( one, usages[0] );
+    lnA_addUsage( one, usages[1] );
+    
+    lnA_Parser* par = lnA_makeParserDef( &def, NULL, NULL );
+    check( lnA_optionId( par, NULL, "level" ) == lnA_optionId( one, NULL, "level" ) );
+    check( lnA_paramId( par, "FILES" ) == lnA_paramId( one, "FILES" ) );
+    check( lnA_getUsage( par, 1 ) != NULL && lnA_getUsage( par, 2 ) == NULL );
+    
+    char want[1024];
+    char help[1024];
+    lnA_copyHelp( one, want, sizeof(want), 80 );
+    lnA_copyHelp( par, help, sizeof(help), 80 );
+    checkStr( help, want );
+    lnA_freeParser( one );
+    lnA_freeParser( par );
+    
+    // A buffer of the size it asks for is enough, however
+    // much of the first parser had to come from malloc()
+    static char small[512];
+    size_t need = run( small, sizeof(small) );
+    check( need > sizeof(small) );
+    
+    char*  buf  = malloc( need );
+    size_t full = run( buf, need );
+    check( full <= need );
+    check( run( buf, full ) == full );
+    check( run( buf + 1, full ) == full );
+    free( buf );
+    
+    check( run( NULL, 0 ) == 0 );
+    return testResult();
+}
@@ -0,0 +1,57 @@
+#include "line-arg.h"
+#include "test.h"
+
+// Failures are recorded as error codes with where they
+// happened, the message is only formatted when asked for
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "ab", NULL, "", NULL );
+    lnA_addOption( par, NULL, "out", "", NULL );
+    lnA_addOption( par, NULL, "all", "", NULL );
+    char*      text = "-a --out=FILE --all SRC";
+    lnA_Usage* usg  = lnA_addUsage( par, text );
+    
+    struct {
+        char* argv[6];
+        int   code;
+        char* text;
+    } cases[] = {
+        { { NULL },                               lnA_E_MISSING_FLAG,     "Missing -a flag(s)" },
+        { { "-b" },                               lnA_E_INVALID_FLAG,     "Invalid flag 'b' for -a flag(s)" },
+        { { "-a", "f" },                          lnA_E_MISSING_OPTION,   "Missing --out option" },
+        { { "-a", "--out" },                      lnA_E_MISSING_VALUE,    "Missing argument for --out option" },
+        { { "-a", "--out=f", "--all=x" },         lnA_E_UNEXPECTED_VALUE, "Unexpected argument for --all option" },
+        { { "-a", "--out=f", "--all" },           lnA_E_MISSING_PARAM,    "Missing SRC parameter" },
+        { { "-a", "--out=f", "--all", "s", "t" }, lnA_E_EXTRA_WORD,       "Extra or unmatched word 't'" },
+    };
+    for( unsigned i = 0 ; i < sizeof(cases)/sizeof(*cases) ; i++ ) {
+        check( lnA_matchUsage( par, usg, cases[i].argv ) == cases[i].code );
+        const lnA_Error* err = lnA_getError( par );
+        check( err->code == cases[i].code );
+        check( err->usg == usg );
+        checkStr( lnA_errorText( par ), cases[i].text );
+        checkStr( lnA_tryUsage( par, usg, cases[i].argv ), cases[i].text );
+    }
+    
+    // The error says where in the usage and the arguments it failed
+    char* argv[] = { "-a", "--out=f", "--all", "s", "t", NULL };
+    lnA_matchUsage( par, usg, argv );
+    check( lnA_getError( par )->aIdx == 4 );
+    
+    char* argv2[] = { "-a", "x", NULL };
+    lnA_matchUsage( par, usg, argv2 );
+    const lnA_Error* err = lnA_getError( par );
+    check( err->aIdx == 1 );
+    check( !strncmp( &text[err->uIdx], "out", err->uLen ) && err->uLen == 3 );
+    
+    // A match clears the error
+    char* good[] = { "-a", "--out=f", "--all", "s", NULL };
+    check( lnA_matchUsage( par, usg, good ) == lnA_OK );
+    check( lnA_getError( par )->code == lnA_OK );
+    checkStr( lnA_errorText( par ), NULL );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
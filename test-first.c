@@ -0,0 +1,52 @@
+#include "line-arg.h"
+#include "test.h"
+
+// FIRST sets tell when the next argument decides every choice,
+// those usages are matched without trying alternatives
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "abc", NULL, "", NULL );
+    lnA_addOption( par, NULL, "name", "", NULL );
+    
+    char* det[] = {
+        "[-a | -b]... FILE",
+        "{-a X | -b Y | --name=N}",
+        "[-c] {-a | -b FILE...}",
+        "[--name=N]... [FILE]",
+        NULL
+    };
+    char* nonDet[] = {
+        "{-a -b | -a}",
+        "[X] Y",
+        "[-a]... -a",
+        "{X | X -b}",
+        NULL
+    };
+    for( unsigned i = 0 ; det[i] ; i++ )
+        check( lnA_isDeterministic( lnA_addUsage( par, det[i] ) ) == 1 );
+    for( unsigned i = 0 ; nonDet[i] ; i++ )
+        check( lnA_isDeterministic( lnA_addUsage( par, nonDet[i] ) ) == 0 );
+    
+    // Malformed usages aren't
+    check( lnA_isDeterministic( lnA_addUsage( par, "{-a" ) ) == 0 );
+    
+    // Nothing is tried twice, so steps grow with the arguments
+    lnA_Usage* usg = lnA_addUsage( par, "[-a | -b | --name=N]... FILE..." );
+    char* argv[] = { "-a", "-b", "--name=x", "-a", "f", "g", NULL };
+    check( lnA_matchUsage( par, usg, argv ) == lnA_OK );
+    check( lnA_stepsUsed( par ) < 30 );
+    
+    char* bad[] = { "-a", "-c", "f", NULL };
+    check( lnA_matchUsage( par, usg, bad ) == lnA_E_MISSING_PARAM );
+    
+    // Long sequences are checked without recursing on each item
+    static char many[3*100000 + 1];
+    for( unsigned i = 0 ; i < 100000 ; i++ )
+        memcpy( &many[3*i], i % 2 ? "-a " : "X  ", 3 );
+    check( lnA_isDeterministic( lnA_addUsage( par, many ) ) == 1 );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
@@ -0,0 +1,125 @@
+#include "line-arg.h"
+#include "test-gen-args.h"
+#include "test.h"
+#include <stdlib.h>
+
+// Generated matchers give the same results and make the
+// same callbacks as lnA does with the same spec
+
+static char got[256];
+
+void
+flagCb( char* str, void* udata ) {
+    strcat( got, "-" );
+    strcat( got, str );
+    strcat( got, " " );
+}
+
+void
+paramCb( char* str, void* udata ) {
+    strcat( got, str );
+    strcat( got, " " );
+}
+
+void
+sliceCb( char** args, size_t n, void* udata ) {
+    strcat( got, "[" );
+    for( size_t i = 0 ; i < n ; i++ ) {
+        strcat( got, args[i] );
+        strcat( got, i + 1 < n ? " " : "" );
+    }
+    strcat( got, "] " );
+}
+
+static void
+setup( lnA_Parser* par ) {
+    #include "test-gen.lnA"
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    setup( par );
+    check( test_gen_args_USAGE_COUNT == 3 );
+    
+    static char* argvs[][6] = {
+        { "--help" },
+        { "-h", "-v" },
+        { "a", "b" },
+        { "-vq", "--out=x", "a" },
+        { "--out", "x", "a", "b" },
+        { "-q", "--out" },
+        { "-v", "-q" },
+        { "-v", "a", "b", "c" },
+        { "-v" },
+        { "-x", "a" },
+        { "-vx" },
+        { "--bad" },
+        { NULL }
+    };
+    for( unsigned i = 0 ; i < sizeof(argvs)/sizeof(argvs[0]) ; i++ ) {
+        char** argv = argvs[i];
+        
+        got[0] = '\0';
+        lnA_Usage* match;
+        char*      text = lnA_tryAll( par, argv, &match );
+        char       want[256];
+        strcpy( want, got );
+        const lnA_Error* lErr = lnA_getError( par );
+        
+        got[0] = '\0';
+        lnA_Error gErr;
+        unsigned  usage;
+        int       code = test_gen_args_matchAll( argv, NULL, &gErr, &usage );
+        checkStr( got, want );
+        check( code == lErr->code );
+        if( !text ) {
+            check( match == lnA_getUsage( par, usage ) );
+            continue;
+        }
+        
+        char msg[128];
+        test_gen_args_errorText( usage, &gErr, msg, sizeof(msg) );
+        checkStr( msg, text );
+        check( gErr.aIdx == lErr->aIdx );
+        check( gErr.uIdx == lErr->uIdx && gErr.uLen == lErr->uLen );
+        
+        // A single usage fails the same way
+        code = test_gen_args_match( usage, argv, NULL, &gErr );
+        check( code == lnA_matchUsage( par, lnA_getUsage( par, usage ), argv ) );
+    }
+    checkStr( test_gen_args_usages[1], "[-vq] [--out=O] FILES..." );
+    
+    // Errors only lnA gives still have messages
+    char msg[128];
+    lnA_Error err = { .code = lnA_E_BAD_VALUE, .uIdx = 16, .uLen = 5, .arg = "--out=z" };
+    test_gen_args_errorText( 1, &err, msg, sizeof(msg) );
+    checkStr( msg, "Invalid FILES value 'z'" );
+    err = (lnA_Error){ .code = lnA_E_SOURCE_FAILED };
+    test_gen_args_errorText( 1, &err, msg, sizeof(msg) );
+    checkStr( msg, "Couldn't read all of the arguments" );
+    err = (lnA_Error){ .code = lnA_E_STEP_LIMIT };
+    test_gen_args_errorText( 1, &err, msg, sizeof(msg) );
+    checkStr( msg, "Gave up matching after too many steps" );
+    err = (lnA_Error){ .code = lnA_E_DEPTH_LIMIT };
+    test_gen_args_errorText( 1, &err, msg, sizeof(msg) );
+    checkStr( msg, "Usage nests groups too deeply" );
+    
+    // Specs using what generated matchers can't do are rejected
+    static char* bad[] = {
+        "lnA_setLimits( par, 100, 0 );",
+        "lnA_setFlags( par, lnA_STREAM );",
+        "lnA_setMatches( par, &out );",
+        "lnA_addParamValue( par, \"N\", &val );"
+    };
+    for( unsigned i = 0 ; i < sizeof(bad)/sizeof(bad[0]) ; i++ ) {
+        FILE* spec = fopen( "test-gen-bad.lnA", "w" );
+        fprintf( spec, "lnA_addUsage( par, \"-v\" );\n%s\n", bad[i] );
+        fclose( spec );
+        check( system( "./lnA-gen test-gen-bad.lnA test-gen-bad 2>/dev/null" ) != 0 );
+    }
+    remove( "test-gen-bad.lnA" );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
@@ -0,0 +1,105 @@
+#define _POSIX_C_SOURCE 200809L
+#include "line-arg.h"
+#include "test.h"
+#include <unistd.h>
+
+// Help text is wrapped to the width asked for, and kept
+// until the parser changes or another width is asked for
+
+static char* wide =
+    "Usage:\n"
+    "  prog [-v | --verbose]... [--out=O] F...\n"
+    "\n"
+    "Does several things with the files it is given, one at a time.\n"
+    "\n"
+    "Options:\n"
+    "  --out          Where to write\n"
+    "  -v, --verbose  Says more about what it is doing while it does it, which can be\n"
+    "                 a lot\n"
+    "\n"
+    "See the manual.\n";
+
+static char* narrow =
+    "Usage:\n"
+    "  prog [-v | --verbose]... [--out=O]\n"
+    "       F...\n"
+    "\n"
+    "Does several things with the files it is\n"
+    "given, one at a time.\n"
+    "\n"
+    "Options:\n"
+    "  --out  Where to write\n"
+    "  -v, --verbose\n"
+    "         Says more about what it is\n"
+    "         doing while it does it, which\n"
+    "         can be a lot\n"
+    "\n"
+    "See the manual.\n";
+
+// Longest line of the text
+static size_t
+widest( char* text ) {
+    size_t max = 0;
+    for( char* line = text ; *line ; ) {
+        size_t len = strcspn( line, "\n" );
+        if( len > max )
+            max = len;
+        line += len + (line[len] == '\n');
+    }
+    return max;
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_setHeader( par, "Does several things with the files it is given, one at a time." );
+    lnA_setFooter( par, "See the manual." );
+    lnA_addOption( par, "v", "verbose", "Says more about what it is doing while it does it, which can be a lot", NULL );
+    lnA_addOption( par, NULL, "out", "Where to write", NULL );
+    lnA_addParam( par, "F", NULL );
+    lnA_addParam( par, "O", NULL );
+    lnA_addUsage( par, "[-v | --verbose]... [--out=O] F..." );
+    
+    char buf[1024];
+    check( lnA_copyHelp( par, buf, sizeof(buf), 80 ) == strlen( wide ) );
+    checkStr( buf, wide );
+    check( lnA_copyHelp( par, buf, sizeof(buf), 40 ) == strlen( narrow ) );
+    checkStr( buf, narrow );
+    check( widest( buf ) <= 40 );
+    
+    // Nothing's copied unless the NUL fits
+    memset( buf, 'x', sizeof(buf) );
+    check( lnA_copyHelp( par, buf, strlen( narrow ), 40 ) == strlen( narrow ) );
+    check( buf[0] == 'x' );
+    check( lnA_copyHelp( par, NULL, 0, 40 ) == strlen( narrow ) );
+    
+    // Widths are clamped to the narrowest allowed
+    char least[1024];
+    lnA_copyHelp( par, least, sizeof(least), lnA_MIN_HELP_WIDTH );
+    lnA_copyHelp( par, buf, sizeof(buf), 1 );
+    checkStr( buf, least );
+    check( widest( buf ) <= lnA_MIN_HELP_WIDTH );
+    
+    // Changing the parser renders it again
+    lnA_addOption( par, "q", NULL, "Says less", NULL );
+    lnA_addUsage( par, "-q" );
+    check( lnA_copyHelp( par, buf, sizeof(buf), 80 ) > strlen( wide ) );
+    check( strstr( buf, "  prog -q\n" ) != NULL );
+    check( strstr( buf, "  -q             Says less\n" ) != NULL );
+    
+    // Written whole to a file descriptor
+    int fds[2];
+    check( pipe( fds ) == 0 );
+    check( lnA_writeHelp( par, fds[1], 80 ) == 0 );
+    close( fds[1] );
+    char    piped[1024];
+    ssize_t got = read( fds[0], piped, sizeof(piped) - 1 );
+    close( fds[0] );
+    check( got == (ssize_t)strlen( buf ) );
+    piped[got < 0 ? 0 : got] = '\0';
+    checkStr( piped, buf );
+    check( lnA_writeHelp( par, -1, 80 ) == -1 );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
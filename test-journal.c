@@ -0,0 +1,67 @@
+#include "line-arg.h"
+#include "test.h"
+
+// Callbacks are queued in a journal while matching, the parts
+// of it from alternatives that failed are rolled back
+
+static char     got[256];
+static unsigned count;
+static unsigned inOrder;
+
+static void
+optCb( char* opt, void* udata ) {
+    strcat( got, opt );
+    strcat( got, " " );
+}
+
+static void
+prmCb( char* arg, void* udata ) {
+    strcat( got, arg );
+    strcat( got, " " );
+}
+
+static void
+countCb( char* arg, void* udata ) {
+    char** argv = udata;
+    inOrder += argv[count] == arg;
+    count++;
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "abc", NULL, "", &optCb );
+    lnA_addParam( par, "X", &prmCb );
+    lnA_addParam( par, "Y", &prmCb );
+    
+    lnA_Usage* usg = lnA_addUsage( par, "{-a X -b | -a X -c | -a Y} [-b]" );
+    char* argv1[] = { "-a", "x", "-c", NULL };
+    checkStr( lnA_tryUsage( par, usg, argv1 ), NULL );
+    checkStr( got, "abc x abc " );
+    
+    got[0] = '\0';
+    char* argv2[] = { "-a", "y", "-b", "-b", "-b", NULL };
+    check( lnA_tryUsage( par, usg, argv2 ) != NULL );
+    checkStr( got, "" );
+    
+    got[0] = '\0';
+    char* argv3[] = { "-a", "y", NULL };
+    checkStr( lnA_tryUsage( par, usg, argv3 ), NULL );
+    checkStr( got, "abc y " );
+    lnA_freeParser( par );
+    
+    // Long runs of callbacks grow the journal
+    static char* many[10001];
+    for( unsigned i = 0 ; i < 10000 ; i++ )
+        many[i] = "arg";
+    par = lnA_makeParser( "prog", many );
+    lnA_addParam( par, "X", &countCb );
+    lnA_addOption( par, "a", NULL, "", NULL );
+    usg = lnA_addUsage( par, "[X... -a] X..." );
+    checkStr( lnA_tryUsage( par, usg, many ), NULL );
+    check( count == 10000 );
+    check( inOrder == 10000 );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
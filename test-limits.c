@@ -0,0 +1,103 @@
+#include "line-arg.h"
+#include "test.h"
+
+// Step and depth limits bound the work a parse can take,
+// so untrusted arguments can't make matching run away
+
+static unsigned files;
+
+static void
+prmCb( char* arg, void* udata ) {
+    files++;
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "a", NULL, "", NULL );
+    lnA_addOption( par, "b", NULL, "", NULL );
+    lnA_addParam( par, "F", &prmCb );
+    lnA_Usage* slow = lnA_addUsage( par, "{{-a | -a -a} | -a}... -b" );
+    lnA_Usage* list = lnA_addUsage( par, "[-a]... F..." );
+    
+    char* argv[] = { "-a", "-a", "-a", "-a", "-a", "-a", "x", "y", NULL };
+    check( lnA_matchUsage( par, list, argv ) == lnA_OK );
+    unsigned long used = lnA_stepsUsed( par );
+    check( used > 0 );
+    check( files == 2 );
+    
+    // The budget is inclusive
+    lnA_setLimits( par, used, 0 );
+    check( lnA_matchUsage( par, list, argv ) == lnA_OK );
+    check( lnA_stepsUsed( par ) == used );
+    check( files == 4 );
+    
+    lnA_setLimits( par, used - 1, 0 );
+    check( lnA_matchUsage( par, list, argv ) == lnA_E_STEP_LIMIT );
+    check( files == 4 );
+    
+    // Running out in one usage ends the whole of lnA_tryAll(),
+    // even though a later usage would match
+    lnA_setLimits( par, 0, 0 );
+    check( lnA_matchUsage( par, slow, argv ) == lnA_E_MISSING_FLAG );
+    unsigned long tried = lnA_stepsUsed( par );
+    check( lnA_tryAll( par, argv, NULL ) == NULL );
+    check( lnA_stepsUsed( par ) >= tried + used );
+    
+    lnA_setLimits( par, tried, 0 );
+    char* text = lnA_tryAll( par, argv, NULL );
+    check( lnA_getError( par )->code == lnA_E_STEP_LIMIT );
+    char want[64];
+    snprintf( want, sizeof(want), "Gave up matching after %lu steps", tried );
+    checkStr( text, want );
+    check( lnA_matchError( par, list ) == NULL );
+    check( files == 6 );
+    
+    // Memoized matches also count the steps of queueing
+    // callbacks from the memo table, and can run out there
+    lnA_setLimits( par, 0, 0 );
+    lnA_setFlags( par, lnA_MEMOIZE );
+    check( lnA_matchUsage( par, list, argv ) == lnA_OK );
+    used = lnA_stepsUsed( par );
+    lnA_setLimits( par, used, 0 );
+    check( lnA_matchUsage( par, list, argv ) == lnA_OK );
+    files = 0;
+    lnA_setLimits( par, used - 1, 0 );
+    check( lnA_matchUsage( par, list, argv ) == lnA_E_STEP_LIMIT );
+    check( files == 0 );
+    lnA_setFlags( par, 0 );
+    
+    // Usages nesting too deep aren't matched at all, ones
+    // added later are malformed
+    lnA_setLimits( par, 0, 1 );
+    check( lnA_matchUsage( par, slow, argv ) == lnA_E_DEPTH_LIMIT );
+    checkStr( lnA_errorText( par ), "Usage nests groups deeper than 1" );
+    check( lnA_tryAll( par, argv, NULL ) == NULL );
+    
+    lnA_Usage* deep = lnA_addUsage( par, "{[-a] -b}" );
+    checkStr( lnA_usageError( deep ), "Groups nested deeper than 1" );
+    check( lnA_matchUsage( par, deep, argv ) != lnA_OK );
+    checkStr( lnA_usageError( lnA_addUsage( par, "{-a | -b}..." ) ), NULL );
+    
+    // Without a limit groups still can't nest past lnA_MAX_NEST
+    lnA_setLimits( par, 0, 0 );
+    static char nested[2*lnA_MAX_NEST + 8];
+    for( unsigned n = lnA_MAX_NEST ; n <= lnA_MAX_NEST + 1 ; n++ ) {
+        memset( nested, '[', n );
+        strcpy( &nested[n], "-a" );
+        memset( &nested[n + 2], ']', n );
+        nested[2*n + 2] = '\0';
+        lnA_Usage* usg = lnA_addUsage( par, nested );
+        if( n == lnA_MAX_NEST ) {
+            checkStr( lnA_usageError( usg ), NULL );
+            check( lnA_matchUsage( par, usg, (char*[]){ "-a", NULL } ) == lnA_OK );
+        }
+        else {
+            checkStr( lnA_usageError( usg ), "Groups nested deeper than 256" );
+            check( lnA_matchUsage( par, usg, argv ) == lnA_E_DEPTH_LIMIT );
+        }
+    }
+    
+    lnA_freeParser( par );
+    return testResult();
+}
@@ -0,0 +1,52 @@
+#include "line-arg.h"
+#include "test.h"
+#include <stdlib.h>
+
+// Options and parameters are found through hash tables,
+// which have to keep working as they grow
+
+static char names[1000][16];
+static int  hits[1000];
+
+static void
+optCb( char* opt, void* udata ) {
+    hits[atoi( &opt[3] )]++;
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    for( unsigned i = 0 ; i < 1000 ; i++ ) {
+        snprintf( names[i], sizeof(names[i]), "opt%u", i );
+        check( lnA_addOption( par, NULL, names[i], "", NULL ) == (int)i );
+        check( lnA_addParam( par, names[i], NULL ) == (int)i );
+    }
+    lnA_addOption( par, "xy", NULL, "", NULL );
+    
+    for( unsigned i = 0 ; i < 1000 ; i++ ) {
+        check( lnA_optionId( par, NULL, names[i] ) == (int)i );
+        check( lnA_paramId( par, names[i] ) == (int)i );
+    }
+    check( lnA_optionId( par, "y", NULL ) == 1000 );
+    check( lnA_optionId( par, NULL, "opt1000" ) == -1 );
+    check( lnA_optionId( par, "z", NULL ) == -1 );
+    check( lnA_paramId( par, "opt" ) == -1 );
+    
+    check( lnA_bindOption( par, NULL, "opt7", &optCb ) == 0 );
+    check( lnA_bindOption( par, NULL, "opt999", &optCb ) == 0 );
+    check( lnA_bindOption( par, NULL, "nope", &optCb ) == -1 );
+    check( lnA_bindParam( par, "nope", NULL ) == -1 );
+    
+    lnA_Usage* usg = lnA_addUsage( par, "[--opt7 | --opt999 | -x]..." );
+    char* argv[] = { "--opt7", "-x", "--opt999", "--opt7", NULL };
+    checkStr( lnA_tryUsage( par, usg, argv ), NULL );
+    check( hits[7] == 2 && hits[999] == 1 );
+    
+    // Options in usages have to be added
+    char* unknown[] = { "--opt1000", NULL };
+    usg = lnA_addUsage( par, "--opt1000" );
+    check( lnA_matchUsage( par, usg, unknown ) == lnA_E_OPTION_INFO );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
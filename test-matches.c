@@ -0,0 +1,81 @@
+#include "line-arg.h"
+#include "test.h"
+
+// Parses can collect what they matched instead of invoking
+// callbacks, with the values pointing into the arguments
+
+static unsigned calls;
+
+static void
+optCb( char* str, void* udata ) {
+    calls++;
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "vq", NULL, "", &optCb );
+    lnA_addOption( par, NULL, "out", "", &optCb );
+    lnA_addParam( par, "O", NULL );
+    lnA_addParam( par, "FILES", NULL );
+    lnA_Usage* usg = lnA_addUsage( par, "{-vq | --out=O}... FILES..." );
+    
+    int v     = lnA_optionId( par, "v", NULL );
+    int out   = lnA_optionId( par, NULL, "out" );
+    int o     = lnA_paramId( par, "O" );
+    int files = lnA_paramId( par, "FILES" );
+    check( v >= 0 && out >= 0 && v != out );
+    check( o >= 0 && files >= 0 && o != files );
+    check( lnA_optionId( par, "x", NULL ) == -1 );
+    check( lnA_paramId( par, "X" ) == -1 );
+    
+    lnA_Matches m = { 0 };
+    lnA_setMatches( par, &m );
+    
+    char* argv[] = { "-vq", "--out=x", "a", "-v", "--out=yz", "b", NULL };
+    check( lnA_tryAll( par, argv, NULL ) != NULL );
+    check( m.usg == NULL );
+    
+    char* ok[] = { "-vq", "--out=x", "-v", "--out=yz", "a", "b", "c", NULL };
+    check( lnA_tryAll( par, ok, NULL ) == NULL );
+    check( calls == 0 );
+    check( m.usg == usg );
+    check( m.oCount[v] == 3 );  // Once per flag, like its callback
+    check( m.oCount[out] == 2 );
+    check( m.pCount[o] == 2 );
+    check( m.pCount[files] == 3 );
+    check( m.vCount == 5 );
+    
+    check( m.vParam[m.pFirst[o]] == (unsigned)o );
+    check( m.vParam[m.pFirst[files]] == (unsigned)files );
+    checkStr( m.vStr[m.pFirst[files]], "a" );
+    
+    static const char* want[] = { "x", "yz", "a", "b", "c" };
+    static unsigned    args[] = { 1, 3, 4, 5, 6 };
+    for( unsigned i = 0 ; i < m.vCount ; i++ ) {
+        check( m.vLen[i] == strlen( want[i] ) );
+        check( strncmp( m.vStr[i], want[i], m.vLen[i] ) == 0 );
+        check( m.vArg[i] == args[i] );
+        check( m.vStr[i] == &ok[m.vArg[i]][m.vOff[i]] );
+    }
+    check( m.vOff[0] == strlen( "--out=" ) );
+    check( m.vOff[2] == 0 );
+    
+    // Parsing again reuses the arrays
+    unsigned* vStr = (unsigned*)m.vStr;
+    char* one[] = { "-v", "a", NULL };
+    check( lnA_matchUsage( par, usg, one ) == lnA_OK );
+    check( (unsigned*)m.vStr == vStr );
+    check( m.vCount == 1 && m.oCount[v] == 1 && m.pCount[o] == 0 );
+    
+    // Callbacks are back once it's unset
+    lnA_setMatches( par, NULL );
+    check( lnA_tryAll( par, ok, NULL ) == NULL );
+    check( calls == 5 );
+    check( m.vCount == 1 );
+    
+    lnA_freeMatches( par, &m );
+    check( m.vStr == NULL && m.vCount == 0 );
+    lnA_freeParser( par );
+    return testResult();
+}
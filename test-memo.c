@@ -0,0 +1,100 @@
+#include "line-arg.h"
+#include "test.h"
+
+// Memoized matching takes the same choices as backtracking,
+// but never rematches a part of a usage at the same argument
+
+static char got[512];
+
+static void
+optCb( char* opt, void* udata ) {
+    strcat( got, opt );
+    strcat( got, " " );
+}
+
+static void
+prmCb( char* arg, void* udata ) {
+    strcat( got, arg );
+    strcat( got, " " );
+}
+
+static lnA_Parser*
+makeParser( unsigned flags ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_setFlags( par, flags );
+    lnA_addOption( par, "a", NULL, "", &optCb );
+    lnA_addOption( par, "b", NULL, "", &optCb );
+    lnA_addOption( par, "c", NULL, "", &optCb );
+    lnA_addOption( par, NULL, "long", "", &optCb );
+    lnA_addParam( par, "X", &prmCb );
+    lnA_addParam( par, "Y", &prmCb );
+    return par;
+}
+
+static char* usages[] = {
+    "{[-a]... -b | -a}...",
+    "{-a -b | -a}... [X]",
+    "[-a | -a -b]... -c",
+    "{X Y | X}... [--long=Y]",
+    "{{-a -c | -a} -c | {-a -c | -a}} -b",
+    "[{X | -a}... -b] X...",
+    NULL
+};
+
+static char* args[][8] = {
+    { "-a", "-a", "-b", "-a", NULL },
+    { "-a", "-b", "-a", "x", NULL },
+    { "-a", "-b", "-c", NULL },
+    { "x", "y", "x", "--long=z", NULL },
+    { "-a", "-c", "-c", "-b", NULL },
+    { "x", "-a", "-b", "y", "z", NULL },
+    { "-a", "q", NULL },
+    { NULL }
+};
+
+int
+main( void ) {
+    lnA_Parser* plain = makeParser( 0 );
+    lnA_Parser* memo  = makeParser( lnA_MEMOIZE );
+    for( unsigned u = 0 ; usages[u] ; u++ ) {
+        lnA_Usage* pUsg = lnA_addUsage( plain, usages[u] );
+        lnA_Usage* mUsg = lnA_addUsage( memo, usages[u] );
+        for( unsigned a = 0 ; a < sizeof(args)/sizeof(*args) ; a++ ) {
+            char want[512];
+            got[0] = '\0';
+            int pErr = lnA_matchUsage( plain, pUsg, args[a] );
+            strcpy( want, got );
+            
+            got[0] = '\0';
+            int mErr = lnA_matchUsage( memo, mUsg, args[a] );
+            check( pErr == mErr );
+            checkStr( got, want );
+            if( pErr && mErr )
+                checkStr( lnA_errorText( memo ), lnA_errorText( plain ) );
+        }
+    }
+    
+    // Rematching is quadratic here without the memo table
+    lnA_Usage* pUsg = lnA_addUsage( plain, usages[0] );
+    lnA_Usage* mUsg = lnA_addUsage( memo, usages[0] );
+    unsigned long pSteps[2], mSteps[2];
+    for( unsigned i = 0 ; i < 2 ; i++ ) {
+        char* argv[129];
+        unsigned n = 64 << i;
+        for( unsigned j = 0 ; j < n ; j++ )
+            argv[j] = "-a";
+        argv[n] = NULL;
+        got[0] = '\0';
+        check( lnA_matchUsage( plain, pUsg, argv ) == lnA_OK );
+        got[0] = '\0';
+        check( lnA_matchUsage( memo, mUsg, argv ) == lnA_OK );
+        pSteps[i] = lnA_stepsUsed( plain );
+        mSteps[i] = lnA_stepsUsed( memo );
+    }
+    check( pSteps[1] > 3*pSteps[0] );
+    check( mSteps[1] < 3*mSteps[0] );
+    
+    lnA_freeParser( plain );
+    lnA_freeParser( memo );
+    return testResult();
+}
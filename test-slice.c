@@ -0,0 +1,60 @@
+#include "line-arg.h"
+#include "test.h"
+
+// Repeated parameters are passed to slice callbacks in one
+// call, pointing into the argument list
+
+static char**   slices[8];
+static size_t   sizes[8];
+static unsigned calls;
+
+static void
+sliceCb( char** args, size_t n, void* udata ) {
+    slices[calls] = args;
+    sizes[calls]  = n;
+    calls++;
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "v", NULL, "", NULL );
+    lnA_addOption( par, NULL, "out", "", NULL );
+    lnA_addParamSlice( par, "FILES", &sliceCb );
+    lnA_addParamSlice( par, "O", &sliceCb );
+    lnA_Usage* usg = lnA_addUsage( par, "[--out=O] FILES... [-v FILES...]" );
+    
+    char* argv[] = { "--out=o", "a", "b", "c", "-v", "d", NULL };
+    checkStr( lnA_tryUsage( par, usg, argv ), NULL );
+    check( calls == 3 );
+    
+    // An option's value is a slice of one
+    check( sizes[0] == 1 );
+    checkStr( slices[0][0], "o" );
+    
+    check( slices[1] == &argv[1] && sizes[1] == 3 );
+    check( slices[2] == &argv[5] && sizes[2] == 1 );
+    
+    // Failed parses don't pass any
+    calls = 0;
+    char* bad[] = { "a", "b", "-x", NULL };
+    check( lnA_tryUsage( par, usg, bad ) != NULL );
+    check( calls == 0 );
+    
+    // Slices still work when a repetition's arguments are matched
+    // by several alternatives
+    lnA_Parser* alt = lnA_makeParser( "prog", NULL );
+    lnA_addOption( alt, "v", NULL, "", NULL );
+    lnA_addParamSlice( alt, "X", &sliceCb );
+    usg = lnA_addUsage( alt, "{X | -v}..." );
+    char* mixed[] = { "a", "b", "-v", "c", NULL };
+    checkStr( lnA_tryUsage( alt, usg, mixed ), NULL );
+    size_t total = 0;
+    for( unsigned i = 0 ; i < calls ; i++ )
+        total += sizes[i];
+    check( total == 3 );
+    
+    lnA_freeParser( alt );
+    lnA_freeParser( par );
+    return testResult();
+}
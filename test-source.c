@@ -0,0 +1,196 @@
+// For pipes and temporary files
+#define _POSIX_C_SOURCE 200809L
+
+#include "line-arg.h"
+#include "test.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+// Arguments can be pulled from response files, file descriptors,
+// and argument lists with '@file' arguments
+
+static char     got[256];
+static unsigned count;
+static unsigned releases;
+
+static void
+prmCb( char* arg, void* udata ) {
+    if( strlen( got ) + strlen( arg ) + 2 < sizeof(got) ) {
+        strcat( got, arg );
+        strcat( got, " " );
+    }
+    count++;
+}
+
+// Counts the stream source's releases before passing them on
+static lnA_Source inner;
+
+static char*
+countPull( void* ctx ) {
+    return inner.pull( inner.ctx );
+}
+
+static void
+countRelease( void* ctx, char* arg ) {
+    releases++;
+    inner.release( inner.ctx, arg );
+}
+
+// Fails after returning two arguments
+static unsigned pulled;
+
+static char*
+failPull( void* ctx ) {
+    return pulled < 2 ? (char*[]){ "a", "b" }[pulled++] : NULL;
+}
+
+static int
+failError( void* ctx ) {
+    return pulled == 2 ? ENOMEM : 0;
+}
+
+// Counts the mappings of a file that are still open
+static unsigned
+mappings( char* path ) {
+    FILE* maps = fopen( "/proc/self/maps", "r" );
+    if( !maps )
+        return 0;
+    
+    char     line[512];
+    unsigned n = 0;
+    while( fgets( line, sizeof(line), maps ) )
+        n += strstr( line, path ) != NULL;
+    fclose( maps );
+    return n;
+}
+
+static char*    watch;
+static unsigned mapped;
+
+static void
+watchCb( char* arg, void* udata ) {
+    unsigned n = mappings( watch );
+    if( n > mapped )
+        mapped = n;
+}
+
+static void
+writeFile( char* path, char* text, size_t len ) {
+    int fd = mkstemp( path );
+    check( fd >= 0 && write( fd, text, len ) == (ssize_t)len );
+    close( fd );
+}
+
+// Matches 'n' arguments written to a pipe by a child process
+static void
+matchPipe( lnA_Parser* par, lnA_Usage* usg, unsigned n ) {
+    int fds[2];
+    check( !pipe( fds ) );
+    pid_t pid = fork();
+    if( !pid ) {
+        close( fds[0] );
+        char line[32];
+        for( unsigned i = 0 ; i < n ; i++ ) {
+            int len = snprintf( line, sizeof(line), "argument-%u\n", i );
+            if( write( fds[1], line, len ) != len )
+                _exit( 1 );
+        }
+        _exit( 0 );
+    }
+    close( fds[1] );
+    
+    lnA_Source src;
+    check( !lnA_openStream( &inner, fds[0] ) );
+    src = (lnA_Source){ .pull = &countPull, .ctx = NULL, .release = &countRelease };
+    count = releases = 0;
+    got[0] = '\0';
+    check( lnA_matchSource( par, usg, &src ) == lnA_OK );
+    check( count == n );
+    lnA_closeSource( &inner );
+    close( fds[0] );
+    waitpid( pid, NULL, 0 );
+}
+
+int
+main( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "x", NULL, "", NULL );
+    lnA_addParam( par, "F", &prmCb );
+    lnA_Usage* usg = lnA_addUsage( par, "[-x] F..." );
+    
+    // Newlines and NULs both split arguments, empty ones are skipped
+    char lines[] = "/tmp/lnA-lines-XXXXXX";
+    char nuls[]  = "/tmp/lnA-nuls-XXXXXX";
+    writeFile( lines, "-x\na b\n\nlast", 13 );
+    writeFile( nuls, "one\0two\0\0three", 14 );
+    
+    lnA_Source src;
+    check( !lnA_openFile( &src, lines ) );
+    check( lnA_matchSource( par, usg, &src ) == lnA_OK );
+    checkStr( got, "a b last " );
+    lnA_closeSource( &src );
+    
+    got[0] = '\0';
+    check( !lnA_openFile( &src, nuls ) );
+    check( lnA_matchSource( par, usg, &src ) == lnA_OK );
+    checkStr( got, "one two three " );
+    lnA_closeSource( &src );
+    
+    // Files that can't be opened are kept as arguments
+    char at1[32], at2[32];
+    snprintf( at1, sizeof(at1), "@%s", nuls );
+    snprintf( at2, sizeof(at2), "@%s", lines );
+    char* argv[] = { at1, "mid", "@/nonexistent/lnA", at2, NULL };
+    got[0] = '\0';
+    check( !lnA_openArgs( &src, argv ) );
+    check( lnA_matchSource( par, usg, &src ) == lnA_E_EXTRA_WORD );
+    lnA_closeSource( &src );
+    check( lnA_openFile( &src, "/nonexistent/lnA" ) == -1 );
+    
+    // With lnA_STREAM files are closed once they've been
+    // matched, even when the same '@path' string is repeated
+    lnA_Parser* files = lnA_makeParser( "prog", NULL );
+    lnA_addParam( files, "F", &watchCb );
+    lnA_setFlags( files, lnA_STREAM );
+    static char* many[401];
+    for( unsigned i = 0 ; i < 400 ; i++ )
+        many[i] = i % 2 ? at1 : "mid";
+    watch = nuls;
+    check( !lnA_openArgs( &src, many ) );
+    check( lnA_matchSource( files, lnA_addUsage( files, "F..." ), &src ) == lnA_OK );
+    check( mapped > 0 && mapped < 50 );
+    lnA_closeSource( &src );
+    lnA_freeParser( files );
+    unlink( lines );
+    unlink( nuls );
+    
+    // Sources that fail fail the match, instead of it ending
+    // early, and nothing's invoked for what did match
+    got[0] = '\0';
+    src = (lnA_Source){ .pull = &failPull, .error = &failError };
+    check( lnA_matchSource( par, usg, &src ) == lnA_E_SOURCE_FAILED );
+    checkStr( lnA_errorText( par ), "Couldn't read all of the arguments" );
+    checkStr( got, "" );
+    
+    int dir = open( "/", O_RDONLY );
+    check( !lnA_openStream( &src, dir ) );
+    check( lnA_matchSource( par, usg, &src ) == lnA_E_SOURCE_FAILED );
+    lnA_closeSource( &src );
+    close( dir );
+    
+    // Streamed input is released behind the window, unless
+    // the whole parse has to be kept
+    lnA_setFlags( par, lnA_STREAM );
+    matchPipe( par, usg, 100000 );
+    check( releases > 0 );
+    
+    lnA_setFlags( par, 0 );
+    matchPipe( par, usg, 1000 );
+    check( releases == 0 );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
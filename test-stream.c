@@ -0,0 +1,77 @@
+#include "line-arg.h"
+#include "test.h"
+
+// With lnA_STREAM callbacks for the parts of a usage outside
+// of any group are invoked as soon as those parts match
+
+static char got[256];
+
+static void
+optCb( char* opt, void* udata ) {
+    strcat( got, opt );
+    strcat( got, " " );
+}
+
+static void
+prmCb( char* arg, void* udata ) {
+    strcat( got, arg );
+    strcat( got, " " );
+}
+
+static lnA_Parser*
+makeParser( unsigned flags ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_setFlags( par, flags );
+    lnA_addOption( par, "a", NULL, "", &optCb );
+    lnA_addOption( par, "b", NULL, "", &optCb );
+    lnA_addParam( par, "X", &prmCb );
+    return par;
+}
+
+int
+main( void ) {
+    char* good[] = { "-a", "x", "y", "-b", "z", NULL };
+    char* bad[]  = { "-a", "x", "y", "-c", NULL };
+    char* want   = "a x y b z ";
+    
+    unsigned flags[] = { 0, lnA_STREAM, lnA_STREAM | lnA_MEMOIZE };
+    for( unsigned i = 0 ; i < 3 ; i++ ) {
+        lnA_Parser* par = makeParser( flags[i] );
+        lnA_Usage*  usg = lnA_addUsage( par, "-a X... [-b X]" );
+        
+        got[0] = '\0';
+        checkStr( lnA_tryUsage( par, usg, good ), NULL );
+        checkStr( got, want );
+        
+        // Only streaming without memoization has already passed
+        // on the start of a usage that fails later
+        got[0] = '\0';
+        check( lnA_tryUsage( par, usg, bad ) != NULL );
+        checkStr( got, flags[i] == lnA_STREAM ? "a x y " : "" );
+        lnA_freeParser( par );
+    }
+    
+    // Groups are still undone as a whole
+    lnA_Parser* par = makeParser( lnA_STREAM );
+    lnA_Usage*  usg = lnA_addUsage( par, "{-a X -b | -a X} X..." );
+    char* argv[] = { "-a", "x", "y", "z", NULL };
+    got[0] = '\0';
+    checkStr( lnA_tryUsage( par, usg, argv ), NULL );
+    checkStr( got, "a x y z " );
+    
+    lnA_freeParser( par );
+    
+    // lnA_tryAll() holds callbacks until a usage has matched
+    par = makeParser( lnA_STREAM );
+    lnA_addUsage( par, "-a X... -b" );
+    usg = lnA_addUsage( par, "-a X..." );
+    lnA_Usage* won;
+    char* list[] = { "-a", "x", "y", NULL };
+    got[0] = '\0';
+    checkStr( lnA_tryAll( par, list, &won ), NULL );
+    check( won == usg );
+    checkStr( got, "a x y " );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
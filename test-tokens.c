@@ -0,0 +1,63 @@
+#include "line-arg.h"
+#include "test.h"
+
+// Arguments are classified once per parse; long names are
+// measured a word at a time, so every length is tried
+
+static char* value;
+
+static void
+valCb( char* arg, void* udata ) {
+    value = arg;
+}
+
+int
+main( void ) {
+    static char names[40][48];
+    static char usages[40][112];
+    static char args[40][64];
+    for( unsigned len = 1 ; len < 40 ; len++ ) {
+        lnA_Parser* par = lnA_makeParser( "prog", NULL );
+        for( unsigned i = 0 ; i < len ; i++ )
+            names[len][i] = 'a' + i % 26;
+        lnA_addOption( par, NULL, names[len], "", NULL );
+        lnA_addParam( par, "V", &valCb );
+        
+        snprintf( usages[len], sizeof(usages[len]), "--%s=V", names[len] );
+        lnA_Usage* usg = lnA_addUsage( par, usages[len] );
+        
+        // Values can have '=' in them too
+        snprintf( args[len], sizeof(args[len]), "--%s=x=y", names[len] );
+        char* argv[] = { args[len], NULL };
+        value = NULL;
+        checkStr( lnA_tryUsage( par, usg, argv ), NULL );
+        checkStr( value, "x=y" );
+        
+        // One letter short or long doesn't match
+        args[len][2 + len - 1] = '=';
+        args[len][2 + len]     = '\0';
+        check( lnA_matchUsage( par, usg, argv ) != lnA_OK );
+        snprintf( args[len], sizeof(args[len]), "--%sz=x", names[len] );
+        check( lnA_matchUsage( par, usg, argv ) != lnA_OK );
+        lnA_freeParser( par );
+    }
+    
+    // Short flags, lone dashes, and parameters
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, "abc", NULL, "", NULL );
+    lnA_addParam( par, "V", &valCb );
+    lnA_Usage* usg = lnA_addUsage( par, "[-abc]... [V]" );
+    char* flags[] = { "-ab", "-c", "-cab", "v", NULL };
+    checkStr( lnA_tryUsage( par, usg, flags ), NULL );
+    checkStr( value, "v" );
+    
+    char* dash[] = { "-", NULL };
+    check( lnA_matchUsage( par, usg, dash ) == lnA_E_EXTRA_WORD );
+    char* dashes[] = { "--", NULL };
+    check( lnA_matchUsage( par, usg, dashes ) == lnA_E_EXTRA_WORD );
+    char* bad[] = { "-abd", NULL };
+    check( lnA_matchUsage( par, usg, bad ) == lnA_E_EXTRA_WORD );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
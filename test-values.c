@@ -0,0 +1,89 @@
+#include "line-arg.h"
+#include "test.h"
+#include <stdint.h>
+
+// Typed parameters convert their arguments while matching,
+// arguments that aren't valid values don't match
+
+static int64_t  num;
+static uint64_t count;
+static double   ratio;
+static int      flag;
+static int      color;
+static int64_t  level;
+
+static const char* colors[] = { "red", "green", "blue", NULL };
+
+static lnA_Parser*
+makeParser( void ) {
+    lnA_Parser* par = lnA_makeParser( "prog", NULL );
+    lnA_addOption( par, NULL, "num", "", NULL );
+    lnA_addParamValue( par, "N", &(lnA_Value){ .kind = lnA_V_INT,    .dest = &num } );
+    lnA_addParamValue( par, "C", &(lnA_Value){ .kind = lnA_V_UINT,   .dest = &count } );
+    lnA_addParamValue( par, "D", &(lnA_Value){ .kind = lnA_V_DOUBLE, .dest = &ratio } );
+    lnA_addParamValue( par, "B", &(lnA_Value){ .kind = lnA_V_BOOL,   .dest = &flag } );
+    lnA_addParamValue( par, "E", &(lnA_Value){ .kind = lnA_V_ENUM,   .dest = &color, .names = colors } );
+    lnA_addParamValue( par, "R", &(lnA_Value){ .kind = lnA_V_RANGE,  .dest = &level, .lo = 1, .hi = 9 } );
+    lnA_addUsage( par, "--num=N C D B E R" );
+    return par;
+}
+
+static int
+run( lnA_Parser* par, char* n, char* c, char* d, char* b, char* e, char* r ) {
+    char* argv[] = { n, c, d, b, e, r, NULL };
+    return lnA_matchUsage( par, lnA_getUsage( par, 0 ), argv );
+}
+
+int
+main( void ) {
+    lnA_Parser* par = makeParser();
+    
+    check( run( par, "--num=-42", "18446744073709551615", "1.5e3", "yes", "blue", "9" ) == lnA_OK );
+    check( num == -42 );
+    check( count == UINT64_MAX );
+    check( ratio == 1500.0 );
+    check( flag == 1 );
+    check( color == 2 );
+    check( level == 9 );
+    
+    check( run( par, "--num=9223372036854775807", "0", "0.1", "off", "red", "1" ) == lnA_OK );
+    check( num == INT64_MAX && count == 0 && ratio == 0.1 );
+    check( flag == 0 && color == 0 && level == 1 );
+    
+    // Digits past what fits in 64 bits are still read
+    char digits[300] = "0.";
+    memset( &digits[2], '0', 250 );
+    strcpy( &digits[252], "25" );
+    check( run( par, "--num=1", "1", digits, "true", "green", "5" ) == lnA_OK );
+    check( ratio == 0.25e-250 );
+    check( run( par, "--num=1", "1", "2.5e300", "true", "green", "5" ) == lnA_OK );
+    check( ratio == 2.5e300 );
+    check( run( par, "--num=1", "1", "12345678901234567890.123e-5", "true", "green", "5" ) == lnA_OK );
+    check( ratio == 123456789012345.67890123 );
+    
+    // Nothing's stored unless the whole usage matches
+    static char* bad[][6] = {
+        { "--num=1x", "1",  "1",  "1",     "red",  "1" },
+        { "--num=1",  "-1", "1",  "1",     "red",  "1" },
+        { "--num=1",  "1",  "1e", "1",     "red",  "1" },
+        { "--num=1",  "1",  "1",  "maybe", "red",  "1" },
+        { "--num=1",  "1",  "1",  "1",     "pink", "1" },
+        { "--num=1",  "1",  "1",  "1",     "red",  "10" },
+        { "--num=1",  "1",  "1",  "1",     "red",  "0" },
+        { "--num=9223372036854775808", "1", "1", "1", "red", "1" },
+        { "--num=1",  "18446744073709551616", "1", "1", "red", "1" }
+    };
+    for( unsigned i = 0 ; i < sizeof(bad)/sizeof(bad[0]) ; i++ ) {
+        int code = run( par, bad[i][0], bad[i][1], bad[i][2], bad[i][3], bad[i][4], bad[i][5] );
+        check( code == lnA_E_BAD_VALUE || (i == 1 && code != lnA_OK) );
+    }
+    check( num == 1 && count == 1 && color == 1 );
+    
+    check( run( par, "--num=1", "1", "1", "1", "pink", "1" ) == lnA_E_BAD_VALUE );
+    checkStr( lnA_errorText( par ), "Invalid E value 'pink'" );
+    check( run( par, "--num=x", "1", "1", "1", "red", "1" ) == lnA_E_BAD_VALUE );
+    checkStr( lnA_errorText( par ), "Invalid N value 'x'" );
+    
+    lnA_freeParser( par );
+    return testResult();
+}
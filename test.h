@@ -0,0 +1,34 @@
+#ifndef lnA_test_h
+#define lnA_test_h
+
+// Checks for the test programs, each counts its failed
+// checks and exits with 1 if there were any
+
+#include <stdio.h>
+#include <string.h>
+
+static unsigned tFails = 0;
+
+#define check( cond ) \
+    do { \
+        if( !(cond) ) { \
+            fprintf( stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond ); \
+            tFails++; \
+        } \
+    } while( 0 )
+
+// Either string can be NULL
+#define checkStr( a, b ) \
+    do { \
+        const char* tA = (a); \
+        const char* tB = (b); \
+        if( tA && tB ? strcmp( tA, tB ) : tA != tB ) { \
+            fprintf( stderr, "%s:%d: '%s' isn't '%s'\n", __FILE__, __LINE__, tA ? tA : "(null)", tB ? tB : "(null)" ); \
+            tFails++; \
+        } \
+    } while( 0 )
+
+#define testResult() \
+    (printf( "%s: %s\n", __FILE__, tFails ? "FAILED" : "ok" ), tFails ? 1 : 0)
+
+#endif